@@ -0,0 +1,316 @@
+// Roofline for the CPU element-wise kernels (vecops.h): achieved GB/s of
+// each against the memory bandwidth STREAM measures on the same arrays,
+// one CSV row per kernel and size.
+//
+// The kernels do one or two flops per 4 to 16 bytes, far left of any
+// CPU's ridge point, so memory is their roof: roof_pct near 100 means a
+// kernel runs as fast as the data can arrive, and only then would a GPU's
+// bandwidth (see main.c) be worth the dispatch. The STREAM rows are its
+// copy and triad loops, plain C as in the reference code, and a read-only
+// sum in the same style. stream_gbps is the roof at the same size (in
+// cache it is a cache bandwidth): the sum's rate for the reductions, which
+// only read, and triad's for the kernels that write, which pay for the
+// write-back too. Some rows still pass 100:
+//   - axpy writes over an array it has just read, so unlike triad it pays
+//     no write-allocate reads that the byte count leaves out;
+//   - the roofs are plain C at the compiler's baseline ISA, so in cache,
+//     where they are not memory-bound, the AVX2/NEON kernels can beat them;
+//   - one thread's memory bandwidth grows with the number of streams it
+//     reads at once, so dot (two) can pass the one-stream sum.
+//
+//   make bench
+//   ./build/bench --max 67108864 --threads 8 > roofline.csv
+//
+// Sizes go from --min to --max floats per array, by 4x. Every thread
+// streams its own contiguous slice (touched first by that thread, too);
+// rates count each array element read or written once, and come from the
+// best of at least five calls, as STREAM reports them. Each result is
+// then checked exactly against the inputs, chosen so no step rounds.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vecops.h"
+
+#define MAX_THREADS 256
+#define TRIAD_Q 3.0f   // STREAM's scalar
+
+enum { INIT, STREAM_COPY, STREAM_TRIAD, STREAM_SUM, ADD, AXPY, FMA, SUM, DOT, KERNELS };
+
+// The roofs first: the others are measured against them
+static const int order[] = { STREAM_TRIAD, STREAM_SUM, STREAM_COPY, ADD, AXPY, FMA, SUM, DOT };
+
+// Floats moved and flops per element
+static const struct { const char *name; int words, flops; } kernels[KERNELS] = {
+    [INIT] = { "init", 4, 0 },
+    [STREAM_COPY] = { "stream_copy", 2, 0 },  [STREAM_TRIAD] = { "stream_triad", 3, 2 },
+    [STREAM_SUM] = { "stream_sum", 1, 1 },
+    [ADD] = { "add", 3, 1 },                  [AXPY] = { "axpy", 3, 2 },
+    [FMA] = { "fma", 4, 2 },                  [SUM] = { "sum", 1, 1 },
+    [DOT] = { "dot", 2, 2 },
+};
+
+// ------------------------------------------------------------
+// STREAM's loops, as plain C, vectorized by the compiler the way STREAM
+// is usually built (clang does at -O2; gcc's -O2 cost model leaves them)
+// ------------------------------------------------------------
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define STREAM_OPT __attribute__((optimize("O3")))
+#else
+#define STREAM_OPT
+#endif
+
+STREAM_OPT static void stream_copy(const float *restrict a, float *restrict c, long n) {
+    for (long i = 0; i < n; i++) c[i] = a[i];
+}
+
+STREAM_OPT static void stream_triad(const float *restrict b, const float *restrict c, float *restrict a,
+                                    float q, long n) {
+    for (long i = 0; i < n; i++) a[i] = b[i] + q * c[i];
+}
+
+// Read-only roof: 32 independent float sums, so the adds vectorize
+// without reassociating and keep several vectors in flight; each block
+// of 4096 goes into a double, so the checked total stays exact
+STREAM_OPT static double stream_sum(const float *restrict a, long n) {
+    double total = 0.0;
+    for (long i0 = 0; i0 < n; i0 += 4096) {
+        long i = i0, i1 = i0 + 4096 < n ? i0 + 4096 : n;
+        float acc[32] = { 0 };
+        for (; i + 32 <= i1; i += 32)
+            for (int j = 0; j < 32; j++) acc[j] += a[i + j];
+        for (; i < i1; i++) acc[0] += a[i];
+        for (int j = 0; j < 32; j++) total += acc[j];
+    }
+    return total;
+}
+
+// ------------------------------------------------------------
+// A team of threads, each running the current kernel on its slice
+// ------------------------------------------------------------
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count, waiting;
+    unsigned generation;
+} Barrier;
+
+static void barrier_wait(Barrier *b) {
+    pthread_mutex_lock(&b->lock);
+    unsigned gen = b->generation;
+    if (++b->waiting == b->count) {
+        b->waiting = 0;
+        b->generation++;
+        pthread_cond_broadcast(&b->cond);
+    } else {
+        while (gen == b->generation) pthread_cond_wait(&b->cond, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+static struct {
+    Barrier start, done;
+    int threads;
+    int kernel;            // -1: return
+    long n;
+    float *a, *b, *c, *d;  // d is every kernel's output
+    double partial[MAX_THREADS];
+} team = {
+    .start = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0 },
+    .done = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0 },
+};
+
+// Exactly representable inputs: sums and products of them stay exact
+static float value_a(long i) { return (float)(i % 9) * 0.125f; }
+static float value_b(long i) { return 1.0f - (float)(i % 5) * 0.25f; }
+static float value_c(long i) { (void)i; return 0.5f; }
+
+static void run_slice(int t) {
+    // Slices of whole 64-byte lines, so no two threads write one line
+    long per = (team.n + team.threads - 1) / team.threads;
+    per = (per + 15) / 16 * 16;
+    long lo = per * t < team.n ? per * t : team.n, hi = lo + per < team.n ? lo + per : team.n, n = hi - lo;
+    float *a = team.a + lo, *b = team.b + lo, *c = team.c + lo, *d = team.d + lo;
+    switch (team.kernel) {
+    case INIT:
+        for (long i = 0; i < n; i++) {
+            a[i] = value_a(lo + i);
+            b[i] = value_b(lo + i);
+            c[i] = value_c(lo + i);
+            d[i] = 0.0f;
+        }
+        break;
+    case STREAM_COPY: stream_copy(a, d, n); break;
+    case STREAM_TRIAD: stream_triad(b, c, d, TRIAD_Q, n); break;
+    case STREAM_SUM: team.partial[t] = stream_sum(a, n); break;
+    case ADD: vec_add(a, b, d, n); break;
+    case AXPY: vec_axpy(0.5f, a, d, n); break;
+    case FMA: vec_fma(a, b, c, d, n); break;
+    case SUM: team.partial[t] = vec_sum(a, n); break;
+    case DOT: team.partial[t] = vec_dot(a, b, n); break;
+    }
+}
+
+static void *worker(void *arg) {
+    int t = (int)(long)arg;
+    for (;;) {
+        barrier_wait(&team.start);
+        if (team.kernel < 0) return NULL;
+        run_slice(t);
+        barrier_wait(&team.done);
+    }
+}
+
+// One call of kernel k over n elements on every thread; the reduction's
+// total (0 for the others)
+static double team_run(int k, long n) {
+    team.kernel = k;
+    team.n = n;
+    barrier_wait(&team.start);
+    run_slice(0);
+    barrier_wait(&team.done);
+    double total = 0.0;
+    if (k == SUM || k == DOT || k == STREAM_SUM)
+        for (int t = 0; t < team.threads; t++) total += team.partial[t];
+    return total;
+}
+
+static void team_stop(void) {
+    team.kernel = -1;
+    barrier_wait(&team.start);
+}
+
+// ------------------------------------------------------------
+// Checks against the inputs (d as the last call left it)
+// ------------------------------------------------------------
+
+static int check(int k, long n, double total) {
+    double expect = 0.0;
+    for (long i = 0; i < n; i++) {
+        float a = value_a(i), b = value_b(i), c = value_c(i), want;
+        switch (k) {
+        case STREAM_COPY: want = a; break;
+        case STREAM_TRIAD: want = b + TRIAD_Q * c; break;
+        case ADD: want = a + b; break;
+        case AXPY: want = 0.5f * a + c; break;
+        case FMA: want = a * b + c; break;
+        case SUM: case STREAM_SUM: expect += a; continue;
+        case DOT: expect += (double)a * b; continue;
+        default: return 1;
+        }
+        if (team.d[i] != want) return 0;
+    }
+    return (k != SUM && k != DOT && k != STREAM_SUM) || total == expect;
+}
+
+// ------------------------------------------------------------
+// Driver
+// ------------------------------------------------------------
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static float *xalloc(long n) {
+    void *p = NULL;
+    if (posix_memalign(&p, 64, sizeof(float) * (n ? n : 1)) != 0) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--min N] [--max N] [--threads T] [--reps R] [--budget SECONDS]\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    long min_n = 1L << 12, max_n = 1L << 24;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN), max_reps = 1000;
+    double budget = 0.5;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (!strcmp(argv[i], "--min")) min_n = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--max")) max_n = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--reps")) max_reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--budget")) budget = atof(argv[++i]);
+        else usage(argv[0]);
+    }
+    if (min_n < 1 || max_n < min_n || max_reps < 5) usage(argv[0]);
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    team.threads = threads;
+    team.start.count = team.done.count = threads;
+    team.a = xalloc(max_n);
+    team.b = xalloc(max_n);
+    team.c = xalloc(max_n);
+    team.d = xalloc(max_n);
+    for (int t = 1; t < threads; t++) {
+        pthread_t id;
+        if (pthread_create(&id, NULL, worker, (void *)(long)t) != 0) {
+            fprintf(stderr, "Failed to start thread %d.\n", t);
+            return 1;
+        }
+        pthread_detach(id);
+    }
+    team_run(INIT, max_n);
+
+    double *times = malloc(sizeof(double) * max_reps);
+    int failures = 0;
+    fprintf(stderr, "CPU kernels: %s, %d thread%s\n", vec_isa(), threads, threads == 1 ? "" : "s");
+    printf("kernel,isa,threads,n,bytes,calls,min_ms,p50_ms,gbps,gflops,flops_per_byte,stream_gbps,roof_pct,ok\n");
+    for (long n = min_n; n <= max_n; n *= 4) {
+        double triad_gbps = 0.0, read_gbps = 0.0;
+        for (size_t o = 0; o < sizeof(order) / sizeof(order[0]); o++) {
+            int k = order[o];
+            double bytes = (double)kernels[k].words * sizeof(float) * n;
+            team_run(k, n);   // warm-up
+            int calls = 0;
+            double start = now_seconds();
+            while (calls < max_reps && (calls < 5 || now_seconds() - start < budget)) {
+                double t = now_seconds();
+                team_run(k, n);
+                times[calls++] = now_seconds() - t;
+            }
+            qsort(times, calls, sizeof(double), cmp_double);
+
+            // A fresh call for the check: axpy has been accumulating into d
+            if (k == AXPY) memcpy(team.d, team.c, sizeof(float) * n);
+            int ok = check(k, n, team_run(k, n));
+            failures += !ok;
+
+            double gbps = bytes / times[0] / 1e9;
+            if (k == STREAM_TRIAD) triad_gbps = gbps;
+            if (k == STREAM_SUM) read_gbps = gbps;
+            double stream_gbps = k == SUM || k == DOT || k == STREAM_SUM ? read_gbps : triad_gbps;
+            printf("%s,%s,%d,%ld,%.0f,%d,%.4f,%.4f,%.2f,%.2f,%.3f,%.2f,%.1f,%s\n",
+                   kernels[k].name, k <= STREAM_SUM ? "c" : vec_isa(), threads, n,
+                   bytes, calls, times[0] * 1e3, times[calls / 2] * 1e3, gbps,
+                   (double)kernels[k].flops * n / times[0] / 1e9,
+                   kernels[k].flops / (kernels[k].words * (double)sizeof(float)), stream_gbps,
+                   100.0 * gbps / stream_gbps, ok ? "yes" : "NO");
+            fflush(stdout);
+        }
+    }
+
+    team_stop();
+    free(times);
+    if (failures) fprintf(stderr, "❌  %d result%s wrong.\n", failures, failures == 1 ? "" : "s");
+    return failures != 0;
+}
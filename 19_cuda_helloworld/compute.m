@@ -0,0 +1,150 @@
+#include <stdio.h>
+
+#include "compute.h"
+
+#define POOL_BUFFERS 8   // spare buffers kept; the oldest goes first
+
+static id<MTLDevice> device;
+static id<MTLCommandQueue> queue;
+static id<MTLLibrary> library;
+static NSMutableDictionary<NSString *, id<MTLComputePipelineState>> *pipelines;
+static NSMutableArray<id<MTLBuffer>> *spare;
+
+int compute_open(const char *metallib_path) {
+    if (library) return 0;
+
+    id<MTLDevice> dev = MTLCreateSystemDefaultDevice();
+    if (!dev) {
+        NSArray *allDevices = MTLCopyAllDevices();
+        if ([allDevices count] > 0) dev = [allDevices objectAtIndex:0];
+    }
+    if (!dev) {
+        fprintf(stderr, "❌  No usable Metal device available.\n");
+        return 1;
+    }
+
+    NSError *err = nil;
+    id<MTLLibrary> lib = [dev newLibraryWithFile:@(metallib_path) error:&err];
+    if (!lib) {
+        fprintf(stderr, "❌  Failed to load %s: %s\n", metallib_path,
+                err ? err.localizedDescription.UTF8String : "(unknown error)");
+        return 1;
+    }
+
+    id<MTLCommandQueue> q = [dev newCommandQueue];
+    if (!q) {
+        fprintf(stderr, "❌  Failed to create command queue.\n");
+        return 1;
+    }
+
+    device = dev;
+    queue = q;
+    library = lib;
+    pipelines = [NSMutableDictionary dictionary];
+    spare = [NSMutableArray array];
+    return 0;
+}
+
+id<MTLDevice> compute_device(void) {
+    return device;
+}
+
+id<MTLComputePipelineState> compute_pipeline(const char *kernel) {
+    NSString *key = @(kernel);
+    id<MTLComputePipelineState> pso = pipelines[key];
+    if (pso) return pso;
+
+    id<MTLFunction> fn = [library newFunctionWithName:key];
+    if (!fn) {
+        fprintf(stderr, "❌  Kernel function '%s' not found.\n", kernel);
+        return nil;
+    }
+    NSError *err = nil;
+    pso = [device newComputePipelineStateWithFunction:fn error:&err];
+    if (!pso) {
+        fprintf(stderr, "❌  Failed to create compute pipeline for '%s': %s\n", kernel,
+                err ? err.localizedDescription.UTF8String : "(unknown)");
+        return nil;
+    }
+    pipelines[key] = pso;
+    return pso;
+}
+
+id<MTLBuffer> compute_buffer(size_t bytes) {
+    if (bytes < 4) bytes = 4;   // Metal rejects zero-length buffers
+
+    // Smallest spare one that fits
+    NSUInteger best = NSNotFound;
+    for (NSUInteger i = 0; i < spare.count; i++)
+        if (spare[i].length >= bytes && (best == NSNotFound || spare[i].length < spare[best].length))
+            best = i;
+    if (best != NSNotFound) {
+        id<MTLBuffer> buf = spare[best];
+        [spare removeObjectAtIndex:best];
+        return buf;
+    }
+
+    id<MTLBuffer> buf = [device newBufferWithLength:bytes options:MTLResourceStorageModeShared];
+    if (!buf) fprintf(stderr, "❌  Failed to create a %zu-byte buffer.\n", bytes);
+    return buf;
+}
+
+void compute_recycle(id<MTLBuffer> buffer) {
+    if (!buffer) return;
+    [spare addObject:buffer];
+    if (spare.count > POOL_BUFFERS) [spare removeObjectAtIndex:0];
+}
+
+// Encode one dispatch, commit it and wait: `size` threads in groups of
+// `group` (dispatchThreads), or with whole_groups `size` groups of them
+static int dispatch(id<MTLComputePipelineState> pso, NSArray<id<MTLBuffer>> *buffers,
+                    const void *params, size_t params_size,
+                    MTLSize size, MTLSize group, int whole_groups, size_t threadgroup_bytes) {
+    @autoreleasepool {
+        id<MTLCommandBuffer> cb = [queue commandBuffer];
+        id<MTLComputeCommandEncoder> enc = [cb computeCommandEncoder];
+        if (!cb || !enc) {
+            fprintf(stderr, "❌  Failed to create command buffer or encoder.\n");
+            return 1;
+        }
+
+        [enc setComputePipelineState:pso];
+        for (NSUInteger i = 0; i < buffers.count; i++)
+            [enc setBuffer:buffers[i] offset:0 atIndex:i];
+        if (params)
+            [enc setBytes:params length:params_size atIndex:buffers.count];
+        if (threadgroup_bytes)
+            [enc setThreadgroupMemoryLength:threadgroup_bytes atIndex:0];
+
+        if (whole_groups)
+            [enc dispatchThreadgroups:size threadsPerThreadgroup:group];
+        else
+            [enc dispatchThreads:size threadsPerThreadgroup:group];
+        [enc endEncoding];
+
+        [cb commit];
+        [cb waitUntilCompleted];
+        if (cb.status != MTLCommandBufferStatusCompleted) {
+            fprintf(stderr, "❌  Command buffer failed: %s\n",
+                    cb.error ? cb.error.localizedDescription.UTF8String : "(unknown)");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int compute_run(id<MTLComputePipelineState> pso, NSArray<id<MTLBuffer>> *buffers,
+                const void *params, size_t params_size, size_t threads) {
+    if (!threads) return 0;
+    NSUInteger width = pso.maxTotalThreadsPerThreadgroup;
+    if (width > threads) width = threads;
+    return dispatch(pso, buffers, params, params_size, MTLSizeMake(threads, 1, 1),
+                    MTLSizeMake(width, 1, 1), 0, 0);
+}
+
+int compute_run_groups(id<MTLComputePipelineState> pso, NSArray<id<MTLBuffer>> *buffers,
+                       const void *params, size_t params_size,
+                       MTLSize groups, MTLSize group, size_t threadgroup_bytes) {
+    if (!groups.width || !groups.height || !groups.depth) return 0;
+    return dispatch(pso, buffers, params, params_size, groups, group, 1, threadgroup_bytes);
+}
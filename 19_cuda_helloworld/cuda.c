@@ -1,43 +1,59 @@
 #include <stdio.h>
+#include <stdlib.h>
 
-// Kernel runs on GPU
-__global__ void add(int *a, int *b, int *c) {
-    int i = threadIdx.x;
-    c[i] = a[i] + b[i];
+#include "vecops.h"
+
+#define N (1 << 20)
+
+// Kernel runs on GPU: one thread per element, the last block partly idle
+__global__ void add(const float *a, const float *b, float *c, int n) {
+    int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i < n) c[i] = a[i] + b[i];
 }
 
 int main() {
-    int a[3] = {1, 2, 3};
-    int b[3] = {4, 5, 6};
-    int c[3] = {0, 0, 0};
-    
-    int *d_a, *d_b, *d_c;  // Device pointers
-    int size = 3 * sizeof(int);
-    
+    float *a = (float *)malloc(N * sizeof(float));
+    float *b = (float *)malloc(N * sizeof(float));
+    float *c = (float *)malloc(N * sizeof(float));
+    float *ref = (float *)malloc(N * sizeof(float));
+    for (int i = 0; i < N; i++) {
+        a[i] = (float)i;
+        b[i] = 0.5f * i;
+    }
+
+    float *d_a, *d_b, *d_c;  // Device pointers
+    size_t size = N * sizeof(float);
+
     // Allocate GPU memory
     cudaMalloc(&d_a, size);
     cudaMalloc(&d_b, size);
     cudaMalloc(&d_c, size);
-    
+
     // Copy data to GPU
     cudaMemcpy(d_a, a, size, cudaMemcpyHostToDevice);
     cudaMemcpy(d_b, b, size, cudaMemcpyHostToDevice);
-    
-    // Run kernel with 1 block, 3 threads
-    add<<<1, 3>>>(d_a, d_b, d_c);
-    
+
+    // Run kernel with 256 threads per block, enough blocks to cover N
+    add<<<(N + 255) / 256, 256>>>(d_a, d_b, d_c, N);
+
     // Copy result back to CPU
     cudaMemcpy(c, d_c, size, cudaMemcpyDeviceToHost);
-    
-    printf("Results: %d %d %d\n", c[0], c[1], c[2]);
-    
+
+    // Same sum on the CPU (vecops.c); both round once, so they match exactly
+    vec_add(a, b, ref, N);
+    int bad = 0;
+    for (int i = 0; i < N; i++) bad += c[i] != ref[i];
+    printf("Results: %g %g %g ... %g (%d of %d differ from the CPU's %s add)\n",
+           c[0], c[1], c[2], c[N - 1], bad, N, vec_isa());
+
     // Free GPU memory
     cudaFree(d_a);
     cudaFree(d_b);
     cudaFree(d_c);
-    
-    return 0;
+    free(a); free(b); free(c); free(ref);
+
+    return bad != 0;
 }
 
-// Compile with: nvcc -o hello_cuda hello.cu
-// Requires: NVIDIA GPU + CUDA toolkit
\ No newline at end of file
+// Compile with: cc -O2 -c vecops.c && nvcc -x cu -o hello_cuda cuda.c vecops.o
+// Requires: NVIDIA GPU + CUDA toolkit
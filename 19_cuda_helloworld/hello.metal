@@ -9,3 +9,52 @@ kernel void hello(device char *out [[buffer(0)]],
             out[i] = msg[i];
     }
 }
+
+// Element-wise kernels, one thread per element (compute_run dispatches
+// exactly n threads); vecops.c has the CPU versions they are checked against
+
+kernel void add(device const float *a [[buffer(0)]],
+                device const float *b [[buffer(1)]],
+                device float *c       [[buffer(2)]],
+                uint i [[thread_position_in_grid]]) {
+    c[i] = a[i] + b[i];
+}
+
+kernel void axpy(device const float *x [[buffer(0)]],
+                 device float *y       [[buffer(1)]],
+                 constant float &alpha [[buffer(2)]],
+                 uint i [[thread_position_in_grid]]) {
+    y[i] = fma(alpha, x[i], y[i]);
+}
+
+kernel void fma3(device const float *a [[buffer(0)]],
+                 device const float *b [[buffer(1)]],
+                 device const float *c [[buffer(2)]],
+                 device float *d       [[buffer(3)]],
+                 uint i [[thread_position_in_grid]]) {
+    d[i] = fma(a[i], b[i], c[i]);
+}
+
+// Reductions in two steps: thread t sums elements t, t + T, t + 2T, ...
+// of the n (T threads in the grid, so neighbours read neighbouring
+// elements), and the host adds the T partial sums
+kernel void sum_partial(device const float *a   [[buffer(0)]],
+                        device float *partial   [[buffer(1)]],
+                        constant uint &n        [[buffer(2)]],
+                        uint t [[thread_position_in_grid]],
+                        uint T [[threads_per_grid]]) {
+    float s = 0.0f;
+    for (uint i = t; i < n; i += T) s += a[i];
+    partial[t] = s;
+}
+
+kernel void dot_partial(device const float *a   [[buffer(0)]],
+                        device const float *b   [[buffer(1)]],
+                        device float *partial   [[buffer(2)]],
+                        constant uint &n        [[buffer(3)]],
+                        uint t [[thread_position_in_grid]],
+                        uint T [[threads_per_grid]]) {
+    float s = 0.0f;
+    for (uint i = t; i < n; i += T) s = fma(a[i], b[i], s);
+    partial[t] = s;
+}
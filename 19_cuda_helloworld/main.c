@@ -1,8 +1,68 @@
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <Metal/Metal.h>
 
+#include "compute.h"
+#include "vecops.h"
+
+#define PARTIALS 16384   // GPU threads in a reduction, each summing a strided share
+#define REPS 10          // timed calls per kernel; the best is reported
+
+enum { ADD, AXPY, FMA, SUM, DOT, OPS };
+static const char *const op_names[OPS] = { "add", "axpy", "fma", "sum", "dot" };
+static const char *const op_kernels[OPS] = { "add", "axpy", "fma3", "sum_partial", "dot_partial" };
+static const int op_words[OPS] = { 3, 3, 4, 1, 2 };   // floats moved per element
+static const float alpha = 0.5f;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// One call of op over n elements on the CPU: d is the output (y for
+// axpy); the reductions return their total
+static double cpu_op(int op, const float *a, const float *b, const float *c, float *d, long n) {
+    switch (op) {
+    case ADD: vec_add(a, b, d, n); break;
+    case AXPY: vec_axpy(alpha, a, d, n); break;
+    case FMA: vec_fma(a, b, c, d, n); break;
+    case SUM: return vec_sum(a, n);
+    case DOT: return vec_dot(a, b, n);
+    }
+    return 0.0;
+}
+
+// The same on the GPU, *total from the partial sums; returns 0 or 1
+static int gpu_op(int op, id<MTLBuffer> a, id<MTLBuffer> b, id<MTLBuffer> c, id<MTLBuffer> d,
+                  id<MTLBuffer> partial, long n, double *total) {
+    id<MTLComputePipelineState> pso = compute_pipeline(op_kernels[op]);
+    if (!pso)
+        return 1;
+    uint32_t count = (uint32_t)n;
+    size_t parts = n < PARTIALS ? n : PARTIALS;
+    int err;
+    switch (op) {
+    case ADD: err = compute_run(pso, @[a, b, d], NULL, 0, n); break;
+    case AXPY: err = compute_run(pso, @[a, d], &alpha, sizeof(alpha), n); break;
+    case FMA: err = compute_run(pso, @[a, b, c, d], NULL, 0, n); break;
+    case SUM: err = compute_run(pso, @[a, partial], &count, sizeof(count), parts); break;
+    default: err = compute_run(pso, @[a, b, partial], &count, sizeof(count), parts); break;
+    }
+    *total = 0.0;
+    if (!err && (op == SUM || op == DOT)) {
+        const float *p = (const float *)partial.contents;
+        for (size_t t = 0; t < parts; t++)
+            *total += p[t];
+    }
+    return err;
+}
+
 int main(void) {
     @autoreleasepool {
         printf("=== Metal Hello Debug ===\n");
@@ -24,113 +84,129 @@ int main(void) {
         }
 
         // ------------------------------------------------------------
-        // 2. Try to get the system default device first
+        // 2. Device, command queue (like a CUDA stream) and library, kept
+        //    for every dispatch below (compute.m)
         // ------------------------------------------------------------
-        id<MTLDevice> device = MTLCreateSystemDefaultDevice();
-        if (!device && count > 0) {
+        if (!MTLCreateSystemDefaultDevice() && count > 0)
             printf("⚙️  MTLCreateSystemDefaultDevice() returned nil; "
                    "falling back to first enumerated device.\n");
-            device = [allDevices objectAtIndex:0];
-        }
-
-        if (!device) {
-            fprintf(stderr, "❌  No usable Metal device available.\n");
-            return 1;
-        }
-
-        printf("✅ Using device: %s\n", device.name.UTF8String);
-
-        // ------------------------------------------------------------
-        // 3. Create a command queue (like a CUDA stream)
-        // ------------------------------------------------------------
-        id<MTLCommandQueue> queue = [device newCommandQueue];
-        if (!queue) {
-            fprintf(stderr, "❌  Failed to create command queue.\n");
-            return 1;
-        }
-        printf("✅ Command queue created.\n");
-
-        // ------------------------------------------------------------
-        // 4. Load compiled Metal library (.metallib)
-        // ------------------------------------------------------------
-        NSError *err = nil;
-        id<MTLLibrary> lib = [device newLibraryWithFile:@"build/hello.metallib" error:&err];
-        if (!lib) {
-            fprintf(stderr, "❌  Failed to load build/hello.metallib: %s\n",
-                    err ? err.localizedDescription.UTF8String : "(unknown error)");
-            return 1;
-        }
-        printf("✅ Library loaded successfully.\n");
-
-        // ------------------------------------------------------------
-        // 5. Load kernel function "hello"
-        // ------------------------------------------------------------
-        id<MTLFunction> fn = [lib newFunctionWithName:@"hello"];
-        if (!fn) {
-            fprintf(stderr, "❌  Kernel function 'hello' not found.\n");
+        if (compute_open("build/hello.metallib") != 0)
             return 1;
-        }
-        printf("✅ Kernel function 'hello' found.\n");
+        printf("✅ Using device: %s\n", compute_device().name.UTF8String);
+        printf("✅ Command queue created, library loaded.\n");
 
         // ------------------------------------------------------------
-        // 6. Create compute pipeline
-        // ------------------------------------------------------------
-        id<MTLComputePipelineState> pso = [device newComputePipelineStateWithFunction:fn error:&err];
-        if (!pso) {
-            fprintf(stderr, "❌  Failed to create compute pipeline: %s\n",
-                    err ? err.localizedDescription.UTF8String : "(unknown)");
-            return 1;
-        }
-        printf("✅ Compute pipeline ready.\n");
-
-        // ------------------------------------------------------------
-        // 7. Allocate output buffer (shared memory)
+        // 3. Dispatch "hello" a few times: the first call builds the
+        //    pipeline and the buffer, the others reuse both
         // ------------------------------------------------------------
         const size_t bufSize = 256;
-        id<MTLBuffer> buf = [device newBufferWithLength:bufSize options:MTLResourceStorageModeShared];
-        if (!buf) {
-            fprintf(stderr, "❌  Failed to create buffer.\n");
-            return 1;
+        for (int run = 0; run < 3; run++) {
+            double t0 = now_ms();
+            id<MTLComputePipelineState> pso = compute_pipeline("hello");
+            if (!pso)
+                return 1;
+            id<MTLBuffer> buf = compute_buffer(bufSize);
+            if (!buf)
+                return 1;
+            memset(buf.contents, 0, bufSize);   // pooled buffers keep old contents
+
+            if (compute_run(pso, @[buf], NULL, 0, 1) != 0)
+                return 1;
+            double t1 = now_ms();
+
+            // ------------------------------------------------------------
+            // 4. Read the result
+            // ------------------------------------------------------------
+            const char *result = (const char *)buf.contents;
+            if (result && result[0])
+                printf("🚀 Dispatch %d: %.3f ms, result buffer: \"%s\"\n", run + 1, t1 - t0, result);
+            else
+                printf("⚠️  Dispatch %d: result buffer empty or not written.\n", run + 1);
+            compute_recycle(buf);
         }
-        printf("✅ Shared buffer created (%zu bytes).\n", bufSize);
 
         // ------------------------------------------------------------
-        // 8. Create and encode command buffer
-        // ------------------------------------------------------------
-        id<MTLCommandBuffer> cb = [queue commandBuffer];
-        if (!cb) {
-            fprintf(stderr, "❌  Failed to create command buffer.\n");
-            return 1;
+        // 5. Element-wise kernels on the GPU against the CPU ones in
+        //    vecops.c: the same results, and the time each takes. GPU
+        //    times include encoding the dispatch and waiting for it, the
+        //    price of offloading one call.
+        // ------------------------------------------------------------
+        printf("Element-wise kernels, GPU against CPU (%s), best of %d:\n", vec_isa(), REPS);
+        const long sizes[] = { 1L << 12, 1L << 24 };
+        int failures = 0;
+        for (int s = 0; s < 2; s++) {
+            long n = sizes[s];
+            size_t bytes = sizeof(float) * n;
+            id<MTLBuffer> ga = compute_buffer(bytes), gb = compute_buffer(bytes), gc = compute_buffer(bytes);
+            id<MTLBuffer> gd = compute_buffer(bytes), gp = compute_buffer(sizeof(float) * PARTIALS);
+            float *ref = malloc(bytes);
+            if (!ga || !gb || !gc || !gd || !gp || !ref)
+                return 1;
+            float *a = (float *)ga.contents, *b = (float *)gb.contents, *c = (float *)gc.contents;
+            float *d = (float *)gd.contents;
+            for (long i = 0; i < n; i++) {
+                a[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+                b[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+                c[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+            }
+
+            for (int op = 0; op < OPS; op++) {
+                // Results from fresh outputs first (axpy accumulates into them)
+                memcpy(ref, c, bytes);
+                memcpy(d, c, bytes);
+                double cpu_total = cpu_op(op, a, b, c, ref, n), gpu_total;
+                if (gpu_op(op, ga, gb, gc, gd, gp, n, &gpu_total) != 0)
+                    return 1;
+
+                // Element-wise: both round each result once, so they agree to
+                // an ulp. Sums: within the error bound of the longest float
+                // chain (VEC_BLOCK on the CPU, n / PARTIALS per GPU thread).
+                double err = 0.0, bound = FLT_EPSILON;
+                if (op == SUM || op == DOT) {
+                    double exact = 0.0, mag = 0.0;
+                    for (long i = 0; i < n; i++) {
+                        double term = op == SUM ? a[i] : (double)a[i] * b[i];
+                        exact += term;
+                        mag += fabs(term);
+                    }
+                    long chain = n / PARTIALS > VEC_BLOCK ? n / PARTIALS : VEC_BLOCK;
+                    err = fmax(fabs(cpu_total - exact), fabs(gpu_total - exact)) / mag;
+                    bound = (chain + 2) * FLT_EPSILON;
+                } else {
+                    for (long i = 0; i < n; i++)
+                        if (ref[i] != 0.0f)
+                            err = fmax(err, fabs(d[i] - ref[i]) / fabs(ref[i]));
+                }
+
+                double cpu_ms = INFINITY, gpu_ms = INFINITY;
+                for (int r = 0; r < REPS; r++) {
+                    double t0 = now_ms();
+                    cpu_op(op, a, b, c, ref, n);
+                    double t1 = now_ms();
+                    if (gpu_op(op, ga, gb, gc, gd, gp, n, &gpu_total) != 0)
+                        return 1;
+                    double t2 = now_ms();
+                    cpu_ms = fmin(cpu_ms, t1 - t0);
+                    gpu_ms = fmin(gpu_ms, t2 - t1);
+                }
+                double mb = op_words[op] * (double)bytes / 1e6;   // MB / ms = GB/s
+                printf("  %-4s n=%-9ld CPU %8.3f ms %6.1f GB/s   GPU %8.3f ms %6.1f GB/s   error %.1e %s\n",
+                       op_names[op], n, cpu_ms, mb / cpu_ms, gpu_ms, mb / gpu_ms, err,
+                       err <= bound ? "✅" : "❌");
+                failures += err > bound;
+            }
+            compute_recycle(ga);
+            compute_recycle(gb);
+            compute_recycle(gc);
+            compute_recycle(gd);
+            compute_recycle(gp);
+            free(ref);
         }
-
-        id<MTLComputeCommandEncoder> enc = [cb computeCommandEncoder];
-        if (!enc) {
-            fprintf(stderr, "❌  Failed to create compute encoder.\n");
+        if (failures) {
+            printf("❌  %d GPU result%s differ from the CPU's.\n", failures, failures == 1 ? "" : "s");
             return 1;
         }
 
-        [enc setComputePipelineState:pso];
-        [enc setBuffer:buf offset:0 atIndex:0];
-
-        MTLSize threadsPerGrid = MTLSizeMake(1, 1, 1);
-        MTLSize threadsPerTG   = MTLSizeMake(1, 1, 1);
-        [enc dispatchThreads:threadsPerGrid threadsPerThreadgroup:threadsPerTG];
-        [enc endEncoding];
-
-        printf("🚀 Dispatching GPU work...\n");
-        [cb commit];
-        [cb waitUntilCompleted];
-        printf("✅ GPU work completed.\n");
-
-        // ------------------------------------------------------------
-        // 9. Read the result
-        // ------------------------------------------------------------
-        const char *result = (const char *)buf.contents;
-        if (result && result[0])
-            printf("Result buffer: \"%s\"\n", result);
-        else
-            printf("⚠️  Result buffer empty or not written.\n");
-
         printf("=== Metal Hello Complete ===\n");
     }
 
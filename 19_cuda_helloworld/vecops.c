@@ -0,0 +1,260 @@
+// CPU element-wise kernels (vecops.h): a scalar set and a SIMD set, the
+// one to use picked once per process.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vecops.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(VEC_NO_SIMD)
+#define VEC_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && !defined(VEC_NO_SIMD)
+#define VEC_NEON
+#include <arm_neon.h>
+#endif
+
+typedef struct {
+    const char *name;
+    void (*add)(const float *a, const float *b, float *c, long n);
+    void (*axpy)(float alpha, const float *x, float *y, long n);
+    void (*fma)(const float *a, const float *b, const float *c, float *d, long n);
+    float (*sum)(const float *a, long n);                  // n <= VEC_BLOCK
+    float (*dot)(const float *a, const float *b, long n);  // n <= VEC_BLOCK
+} VecOps;
+
+// ------------------------------------------------------------
+// Scalar
+// ------------------------------------------------------------
+
+static void add_scalar(const float *a, const float *b, float *c, long n) {
+    for (long i = 0; i < n; i++) c[i] = a[i] + b[i];
+}
+
+static void axpy_scalar(float alpha, const float *x, float *y, long n) {
+    for (long i = 0; i < n; i++) y[i] = alpha * x[i] + y[i];
+}
+
+static void fma_scalar(const float *a, const float *b, const float *c, float *d, long n) {
+    for (long i = 0; i < n; i++) d[i] = fmaf(a[i], b[i], c[i]);
+}
+
+static float sum_scalar(const float *a, long n) {
+    float s = 0.0f;
+    for (long i = 0; i < n; i++) s += a[i];
+    return s;
+}
+
+static float dot_scalar(const float *a, const float *b, long n) {
+    float s = 0.0f;
+    for (long i = 0; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+static const VecOps ops_scalar = { "scalar", add_scalar, axpy_scalar, fma_scalar, sum_scalar, dot_scalar };
+
+// ------------------------------------------------------------
+// AVX2 + FMA: four 8-float registers per step, so loads of the next
+// ones overlap the adds, then 8 at a time, then the scalar tail
+// ------------------------------------------------------------
+
+#ifdef VEC_X86
+#define X86_TARGET __attribute__((target("avx2,fma")))
+
+X86_TARGET static void add_avx2(const float *a, const float *b, float *c, long n) {
+    long i = 0;
+    for (; i + 32 <= n; i += 32)
+        for (int k = 0; k < 32; k += 8)
+            _mm256_storeu_ps(c + i + k, _mm256_add_ps(_mm256_loadu_ps(a + i + k), _mm256_loadu_ps(b + i + k)));
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(c + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    for (; i < n; i++) c[i] = a[i] + b[i];
+}
+
+X86_TARGET static void axpy_avx2(float alpha, const float *x, float *y, long n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    long i = 0;
+    for (; i + 32 <= n; i += 32)
+        for (int k = 0; k < 32; k += 8)
+            _mm256_storeu_ps(y + i + k, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + k), _mm256_loadu_ps(y + i + k)));
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    for (; i < n; i++) y[i] = fmaf(alpha, x[i], y[i]);
+}
+
+X86_TARGET static void fma_avx2(const float *a, const float *b, const float *c, float *d, long n) {
+    long i = 0;
+    for (; i + 32 <= n; i += 32)
+        for (int k = 0; k < 32; k += 8)
+            _mm256_storeu_ps(d + i + k, _mm256_fmadd_ps(_mm256_loadu_ps(a + i + k), _mm256_loadu_ps(b + i + k),
+                                                        _mm256_loadu_ps(c + i + k)));
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(d + i, _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i)));
+    for (; i < n; i++) d[i] = fmaf(a[i], b[i], c[i]);
+}
+
+X86_TARGET static float hsum_avx2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+X86_TARGET static float sum_avx2(const float *a, long n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    long i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm256_add_ps(s0, _mm256_loadu_ps(a + i));
+        s1 = _mm256_add_ps(s1, _mm256_loadu_ps(a + i + 8));
+        s2 = _mm256_add_ps(s2, _mm256_loadu_ps(a + i + 16));
+        s3 = _mm256_add_ps(s3, _mm256_loadu_ps(a + i + 24));
+    }
+    for (; i + 8 <= n; i += 8) s0 = _mm256_add_ps(s0, _mm256_loadu_ps(a + i));
+    float s = hsum_avx2(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+    for (; i < n; i++) s += a[i];
+    return s;
+}
+
+X86_TARGET static float dot_avx2(const float *a, const float *b, long n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    long i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8) s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+    float s = hsum_avx2(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+static const VecOps ops_avx2 = { "avx2+fma", add_avx2, axpy_avx2, fma_avx2, sum_avx2, dot_avx2 };
+#endif
+
+// ------------------------------------------------------------
+// NEON (every arm64 CPU has it): the same shape with 4-float registers
+// ------------------------------------------------------------
+
+#ifdef VEC_NEON
+static void add_neon(const float *a, const float *b, float *c, long n) {
+    long i = 0;
+    for (; i + 16 <= n; i += 16)
+        for (int k = 0; k < 16; k += 4)
+            vst1q_f32(c + i + k, vaddq_f32(vld1q_f32(a + i + k), vld1q_f32(b + i + k)));
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(c + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    for (; i < n; i++) c[i] = a[i] + b[i];
+}
+
+static void axpy_neon(float alpha, const float *x, float *y, long n) {
+    float32x4_t va = vdupq_n_f32(alpha);
+    long i = 0;
+    for (; i + 16 <= n; i += 16)
+        for (int k = 0; k < 16; k += 4)
+            vst1q_f32(y + i + k, vfmaq_f32(vld1q_f32(y + i + k), va, vld1q_f32(x + i + k)));
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(y + i, vfmaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+    for (; i < n; i++) y[i] = fmaf(alpha, x[i], y[i]);
+}
+
+static void fma_neon(const float *a, const float *b, const float *c, float *d, long n) {
+    long i = 0;
+    for (; i + 16 <= n; i += 16)
+        for (int k = 0; k < 16; k += 4)
+            vst1q_f32(d + i + k, vfmaq_f32(vld1q_f32(c + i + k), vld1q_f32(a + i + k), vld1q_f32(b + i + k)));
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(d + i, vfmaq_f32(vld1q_f32(c + i), vld1q_f32(a + i), vld1q_f32(b + i)));
+    for (; i < n; i++) d[i] = fmaf(a[i], b[i], c[i]);
+}
+
+static float sum_neon(const float *a, long n) {
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = s0, s2 = s0, s3 = s0;
+    long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = vaddq_f32(s0, vld1q_f32(a + i));
+        s1 = vaddq_f32(s1, vld1q_f32(a + i + 4));
+        s2 = vaddq_f32(s2, vld1q_f32(a + i + 8));
+        s3 = vaddq_f32(s3, vld1q_f32(a + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) s0 = vaddq_f32(s0, vld1q_f32(a + i));
+    float s = vaddvq_f32(vaddq_f32(vaddq_f32(s0, s1), vaddq_f32(s2, s3)));
+    for (; i < n; i++) s += a[i];
+    return s;
+}
+
+static float dot_neon(const float *a, const float *b, long n) {
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = s0, s2 = s0, s3 = s0;
+    long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = vfmaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+        s1 = vfmaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        s2 = vfmaq_f32(s2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        s3 = vfmaq_f32(s3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) s0 = vfmaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+    float s = vaddvq_f32(vaddq_f32(vaddq_f32(s0, s1), vaddq_f32(s2, s3)));
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+static const VecOps ops_neon = { "neon", add_neon, axpy_neon, fma_neon, sum_neon, dot_neon };
+#endif
+
+// ------------------------------------------------------------
+// Selection and the public entry points
+// ------------------------------------------------------------
+
+static const VecOps *ops = &ops_scalar;
+
+static void pick_ops(void) {
+    const char *env = getenv("VEC_ISA");
+    if (env && !strcmp(env, "scalar")) return;
+#if defined(VEC_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ops = &ops_avx2;
+#elif defined(VEC_NEON)
+    ops = &ops_neon;
+#endif
+}
+
+static const VecOps *get_ops(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, pick_ops);
+    return ops;
+}
+
+void vec_add(const float *a, const float *b, float *c, long n) {
+    get_ops()->add(a, b, c, n);
+}
+
+void vec_axpy(float alpha, const float *x, float *y, long n) {
+    get_ops()->axpy(alpha, x, y, n);
+}
+
+void vec_fma(const float *a, const float *b, const float *c, float *d, long n) {
+    get_ops()->fma(a, b, c, d, n);
+}
+
+double vec_sum(const float *a, long n) {
+    const VecOps *o = get_ops();
+    double s = 0.0;
+    for (long i = 0; i < n; i += VEC_BLOCK)
+        s += o->sum(a + i, n - i < VEC_BLOCK ? n - i : VEC_BLOCK);
+    return s;
+}
+
+double vec_dot(const float *a, const float *b, long n) {
+    const VecOps *o = get_ops();
+    double s = 0.0;
+    for (long i = 0; i < n; i += VEC_BLOCK)
+        s += o->dot(a + i, b + i, n - i < VEC_BLOCK ? n - i : VEC_BLOCK);
+    return s;
+}
+
+const char *vec_isa(void) {
+    return get_ops()->name;
+}
@@ -0,0 +1,37 @@
+// Element-wise float kernels on the CPU: the reference the GPU versions in
+// hello.metal (and the CUDA add in cuda.c) are checked and timed against.
+//
+// Each has a scalar loop and a SIMD one (AVX2+FMA on x86 when the CPU has
+// it, NEON on arm64), picked on first use; VEC_ISA=scalar forces the
+// scalar loops. All of them stream their arrays once, so they run at
+// memory bandwidth rather than at the FMA rate: bench.c measures how
+// close they get to STREAM.
+//
+// Arrays may be any length and alignment; outputs must not overlap inputs
+// except where stated. One thread per call; split the range to use more.
+
+#ifndef VECOPS_H
+#define VECOPS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vec_add(const float *a, const float *b, float *c, long n);                  // c = a + b
+void vec_axpy(float alpha, const float *x, float *y, long n);                    // y = alpha x + y
+void vec_fma(const float *a, const float *b, const float *c, float *d, long n);  // d = a b + c, one rounding
+
+// Sums accumulate in float lanes over blocks of VEC_BLOCK elements and in
+// double across blocks, so the error stays below about (VEC_BLOCK + 2)
+// float eps * sum |terms| however long the array.
+#define VEC_BLOCK 1024
+double vec_sum(const float *a, long n);
+double vec_dot(const float *a, const float *b, long n);
+
+const char *vec_isa(void);   // "avx2+fma", "neon" or "scalar"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
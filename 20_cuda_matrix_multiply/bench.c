@@ -0,0 +1,438 @@
+// GEMM benchmark: every compiled-in backend over square, tall-skinny,
+// small-batch and batched shapes, one CSV row per backend and shape.
+// Batched shapes get two rows: one strided-batched call ("batched") and
+// a loop of single calls ("looped"), to show what batching saves.
+// Single products also run on the CPU's low-precision paths (bf16, fp16,
+// int8 with per-row/column scales); gbps counts the bytes of A, B and C
+// once per call, the least any kernel has to move, so the narrower
+// inputs show up there. The CPU's float products run a second time with
+// B packed once beforehand (b_packed=yes, matmul_pack_b), as for weights
+// multiplied by a stream of activations: pack_ms is that one-off cost and
+// amortized_gflops spreads it over the timed calls (on other rows it is
+// just the rate at the mean time).
+//
+// --kind sparse multiplies a square A with only `density` of its elements
+// nonzero three ways: the dense CPU product, matmul_csr on a CSR copy
+// made once (pack_ms), and matmul_auto, which measures the density and
+// converts on every call. gflops counts the dense 2 M N K throughout, so
+// it is the rate a dense product would need to take the same time; the
+// crossover is where MATMUL_SPARSE_DENSITY comes from.
+//
+// --kind strassen runs square products conventionally and through
+// matmul_strassen at several cutoffs, gflops again counting 2 n^3; error
+// is normwise there, max |C - A×B| / (max|A| max|B|) on samples, against
+// matmul_strassen_bound() * FLT_EPSILON. Where Strassen starts winning
+// gives MATMUL_STRASSEN_MIN, the best cutoff MATMUL_STRASSEN_CUTOFF.
+//
+//   make bench                        # sizes up to 2048
+//   ./build/bench --max 8192 --budget 5 > gemm.csv
+//
+// Each shape is timed for at least three calls and until --reps calls or
+// --budget seconds, after one warm-up call. error is matmul_error() of
+// the last result, sampled on large shapes, against the inputs as the
+// kernel saw them (rounded to bf16/fp16, dequantized int8); it should
+// stay below about K * FLT_EPSILON.
+
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "matmul.h"
+
+// Full error check up to this many multiply-adds, sampled above
+#define FULL_CHECK_WORK (1L << 28)
+#define CHECK_SAMPLES 4096
+
+typedef struct { const char *kind; int M, N, K, batch; } Shape;
+
+enum { FP32, BF16, FP16, INT8, PRECISIONS };
+static const char *const precision_names[PRECISIONS] = { "fp32", "bf16", "fp16", "int8" };
+static const int input_bytes[PRECISIONS] = { 4, 2, 2, 1 };
+
+// A and B of one shape in every precision, with the float values the
+// low-precision kernels actually multiply (for the error check)
+typedef struct {
+    const float *A, *B;
+    uint16_t *Ah[2], *Bh[2];   // bf16, fp16
+    int8_t *Aq, *Bq;
+    float *scale_a, *scale_b;
+    float *Ad[PRECISIONS], *Bd[PRECISIONS];
+} Operands;
+
+static const Shape shapes[] = {
+    { "square", 64, 64, 64, 1 },          { "square", 128, 128, 128, 1 },
+    { "square", 256, 256, 256, 1 },       { "square", 512, 512, 512, 1 },
+    { "square", 1024, 1024, 1024, 1 },    { "square", 2048, 2048, 2048, 1 },
+    { "square", 4096, 4096, 4096, 1 },    { "square", 8192, 8192, 8192, 1 },
+    // Tall-skinny: long activations against a narrow weight
+    { "tall", 8192, 64, 1024, 1 },        { "tall", 8192, 256, 1024, 1 },
+    { "tall", 8192, 64, 8192, 1 },        { "tall", 64, 8192, 1024, 1 },
+    // Small batch: a few rows through a large weight, GEMV-like
+    { "batch", 1, 4096, 4096, 1 },        { "batch", 4, 4096, 4096, 1 },
+    { "batch", 16, 4096, 4096, 1 },       { "batch", 64, 4096, 4096, 1 },
+    // Many small independent products
+    { "batched", 8, 8, 8, 20000 },        { "batched", 16, 16, 16, 10000 },
+    { "batched", 32, 32, 32, 4096 },      { "batched", 64, 64, 64, 1024 },
+    { "batched", 128, 128, 128, 256 },
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted t[0..n)
+static double percentile(const double *t, int n, double p) {
+    int r = (int)(p / 100.0 * n + 0.999999);
+    if (r < 1) r = 1;
+    if (r > n) r = n;
+    return t[r - 1];
+}
+
+static void *xmalloc(size_t bytes) {
+    void *p = malloc(bytes ? bytes : 1);
+    if (!p) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+    return p;
+}
+
+static float *random_matrix(long n) {
+    float *m = xmalloc(sizeof(float) * n);
+    for (long i = 0; i < n; i++)
+        m[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+    return m;
+}
+
+// One timed call: the whole batch, strided, or item by item
+static int call(const MatmulBackend *be, int looped, const float *A, const float *B, float *C,
+                int M, int N, int K, int batch) {
+    long sa = (long)M * K, sb = (long)K * N, sc = (long)M * N;
+    if (batch == 1) return be->matmul(A, B, C, M, N, K);
+    if (!looped) return be->strided_batched(A, sa, B, sb, C, sc, M, N, K, batch);
+    for (int i = 0; i < batch; i++)
+        if (be->matmul(A + sa * i, B + sb * i, C + sc * i, M, N, K) != 0) return 1;
+    return 0;
+}
+
+static void prepare(Operands *o, int M, int N, int K) {
+    long na = (long)M * K, nb = (long)K * N;
+    o->Ad[FP32] = (float *)o->A;
+    o->Bd[FP32] = (float *)o->B;
+    for (int h = 0; h < 2; h++) {
+        o->Ah[h] = xmalloc(sizeof(uint16_t) * na);
+        o->Bh[h] = xmalloc(sizeof(uint16_t) * nb);
+        (h ? matmul_fp16_from_floats : matmul_bf16_from_floats)(o->A, o->Ah[h], na);
+        (h ? matmul_fp16_from_floats : matmul_bf16_from_floats)(o->B, o->Bh[h], nb);
+        float *Ad = o->Ad[BF16 + h] = xmalloc(sizeof(float) * na), *Bd = o->Bd[BF16 + h] = xmalloc(sizeof(float) * nb);
+        for (long i = 0; i < na; i++) Ad[i] = h ? matmul_fp16_to_float(o->Ah[h][i]) : matmul_bf16_to_float(o->Ah[h][i]);
+        for (long i = 0; i < nb; i++) Bd[i] = h ? matmul_fp16_to_float(o->Bh[h][i]) : matmul_bf16_to_float(o->Bh[h][i]);
+    }
+    o->Aq = xmalloc(na);
+    o->Bq = xmalloc(nb);
+    o->scale_a = xmalloc(sizeof(float) * M);
+    o->scale_b = xmalloc(sizeof(float) * N);
+    matmul_quantize_rows(o->A, M, K, o->Aq, o->scale_a);
+    matmul_quantize_cols(o->B, K, N, o->Bq, o->scale_b);
+    float *Ad = o->Ad[INT8] = xmalloc(sizeof(float) * na), *Bd = o->Bd[INT8] = xmalloc(sizeof(float) * nb);
+    for (long i = 0; i < na; i++) Ad[i] = o->Aq[i] * o->scale_a[i / K];
+    for (long i = 0; i < nb; i++) Bd[i] = o->Bq[i] * o->scale_b[i % N];
+}
+
+static void release(Operands *o) {
+    for (int h = 0; h < 2; h++) { free(o->Ah[h]); free(o->Bh[h]); }
+    for (int p = BF16; p < PRECISIONS; p++) { free(o->Ad[p]); free(o->Bd[p]); }
+    free(o->Aq); free(o->Bq); free(o->scale_a); free(o->scale_b);
+}
+
+// One timed low-precision call on the CPU
+static int call_lowp(int precision, const Operands *o, float *C, int M, int N, int K) {
+    switch (precision) {
+    case BF16: return matmul_bf16(o->Ah[0], o->Bh[0], C, M, N, K);
+    case FP16: return matmul_fp16(o->Ah[1], o->Bh[1], C, M, N, K);
+    default:   return matmul_s8_scaled(o->Aq, o->scale_a, o->Bq, o->scale_b, C, M, N, K);
+    }
+}
+
+// Timed calls of fn(arg) after one warm-up: at least three, then until
+// max_reps or budget seconds; times sorted, *total their sum
+static int measure(int (*fn)(void *), void *arg, int max_reps, double budget,
+                   double *times, double *total) {
+    if (fn(arg) != 0) return 0;
+    int calls = 0;
+    double start = now_seconds();
+    *total = 0.0;
+    while (calls < max_reps && (calls < 3 || now_seconds() - start < budget)) {
+        double t = now_seconds();
+        fn(arg);
+        times[calls++] = now_seconds() - t;
+        *total += times[calls - 1];
+    }
+    qsort(times, calls, sizeof(double), cmp_double);
+    return calls;
+}
+
+typedef struct {
+    const float *A, *B;
+    float *C;
+    const MatmulCsr *csr;
+    int n;
+} SparseCall;
+
+static int sparse_dense(void *arg) {
+    SparseCall *c = arg;
+    return matmul_cpu(c->A, c->B, c->C, c->n, c->n, c->n);
+}
+static int sparse_csr(void *arg) {
+    SparseCall *c = arg;
+    return matmul_csr(c->csr, c->B, c->C, c->n);
+}
+static int sparse_auto(void *arg) {
+    SparseCall *c = arg;
+    return matmul_auto(c->A, c->B, c->C, c->n, c->n, c->n);
+}
+
+// Rows of --kind sparse; returns the number of failures
+static int bench_sparse(int max_dim, int max_reps, double budget, double *times) {
+    static const int sizes[] = { 1024, 2048 };
+    static const double densities[] = { 0.5, 0.25, 0.1, 0.05, 0.02, 0.01, 0.001 };
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        if (n > max_dim) continue;
+        long work = (long)n * n * n;
+        float *A = random_matrix((long)n * n), *B = random_matrix((long)n * n), *C = random_matrix((long)n * n);
+        float *values = random_matrix((long)n * n);
+        for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+            for (long i = 0; i < (long)n * n; i++)
+                A[i] = (double)rand() / RAND_MAX < densities[d] ? values[i] : 0.0f;
+            double density = matmul_density(A, (long)n * n);
+            MatmulCsr csr;
+            double t = now_seconds();
+            if (matmul_csr_from_dense(A, n, n, &csr) != 0) exit(1);
+            double convert = now_seconds() - t;
+            long nnz = csr.row_ptr[n];
+            SparseCall call = { .A = A, .B = B, .C = C, .csr = &csr, .n = n };
+
+            for (int way = 0; way < 3; way++) {
+                static int (*const fns[])(void *) = { sparse_dense, sparse_csr, sparse_auto };
+                char name[96];
+                if (way == 0) snprintf(name, sizeof(name), "%s", matmul_cpu_name());
+                else if (way == 1) snprintf(name, sizeof(name), "%s", matmul_csr_name());
+                else snprintf(name, sizeof(name), "auto: %s", density > MATMUL_SPARSE_DENSITY ? matmul_backend_name() : "CSR");
+                fprintf(stderr, "%s sparse %dx%dx%d density %.3f\n", name, n, n, n, density);
+
+                double total;
+                int calls = measure(fns[way], &call, max_reps, budget, times, &total);
+                if (!calls) { failures++; continue; }
+                double pack = way == 1 ? convert : 0.0;
+                double err = work <= FULL_CHECK_WORK ? matmul_error(A, B, C, n, n, n)
+                                                     : matmul_error_sampled(A, B, C, n, n, n, CHECK_SAMPLES);
+                int ok = err <= n * FLT_EPSILON;
+                failures += !ok;
+                // Bytes of A as the kernel reads it (CSR: values, columns, row offsets)
+                double a_bytes = way == 1 ? nnz * 8.0 + (n + 1) * 4.0 : (double)n * n * sizeof(float);
+                double bytes = a_bytes + 2.0 * n * n * sizeof(float);
+                double p50 = percentile(times, calls, 50);
+                printf("\"%s\",sparse,fp32,no,%d,%d,%d,1,%.3f,%d,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2e,%s\n",
+                       name, n, n, n, density, calls, 2.0 * work / p50 / 1e9,
+                       2.0 * work * calls / (pack + total) / 1e9, bytes / p50 / 1e9,
+                       times[0] * 1e3, p50 * 1e3, percentile(times, calls, 90) * 1e3,
+                       percentile(times, calls, 99) * 1e3, pack * 1e3, err, ok ? "yes" : "NO");
+                fflush(stdout);
+            }
+            matmul_csr_free(&csr);
+        }
+        free(A); free(B); free(C); free(values);
+    }
+    return failures;
+}
+
+typedef struct {
+    const float *A, *B;
+    float *C;
+    int n, cutoff;   // cutoff 0: conventional
+} StrassenCall;
+
+static int strassen_call(void *arg) {
+    StrassenCall *c = arg;
+    return c->cutoff ? matmul_strassen(c->A, c->B, c->C, c->n, c->n, c->n, c->cutoff)
+                     : matmul_cpu(c->A, c->B, c->C, c->n, c->n, c->n);
+}
+
+// max |C - A×B| / (max|A| max|B|) over samples spread across C
+static double normwise_error_sampled(const float *A, const float *B, const float *C, int n, long samples) {
+    double max_a = 0.0, max_b = 0.0, worst = 0.0;
+    for (long i = 0; i < (long)n * n; i++) {
+        max_a = fabs(A[i]) > max_a ? fabs(A[i]) : max_a;
+        max_b = fabs(B[i]) > max_b ? fabs(B[i]) : max_b;
+    }
+    if (samples > (long)n * n) samples = (long)n * n;
+    for (long s = 0; s < samples; s++) {
+        int i = (int)((double)s * n / samples), j = (int)(((unsigned long)s * 2654435761UL) % n);
+        double sum = 0.0;
+        for (int k = 0; k < n; k++) sum += (double)A[(long)i * n + k] * B[(long)k * n + j];
+        double err = fabs(C[(long)i * n + j] - sum);
+        if (err > worst || isnan(err)) worst = err;
+    }
+    return worst / (max_a * max_b);
+}
+
+// Rows of --kind strassen; returns the number of failures
+static int bench_strassen(int max_dim, int max_reps, double budget, double *times) {
+    static const int sizes[] = { 1024, 2048, 4096, 8192 };
+    static const int cutoffs[] = { 0, 2048, 1024, 512, 256 };
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        if (n > max_dim) continue;
+        long work = (long)n * n * n;
+        float *A = random_matrix((long)n * n), *B = random_matrix((long)n * n), *C = random_matrix((long)n * n);
+        for (size_t c = 0; c < sizeof(cutoffs) / sizeof(cutoffs[0]); c++) {
+            int cutoff = cutoffs[c];
+            if (cutoff >= n) continue;   // no level at all: the conventional row
+            char name[96];
+            if (cutoff) snprintf(name, sizeof(name), "Strassen cutoff %d, %s", cutoff, matmul_cpu_name());
+            else snprintf(name, sizeof(name), "%s", matmul_cpu_name());
+            fprintf(stderr, "%s strassen %dx%dx%d\n", name, n, n, n);
+
+            StrassenCall call = { .A = A, .B = B, .C = C, .n = n, .cutoff = cutoff };
+            double total;
+            int calls = measure(strassen_call, &call, max_reps, budget, times, &total);
+            if (!calls) { failures++; continue; }
+            double err = normwise_error_sampled(A, B, C, n, CHECK_SAMPLES);
+            double bound = matmul_strassen_bound(n, n, n, cutoff ? cutoff : n) * FLT_EPSILON;
+            int ok = err <= bound;
+            failures += !ok;
+            double p50 = percentile(times, calls, 50);
+            printf("\"%s\",strassen,fp32,no,%d,%d,%d,1,1.000,%d,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,0.000,%.2e,%s\n",
+                   name, n, n, n, calls, 2.0 * work / p50 / 1e9, 2.0 * work * calls / total / 1e9,
+                   3.0 * n * n * sizeof(float) / p50 / 1e9, times[0] * 1e3, p50 * 1e3,
+                   percentile(times, calls, 90) * 1e3, percentile(times, calls, 99) * 1e3,
+                   err, ok ? "yes" : "NO");
+            fflush(stdout);
+        }
+        free(A); free(B); free(C);
+    }
+    return failures;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--max N] [--reps R] [--budget SECONDS] [--kind square|tall|batch|batched|sparse|strassen]\n"
+                    "       [--precision fp32|bf16|fp16|int8]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int max_dim = 2048, max_reps = 50;
+    double budget = 2.0;
+    const char *kind = NULL, *precision = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (!strcmp(argv[i], "--max")) max_dim = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--reps")) max_reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--budget")) budget = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--kind")) kind = argv[++i];
+        else if (!strcmp(argv[i], "--precision")) precision = argv[++i];
+        else usage(argv[0]);
+    }
+    if (max_dim < 1 || max_reps < 1) usage(argv[0]);
+
+    double *times = malloc(sizeof(double) * (max_reps > 3 ? max_reps : 3));
+    int failures = 0;
+    srand(1);
+    fprintf(stderr, "CPU low-precision kernels: %s\n", matmul_lowp_isa());
+    printf("backend,kind,precision,b_packed,M,N,K,batch,density,calls,gflops,amortized_gflops,gbps,"
+           "min_ms,p50_ms,p90_ms,p99_ms,pack_ms,error,ok\n");
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        const Shape *sh = &shapes[s];
+        if (kind && strcmp(kind, sh->kind)) continue;
+        if (sh->M > max_dim || sh->N > max_dim || sh->K > max_dim) continue;
+        int M = sh->M, N = sh->N, K = sh->K, batch = sh->batch;
+        long work = (long)M * N * K;
+        float *A = random_matrix((long)M * K * batch), *B = random_matrix((long)K * N * batch);
+        float *C = random_matrix((long)M * N * batch);
+
+        Operands ops = { .A = A, .B = B };
+        if (batch == 1) prepare(&ops, M, N, K);
+
+        // Every backend in float; the CPU also in its low-precision paths
+        // and with B packed beforehand. The second variant of a batched
+        // shape is the loop of single calls, of a single product packed B.
+        for (int b = 0; matmul_backends[b]; b++) {
+            int cpu = matmul_backends[b]->matmul == matmul_cpu;
+            for (int p = 0; p < (cpu && batch == 1 ? PRECISIONS : 1); p++)
+            for (int variant = 0; variant < (batch > 1 || (cpu && p == FP32) ? 2 : 1); variant++) {
+                if (precision && strcmp(precision, precision_names[p])) continue;
+                const MatmulBackend *be = matmul_backends[b];
+                int looped = batch > 1 && variant, b_packed = batch == 1 && variant;
+                const char *kind = batch == 1 ? sh->kind : looped ? "looped" : "batched";
+                fprintf(stderr, "%s %s %s%s %dx%dx%dx%d\n", be->name(), kind, precision_names[p],
+                        b_packed ? " packed B" : "", M, N, K, batch);
+
+                MatmulPackedB *packed = NULL;
+                double pack_time = 0.0;
+                if (b_packed) {
+                    double t = now_seconds();
+                    packed = matmul_pack_b(B, K, N);
+                    pack_time = now_seconds() - t;
+                    if (!packed) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+                }
+#define CALL() (packed ? matmul_packed(A, packed, C, M)                 \
+                : p == FP32 ? call(be, looped, A, B, C, M, N, K, batch) \
+                : call_lowp(p, &ops, C, M, N, K))
+                if (CALL() != 0) { failures++; matmul_free_packed_b(packed); continue; }
+
+                int calls = 0;
+                double start = now_seconds(), total = 0.0;
+                while (calls < max_reps && (calls < 3 || now_seconds() - start < budget)) {
+                    double t = now_seconds();
+                    CALL();
+                    times[calls++] = now_seconds() - t;
+                    total += times[calls - 1];
+                }
+#undef CALL
+                matmul_free_packed_b(packed);
+                qsort(times, calls, sizeof(double), cmp_double);
+
+                // Largest error over the batch, first and last items; int8
+                // also rounds the sum to float and applies two scales
+                double err = 0.0, bound = (K + (p == INT8 ? 3 : 0)) * FLT_EPSILON;
+                for (int i = 0; i < batch; i += batch > 1 ? batch - 1 : 1) {
+                    const float *a = (p == FP32 ? A : ops.Ad[p]) + (long)M * K * i;
+                    const float *bb = (p == FP32 ? B : ops.Bd[p]) + (long)K * N * i;
+                    float *c = C + (long)M * N * i;
+                    double e = work <= FULL_CHECK_WORK ? matmul_error(a, bb, c, M, N, K)
+                                                       : matmul_error_sampled(a, bb, c, M, N, K, CHECK_SAMPLES);
+                    if (e > err || e != e) err = e;
+                }
+                int ok = err <= bound;
+                failures += !ok;
+                double p50 = percentile(times, calls, 50);
+                double bytes = ((double)(M + N) * K * input_bytes[p] + (double)M * N * sizeof(float)) * batch;
+                printf("\"%s\",%s,%s,%s,%d,%d,%d,%d,1.000,%d,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2e,%s\n",
+                       be->name(), kind, precision_names[p], b_packed ? "yes" : "no", M, N, K, batch, calls,
+                       2.0 * work * batch / p50 / 1e9, 2.0 * work * batch * calls / (pack_time + total) / 1e9,
+                       bytes / p50 / 1e9, times[0] * 1e3, p50 * 1e3, percentile(times, calls, 90) * 1e3,
+                       percentile(times, calls, 99) * 1e3, pack_time * 1e3, err, ok ? "yes" : "NO");
+                fflush(stdout);
+            }
+        }
+        if (batch == 1) release(&ops);
+        free(A); free(B); free(C);
+    }
+    if (!kind || !strcmp(kind, "sparse"))
+        failures += bench_sparse(max_dim, max_reps, budget, times);
+    if (!kind || !strcmp(kind, "strassen"))
+        failures += bench_strassen(max_dim, max_reps, budget, times);
+    free(times);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+// Metal state that outlives a single dispatch: one device, command queue
+// and library per process, pipelines cached by kernel name, and a pool of
+// shared buffers. The first dispatch of a kernel pays for the setup; later
+// ones only encode and wait.
+//
+// Objective-C. The same file is in 19_cuda_helloworld and
+// 20_cuda_matrix_multiply. Not thread-safe: callers on several threads
+// serialise their calls.
+
+#ifndef COMPUTE_H
+#define COMPUTE_H
+
+#import <Metal/Metal.h>
+
+// Device (system default, else the first enumerated), queue and library.
+// Returns 0, or 1 after printing why; later calls return at once.
+int compute_open(const char *metallib_path);
+id<MTLDevice> compute_device(void);
+
+// Pipeline for a kernel in the library, made on first use; nil (and a
+// message) when it is missing or fails to compile
+id<MTLComputePipelineState> compute_pipeline(const char *kernel);
+
+// Shared-storage buffer of at least `bytes`, reusing a pooled one when one
+// fits (contents are then stale); give it back with compute_recycle() once
+// no dispatch uses it
+id<MTLBuffer> compute_buffer(size_t bytes);
+void compute_recycle(id<MTLBuffer> buffer);
+
+// One 1-D dispatch of `threads` threads: buffers at indices 0..n-1, then,
+// when params is set, `params_size` bytes of constants at index n
+// (setBytes, no buffer). Waits for it; returns 0, or 1 after printing the
+// command buffer's error.
+int compute_run(id<MTLComputePipelineState> pso, NSArray<id<MTLBuffer>> *buffers,
+                const void *params, size_t params_size, size_t threads);
+
+// The same for a grid of whole threadgroups (up to three dimensions), for
+// kernels that need every thread of a group, with `threadgroup_bytes` of
+// threadgroup memory at index 0 when nonzero
+int compute_run_groups(id<MTLComputePipelineState> pso, NSArray<id<MTLBuffer>> *buffers,
+                       const void *params, size_t params_size,
+                       MTLSize groups, MTLSize group, size_t threadgroup_bytes);
+
+#endif
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <Metal/Metal.h>
+#include <float.h>
+#include <math.h>
+
+#include "matmul.h"
 
 static void print_matrix(const float* m, int rows, int cols, const char* name) {
     printf("%s =\n", name);
@@ -11,85 +14,397 @@ static void print_matrix(const float* m, int rows, int cols, const char* name) {
     }
 }
 
+static void fill_random(float *m, long n) {
+    for (long i = 0; i < n; i++)
+        m[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+}
+
+// Compare against the naive reference on shapes that hit every edge case
+// of a blocked kernel: smaller than one tile, ragged tiles, several K
+// slices, several threads. Returns the number of failures.
+static int validate(MatmulFn fn) {
+    static const int shapes[][3] = {   // M, N, K
+        { 1, 1, 1 }, { 7, 5, 3 }, { 6, 16, 1 }, { 33, 17, 65 }, { 1, 300, 257 },
+        { 300, 1, 257 }, { 100, 300, 200 }, { 257, 129, 511 }, { 512, 512, 512 },
+    };
+    int failures = 0;
+    srand(1);
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        int M = shapes[s][0], N = shapes[s][1], K = shapes[s][2];
+        float *A = malloc(sizeof(float) * M * K), *B = malloc(sizeof(float) * K * N);
+        float *C = malloc(sizeof(float) * M * N);
+        if (!A || !B || !C) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+        fill_random(A, (long)M * K);
+        fill_random(B, (long)K * N);
+
+        double err = 1.0, bound = K * FLT_EPSILON;
+        if (fn(A, B, C, M, N, K) == 0)
+            err = matmul_error(A, B, C, M, N, K);
+        int ok = err <= bound;
+        printf("%4d x %4d x %4d: error %.2e (bound %.2e) %s\n", M, N, K, err, bound, ok ? "ok" : "FAIL");
+        failures += !ok;
+        free(A); free(B); free(C);
+    }
+    return failures;
+}
+
+// Both batched entry points against item-by-item checks: many tiny
+// items, a few large ones (threaded inside each), gaps between strided
+// items and a B shared by the whole batch (stride 0)
+static int validate_batched(const MatmulBackend *be) {
+    static const int cases[][4] = {   // M, N, K, batch
+        { 4, 4, 4, 1000 }, { 7, 13, 5, 37 }, { 33, 17, 65, 9 }, { 300, 200, 100, 2 },
+    };
+    int failures = 0;
+    srand(2);
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        int M = cases[c][0], N = cases[c][1], K = cases[c][2], batch = cases[c][3];
+        long sa = (long)M * K + 3, sb = (long)K * N, sc = (long)M * N + 1;   // A and C with gaps
+        float *A = malloc(sizeof(float) * sa * batch), *B = malloc(sizeof(float) * sb * batch);
+        float *C = malloc(sizeof(float) * sc * batch);
+        const float **Ap = malloc(sizeof(*Ap) * batch), **Bp = malloc(sizeof(*Bp) * batch);
+        float **Cp = malloc(sizeof(*Cp) * batch);
+        if (!A || !B || !C || !Ap || !Bp || !Cp) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+        fill_random(A, sa * batch);
+        fill_random(B, sb * batch);
+        // Pointer arrays in reverse order, so item i is not at base + i * stride
+        for (int i = 0; i < batch; i++) {
+            Ap[i] = A + sa * (batch - 1 - i);
+            Bp[i] = B + sb * (batch - 1 - i);
+            Cp[i] = C + sc * (batch - 1 - i);
+        }
+
+        for (int shared = 0; shared < 2; shared++) {
+            if (shared) {
+                if (be->strided_batched(A, sa, B, 0, C, sc, M, N, K, batch) != 0) { failures++; continue; }
+            } else if (be->batched(Ap, Bp, Cp, M, N, K, batch) != 0) { failures++; continue; }
+            double err = 0.0, bound = K * FLT_EPSILON;
+            for (int i = 0; i < batch; i++) {
+                double e = shared ? matmul_error(A + sa * i, B, C + sc * i, M, N, K)
+                                  : matmul_error(Ap[i], Bp[i], Cp[i], M, N, K);
+                if (e > err) err = e;
+            }
+            int ok = err <= bound;
+            printf("%4d x %4d x %4d x %4d %s: error %.2e (bound %.2e) %s\n", M, N, K, batch,
+                   shared ? "strided, shared B" : "pointer arrays   ", err, bound, ok ? "ok" : "FAIL");
+            failures += !ok;
+        }
+        free(A); free(B); free(C); free(Ap); free(Bp); free(Cp);
+    }
+    return failures;
+}
+
+// One packed B against a stream of A matrices of different heights,
+// with B overwritten after packing: N beyond one NC block, K over several
+// KC slices, ragged panels. Returns the number of failures.
+static int validate_packed(void) {
+    static const int shapes[][2] = {   // N, K
+        { 1, 1 }, { 17, 65 }, { 300, 257 }, { 2100, 513 },
+    };
+    static const int heights[] = { 1, 7, 100, 257 };
+    int failures = 0;
+    srand(4);
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        int N = shapes[s][0], K = shapes[s][1];
+        float *B = malloc(sizeof(float) * K * N), *Bcopy = malloc(sizeof(float) * K * N);
+        if (!B || !Bcopy) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+        fill_random(B, (long)K * N);
+        for (long i = 0; i < (long)K * N; i++) Bcopy[i] = B[i];
+        MatmulPackedB *packed = matmul_pack_b(B, K, N);
+        if (!packed) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+        for (long i = 0; i < (long)K * N; i++) B[i] = 1e30f;
+
+        for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+            int M = heights[h];
+            float *A = malloc(sizeof(float) * M * K), *C = malloc(sizeof(float) * M * N);
+            if (!A || !C) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+            fill_random(A, (long)M * K);
+            double err = 1.0, bound = K * FLT_EPSILON;
+            if (matmul_packed(A, packed, C, M) == 0)
+                err = matmul_error(A, Bcopy, C, M, N, K);
+            int ok = err <= bound;
+            printf("%4d x %4d x %4d packed B: error %.2e (bound %.2e) %s\n", M, N, K, err, bound, ok ? "ok" : "FAIL");
+            failures += !ok;
+            free(A); free(C);
+        }
+        matmul_free_packed_b(packed);
+        free(B); free(Bcopy);
+    }
+    return failures;
+}
+
+// CSR × dense against the reference on the dense form of A: several
+// densities, ragged strips (N not a multiple of 64 or 8), empty rows and
+// one full row among empty ones (all the nonzeros in one thread's share
+// unless they are balanced on nonzeros); matmul_auto on both sides of
+// its threshold. Returns the number of failures.
+static int validate_sparse(void) {
+    static const int shapes[][3] = {   // M, N, K
+        { 1, 1, 1 }, { 7, 5, 3 }, { 100, 70, 300 }, { 257, 129, 511 }, { 64, 1000, 64 },
+    };
+    static const double densities[] = { 0.0, 0.01, 0.1, 0.5 };
+    int failures = 0;
+    srand(5);
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++)
+        for (size_t d = 0; d <= sizeof(densities) / sizeof(densities[0]); d++) {
+            int M = shapes[s][0], N = shapes[s][1], K = shapes[s][2];
+            int skewed = d == sizeof(densities) / sizeof(densities[0]);
+            float *A = malloc(sizeof(float) * M * K), *B = malloc(sizeof(float) * K * N);
+            float *C = malloc(sizeof(float) * M * N);
+            if (!A || !B || !C) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+            fill_random(A, (long)M * K);
+            fill_random(B, (long)K * N);
+            for (int i = 0; i < M; i++)
+                for (int k = 0; k < K; k++)
+                    if (skewed ? i != M / 2 : (double)rand() / RAND_MAX >= densities[d])
+                        A[(long)i * K + k] = 0.0f;
+
+            MatmulCsr csr;
+            if (matmul_csr_from_dense(A, M, K, &csr) != 0) exit(1);
+            double density = matmul_density(A, (long)M * K), bound = K * FLT_EPSILON;
+            double err = 1.0, err_auto = 1.0;
+            for (long i = 0; i < (long)M * N; i++) C[i] = 1e30f;   // every element must be written
+            if (matmul_csr(&csr, B, C, N) == 0)
+                err = matmul_error(A, B, C, M, N, K);
+            for (long i = 0; i < (long)M * N; i++) C[i] = 1e30f;
+            if (matmul_auto(A, B, C, M, N, K) == 0)
+                err_auto = matmul_error(A, B, C, M, N, K);
+            int ok = err <= bound && err_auto <= bound;
+            printf("%4d x %4d x %4d CSR, density %.3f%s: error %.2e, auto (%s) %.2e (bound %.2e) %s\n",
+                   M, N, K, density, skewed ? " in one row" : "", err,
+                   density > MATMUL_SPARSE_DENSITY ? "dense" : "CSR", err_auto, bound, ok ? "ok" : "FAIL");
+            failures += !ok;
+            matmul_csr_free(&csr);
+            free(A); free(B); free(C);
+        }
+    return failures;
+}
+
+// Strassen-Winograd against double sums, normwise as its bound is:
+// max |C - A×B| / (max|A| max|B|) within matmul_strassen_bound() times
+// FLT_EPSILON (2u, room for the bound's second-order terms). Small
+// cutoffs take small shapes several levels down, with odd sides at every
+// level; the last case runs one level at the default cutoff. C starts at
+// 1e30 so an element left unwritten fails. Returns the number of failures.
+static int validate_strassen(void) {
+    static const int cases[][4] = {   // M, N, K, cutoff
+        { 1, 1, 1, 1 }, { 7, 5, 3, 1 }, { 64, 64, 64, 8 }, { 100, 100, 100, 16 },
+        { 257, 129, 511, 32 }, { 300, 1, 257, 16 }, { 512, 512, 512, 64 }, { 1025, 1025, 1025, 0 },
+    };
+    int failures = 0;
+    srand(7);
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        int M = cases[c][0], N = cases[c][1], K = cases[c][2], cutoff = cases[c][3];
+        float *A = malloc(sizeof(float) * M * K), *B = malloc(sizeof(float) * K * N);
+        float *C = malloc(sizeof(float) * M * N);
+        if (!A || !B || !C) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+        fill_random(A, (long)M * K);
+        fill_random(B, (long)K * N);
+        for (long i = 0; i < (long)M * N; i++) C[i] = 1e30f;
+
+        double err = INFINITY, max_a = 0.0, max_b = 0.0;
+        for (long i = 0; i < (long)M * K; i++) max_a = fmax(max_a, fabs(A[i]));
+        for (long i = 0; i < (long)K * N; i++) max_b = fmax(max_b, fabs(B[i]));
+        if (matmul_strassen(A, B, C, M, N, K, cutoff) == 0) {
+            err = 0.0;
+            for (int i = 0; i < M; i++)
+                for (int j = 0; j < N; j++) {
+                    double sum = 0.0;
+                    for (int k = 0; k < K; k++)
+                        sum += (double)A[(long)i * K + k] * B[(long)k * N + j];
+                    err = fmax(err, fabs(C[(long)i * N + j] - sum));
+                }
+            err /= max_a * max_b;
+        }
+        double bound = matmul_strassen_bound(M, N, K, cutoff) * FLT_EPSILON;
+        int ok = err <= bound;
+        printf("%4d x %4d x %4d Strassen, cutoff %4d: error %.2e (bound %.2e) %s\n",
+               M, N, K, cutoff ? cutoff : MATMUL_STRASSEN_CUTOFF, err, bound, ok ? "ok" : "FAIL");
+        failures += !ok;
+        free(A); free(B); free(C);
+    }
+    return failures;
+}
+
+// Low-precision paths: bf16/fp16 against the reference on the decoded
+// inputs (the products are exact in float, so the float bound holds),
+// int8 exactly against 64-bit sums, including the extremes -128 and 127,
+// and the scaled int8 product against the dequantized inputs
+static int validate_lowp(void) {
+    static const int shapes[][3] = {   // M, N, K
+        { 1, 1, 1 }, { 7, 5, 3 }, { 6, 32, 2 }, { 33, 17, 65 }, { 1, 300, 257 },
+        { 300, 1, 257 }, { 100, 300, 201 }, { 257, 129, 511 }, { 64, 64, 1000 },
+    };
+    int failures = 0;
+    srand(3);
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        int M = shapes[s][0], N = shapes[s][1], K = shapes[s][2];
+        long na = (long)M * K, nb = (long)K * N, nc = (long)M * N;
+        float *A = malloc(sizeof(float) * na), *B = malloc(sizeof(float) * nb);
+        float *Ad = malloc(sizeof(float) * na), *Bd = malloc(sizeof(float) * nb);
+        float *C = malloc(sizeof(float) * nc), *sa = malloc(sizeof(float) * M), *sb = malloc(sizeof(float) * N);
+        uint16_t *Ah = malloc(sizeof(uint16_t) * na), *Bh = malloc(sizeof(uint16_t) * nb);
+        int8_t *Aq = malloc(na), *Bq = malloc(nb);
+        int32_t *Ci = malloc(sizeof(int32_t) * nc);
+        if (!A || !B || !Ad || !Bd || !C || !sa || !sb || !Ah || !Bh || !Aq || !Bq || !Ci) {
+            fprintf(stderr, "Out of memory.\n");
+            exit(1);
+        }
+        fill_random(A, na);
+        fill_random(B, nb);
+        double bound = K * FLT_EPSILON;
+
+        for (int half = 0; half < 2; half++) {
+            const char *name = half ? "fp16" : "bf16";
+            (half ? matmul_fp16_from_floats : matmul_bf16_from_floats)(A, Ah, na);
+            (half ? matmul_fp16_from_floats : matmul_bf16_from_floats)(B, Bh, nb);
+            for (long i = 0; i < na; i++) Ad[i] = half ? matmul_fp16_to_float(Ah[i]) : matmul_bf16_to_float(Ah[i]);
+            for (long i = 0; i < nb; i++) Bd[i] = half ? matmul_fp16_to_float(Bh[i]) : matmul_bf16_to_float(Bh[i]);
+            double err = 1.0;
+            if ((half ? matmul_fp16 : matmul_bf16)(Ah, Bh, C, M, N, K) == 0)
+                err = matmul_error(Ad, Bd, C, M, N, K);
+            int ok = err <= bound;
+            printf("%4d x %4d x %4d %s: error %.2e (bound %.2e) %s\n", M, N, K, name, err, bound, ok ? "ok" : "FAIL");
+            failures += !ok;
+        }
+
+        // Full int8 range, with a row of A and a column of B at -128
+        for (long i = 0; i < na; i++) Aq[i] = (int8_t)(rand() % 256 - 128);
+        for (long i = 0; i < nb; i++) Bq[i] = (int8_t)(rand() % 256 - 128);
+        for (int k = 0; k < K; k++) Aq[k] = Bq[(long)k * N] = -128;
+        long wrong = matmul_s8(Aq, Bq, Ci, M, N, K) != 0 ? nc : 0;
+        for (int i = 0; i < M && !wrong; i++)
+            for (int j = 0; j < N; j++) {
+                long long sum = 0;
+                for (int k = 0; k < K; k++) sum += Aq[(long)i * K + k] * Bq[(long)k * N + j];
+                wrong += sum != Ci[(long)i * N + j];
+            }
+        printf("%4d x %4d x %4d int8: %ld element(s) off %s\n", M, N, K, wrong, wrong ? "FAIL" : "ok");
+        failures += wrong != 0;
+
+        // Scaled int8 against the float product of the dequantized inputs
+        // (three more roundings: to float, times each scale); the error
+        // against the unquantized inputs is what quantization costs
+        matmul_quantize_rows(A, M, K, Aq, sa);
+        matmul_quantize_cols(B, K, N, Bq, sb);
+        for (long i = 0; i < na; i++) Ad[i] = Aq[i] * sa[i / K];
+        for (long i = 0; i < nb; i++) Bd[i] = Bq[i] * sb[i % N];
+        double err = 1.0, qerr = 1.0, sbound = (K + 3) * FLT_EPSILON;
+        if (matmul_s8_scaled(Aq, sa, Bq, sb, C, M, N, K) == 0) {
+            err = matmul_error(Ad, Bd, C, M, N, K);
+            qerr = matmul_error(A, B, C, M, N, K);
+        }
+        int ok = err <= sbound;
+        printf("%4d x %4d x %4d int8 scaled: error %.2e (bound %.2e) %s, %.2e from quantization\n",
+               M, N, K, err, sbound, ok ? "ok" : "FAIL", qerr);
+        failures += !ok;
+
+        free(A); free(B); free(Ad); free(Bd); free(C); free(sa); free(sb);
+        free(Ah); free(Bh); free(Aq); free(Bq); free(Ci);
+    }
+
+    // Conversions: rounding to even, subnormals, overflow, NaN
+    static const struct { float f; uint16_t bf16, fp16; } conv[] = {
+        { 1.0f, 0x3f80, 0x3c00 }, { -2.5f, 0xc020, 0xc100 }, { 1.00048828f, 0x3f80, 0x3c00 }, { 1.00146484f, 0x3f80, 0x3c02 },
+        { 1.01171875f, 0x3f82, 0x3c0c }, { 65504.0f, 0x4780, 0x7bff }, { 65520.0f, 0x4780, 0x7c00 },
+        { 5.9604645e-8f, 0x3380, 0x0001 }, { 2.9802322e-8f, 0x3300, 0x0000 }, { 6.1035156e-5f, 0x3880, 0x0400 },
+    };
+    for (size_t i = 0; i < sizeof(conv) / sizeof(conv[0]); i++) {
+        uint16_t b = matmul_bf16_from_float(conv[i].f), h = matmul_fp16_from_float(conv[i].f);
+        if (b != conv[i].bf16 || h != conv[i].fp16) {
+            printf("convert %g: bf16 %04x fp16 %04x, expected %04x %04x FAIL\n",
+                   conv[i].f, b, h, conv[i].bf16, conv[i].fp16);
+            failures++;
+        }
+    }
+    uint16_t nb16 = matmul_bf16_from_float(NAN), nf16 = matmul_fp16_from_float(NAN);
+    if (!isnan(matmul_bf16_to_float(nb16)) || !isnan(matmul_fp16_to_float(nf16))) {
+        printf("convert NaN: bf16 %04x fp16 %04x FAIL\n", nb16, nf16);
+        failures++;
+    }
+    return failures;
+}
+
+// The tiled Metal kernel's loop nest at each tile size the GPU could pick
+static int emulated_8(const float *A, const float *B, float *C, int M, int N, int K) {
+    return matmul_tiled_emulated(A, B, C, M, N, K, 8);
+}
+static int emulated_16(const float *A, const float *B, float *C, int M, int N, int K) {
+    return matmul_tiled_emulated(A, B, C, M, N, K, 16);
+}
+static int emulated_32(const float *A, const float *B, float *C, int M, int N, int K) {
+    return matmul_tiled_emulated(A, B, C, M, N, K, 32);
+}
+
+// Tile choice for a few pipeline limits: threads per group, then memory
+static int validate_tile_choice(void) {
+    static const unsigned long cases[][3] = {   // max threads, max bytes, tile
+        { 1024, 32768, 32 }, { 512, 32768, 16 }, { 1024, 4096, 16 }, { 64, 32768, 8 }, { 1, 32768, 1 },
+    };
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int t = matmul_pick_tile(cases[i][0], cases[i][1]);
+        if (t != (int)cases[i][2]) {
+            printf("tile for %lu threads, %lu bytes: %d, expected %lu FAIL\n", cases[i][0], cases[i][1], t, cases[i][2]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
 int main(void) {
-    @autoreleasepool {
-        printf("=== Metal Matrix Multiply ===\n");
-
-        // ------------------------------------------------------------
-        // 1. Device setup with fallback (works in iTerm etc.)
-        // ------------------------------------------------------------
-        NSArray *allDevices = MTLCopyAllDevices();
-        id<MTLDevice> device = MTLCreateSystemDefaultDevice();
-        if (!device && [allDevices count] > 0)
-            device = [allDevices objectAtIndex:0];
-        if (!device) { fprintf(stderr, "No Metal device found.\n"); return 1; }
-
-        printf("Using GPU: %s\n", device.name.UTF8String);
-
-        // ------------------------------------------------------------
-        // 2. Create command queue and load kernel
-        // ------------------------------------------------------------
-        id<MTLCommandQueue> queue = [device newCommandQueue];
-        NSError *err = nil;
-        id<MTLLibrary> lib = [device newLibraryWithFile:@"build/matmul.metallib" error:&err];
-        if (!lib) { fprintf(stderr, "Failed to load metallib: %s\n", err.localizedDescription.UTF8String); return 1; }
-        id<MTLFunction> fn = [lib newFunctionWithName:@"matmul"];
-        if (!fn) { fprintf(stderr, "Kernel not found.\n"); return 1; }
-
-        id<MTLComputePipelineState> pso = [device newComputePipelineStateWithFunction:fn error:&err];
-        if (!pso) { fprintf(stderr, "Pipeline error: %s\n", err.localizedDescription.UTF8String); return 1; }
-
-        // ------------------------------------------------------------
-        // 3. Define matrices
-        // ------------------------------------------------------------
-        const uint M = 3, K = 2, N = 3;
-        float A[M*K], B[K*N], C[M*N];
-
-        for (int i = 0; i < M*K; i++) A[i] = i + 1;         // A = [1 2; 3 4; 5 6]
-        for (int i = 0; i < K*N; i++) B[i] = (i + 1) * 0.5; // B = [0.5 1.0 1.5; 2.0 2.5 3.0]
-        for (int i = 0; i < M*N; i++) C[i] = 0;
-
-        print_matrix(A, M, K, "A");
-        print_matrix(B, K, N, "B");
-
-        // ------------------------------------------------------------
-        // 4. Allocate GPU buffers
-        // ------------------------------------------------------------
-        id<MTLBuffer> bufA = [device newBufferWithBytes:A length:sizeof(A) options:MTLResourceStorageModeShared];
-        id<MTLBuffer> bufB = [device newBufferWithBytes:B length:sizeof(B) options:MTLResourceStorageModeShared];
-        id<MTLBuffer> bufC = [device newBufferWithLength:sizeof(C) options:MTLResourceStorageModeShared];
-        id<MTLBuffer> bufM = [device newBufferWithBytes:&M length:sizeof(M) options:MTLResourceStorageModeShared];
-        id<MTLBuffer> bufN = [device newBufferWithBytes:&N length:sizeof(N) options:MTLResourceStorageModeShared];
-        id<MTLBuffer> bufK = [device newBufferWithBytes:&K length:sizeof(K) options:MTLResourceStorageModeShared];
-
-        // ------------------------------------------------------------
-        // 5. Encode and dispatch
-        // ------------------------------------------------------------
-        id<MTLCommandBuffer> cb = [queue commandBuffer];
-        id<MTLComputeCommandEncoder> enc = [cb computeCommandEncoder];
-        [enc setComputePipelineState:pso];
-        [enc setBuffer:bufA offset:0 atIndex:0];
-        [enc setBuffer:bufB offset:0 atIndex:1];
-        [enc setBuffer:bufC offset:0 atIndex:2];
-        [enc setBuffer:bufM offset:0 atIndex:3];
-        [enc setBuffer:bufN offset:0 atIndex:4];
-        [enc setBuffer:bufK offset:0 atIndex:5];
-
-        // One thread per element of C
-        MTLSize grid = MTLSizeMake(N, M, 1);
-        MTLSize tg   = MTLSizeMake(1, 1, 1);
-        [enc dispatchThreads:grid threadsPerThreadgroup:tg];
-        [enc endEncoding];
-        [cb commit];
-        [cb waitUntilCompleted];
-
-        // ------------------------------------------------------------
-        // 6. Read back and print
-        // ------------------------------------------------------------
-        memcpy(C, bufC.contents, sizeof(C));
-        print_matrix(C, M, N, "C = A×B");
-
-        printf("=== Done ===\n");
+    printf("=== Matrix Multiply ===\n");
+    printf("Backend: %s\n", matmul_backend_name());
+
+    // ------------------------------------------------------------
+    // 1. Define matrices
+    // ------------------------------------------------------------
+    enum { M = 3, K = 2, N = 3 };
+    float A[M*K], B[K*N], C[M*N];
+
+    for (int i = 0; i < M*K; i++) A[i] = i + 1;         // A = [1 2; 3 4; 5 6]
+    for (int i = 0; i < K*N; i++) B[i] = (i + 1) * 0.5; // B = [0.5 1.0 1.5; 2.0 2.5 3.0]
+
+    print_matrix(A, M, K, "A");
+    print_matrix(B, K, N, "B");
+
+    // ------------------------------------------------------------
+    // 2. Multiply and print
+    // ------------------------------------------------------------
+    if (matmul(A, B, C, M, N, K) != 0) return 1;
+    print_matrix(C, M, N, "C = A×B");
+
+    // ------------------------------------------------------------
+    // 3. Check against the naive reference
+    // ------------------------------------------------------------
+    int failures = 0;
+    for (int b = 0; matmul_backends[b]; b++) {
+        printf("Validating %s against the naive reference:\n", matmul_backends[b]->name());
+        failures += validate(matmul_backends[b]->matmul);
+        failures += validate_batched(matmul_backends[b]);
+    }
+    printf("Validating a packed B on the CPU:\n");
+    failures += validate_packed();
+    printf("Validating %s:\n", matmul_csr_name());
+    failures += validate_sparse();
+    printf("Validating Strassen-Winograd on the CPU:\n");
+    failures += validate_strassen();
+    printf("Validating the low-precision CPU paths (%s):\n", matmul_lowp_isa());
+    failures += validate_lowp();
+    static const struct { int tile; MatmulFn fn; } emulated[] = {
+        { 8, emulated_8 }, { 16, emulated_16 }, { 32, emulated_32 },
+    };
+    for (size_t e = 0; e < sizeof(emulated) / sizeof(emulated[0]); e++) {
+        printf("Validating the tiled kernel's loop nest on the CPU, %dx%d tiles:\n",
+               emulated[e].tile, emulated[e].tile);
+        failures += validate(emulated[e].fn);
     }
+    failures += validate_tile_choice();
+    if (failures) {
+        fprintf(stderr, "%d shape(s) failed validation.\n", failures);
+        return 1;
+    }
+
+    printf("=== Done ===\n");
     return 0;
 }
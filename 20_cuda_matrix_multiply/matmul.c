@@ -0,0 +1,42 @@
+#include "matmul.h"
+
+static const MatmulBackend cpu = {
+    matmul_cpu_name, matmul_cpu, matmul_cpu_batched, matmul_cpu_strided_batched,
+};
+#ifdef MATMUL_METAL
+static const MatmulBackend metal = {
+    matmul_metal_name, matmul_metal, matmul_metal_batched, matmul_metal_strided_batched,
+};
+static const MatmulBackend metal_naive = {
+    matmul_metal_naive_name, matmul_metal_naive, matmul_metal_naive_batched,
+    matmul_metal_naive_strided_batched,
+};
+#endif
+
+const MatmulBackend *const matmul_backends[] = {
+#ifdef MATMUL_METAL
+    &metal,
+    &metal_naive,
+#endif
+    &cpu,
+    0,
+};
+
+int matmul(const float *A, const float *B, float *C, int M, int N, int K) {
+    return matmul_backends[0]->matmul(A, B, C, M, N, K);
+}
+
+int matmul_batched(const float *const *A, const float *const *B, float *const *C,
+                   int M, int N, int K, int batch) {
+    return matmul_backends[0]->batched(A, B, C, M, N, K, batch);
+}
+
+int matmul_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                           float *C, long stride_c, int M, int N, int K, int batch) {
+    return matmul_backends[0]->strided_batched(A, stride_a, B, stride_b, C, stride_c,
+                                               M, N, K, batch);
+}
+
+const char *matmul_backend_name(void) {
+    return matmul_backends[0]->name();
+}
@@ -0,0 +1,198 @@
+// C = A × B for row-major float matrices: A is MxK, B is KxN, C is MxN.
+//
+// One contract, several backends: matmul_cpu.c is a blocked SGEMM that
+// builds everywhere, matmul_metal.m runs the kernel in matmul.metal on
+// the GPU and is compiled in on macOS (the Makefile's METAL=1). matmul()
+// uses the preferred backend; matmul_backends lists all of them for
+// benchmarks and cross-checks.
+
+#ifndef MATMUL_H
+#define MATMUL_H
+
+#include <stdint.h>
+
+typedef int (*MatmulFn)(const float *A, const float *B, float *C, int M, int N, int K);
+typedef int (*MatmulBatchedFn)(const float *const *A, const float *const *B, float *const *C,
+                               int M, int N, int K, int batch);
+typedef int (*MatmulStridedFn)(const float *A, long stride_a, const float *B, long stride_b,
+                               float *C, long stride_c, int M, int N, int K, int batch);
+
+typedef struct {
+    const char *(*name)(void);   // e.g. "Metal tiled (Apple M3 Max)" or "CPU (avx2+fma, 8 threads)"
+    MatmulFn matmul;
+    MatmulBatchedFn batched;
+    MatmulStridedFn strided_batched;
+} MatmulBackend;
+
+// Compiled-in backends, preferred first, NULL terminated
+extern const MatmulBackend *const matmul_backends[];
+
+// C is overwritten (K == 0 gives zeros). Returns 0 on success; failures
+// (no device, missing metallib) are reported on stderr.
+int matmul(const float *A, const float *B, float *C, int M, int N, int K);
+const char *matmul_backend_name(void);
+
+// batch independent products of the same shape in one call, so device
+// setup and thread start-up are paid once. Either pointer arrays (item i
+// is A[i], B[i], C[i]) or one base pointer per operand with a stride in
+// elements between items; a stride of 0 shares one A or B across the
+// batch (C items must not overlap). The CPU backend runs whole items on
+// each thread when there are enough of them.
+int matmul_batched(const float *const *A, const float *const *B, float *const *C,
+                   int M, int N, int K, int batch);
+int matmul_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                           float *C, long stride_c, int M, int N, int K, int batch);
+
+int matmul_cpu(const float *A, const float *B, float *C, int M, int N, int K);
+int matmul_cpu_batched(const float *const *A, const float *const *B, float *const *C,
+                       int M, int N, int K, int batch);
+int matmul_cpu_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                               float *C, long stride_c, int M, int N, int K, int batch);
+const char *matmul_cpu_name(void);
+#ifdef MATMUL_METAL
+// Tiled kernel (matmul_tiled in matmul.metal), and the one-thread-per-
+// element kernel it replaced, kept for comparison
+int matmul_metal(const float *A, const float *B, float *C, int M, int N, int K);
+int matmul_metal_batched(const float *const *A, const float *const *B, float *const *C,
+                         int M, int N, int K, int batch);
+int matmul_metal_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                                 float *C, long stride_c, int M, int N, int K, int batch);
+const char *matmul_metal_name(void);
+int matmul_metal_naive(const float *A, const float *B, float *C, int M, int N, int K);
+int matmul_metal_naive_batched(const float *const *A, const float *const *B, float *const *C,
+                               int M, int N, int K, int batch);
+int matmul_metal_naive_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                                       float *C, long stride_c, int M, int N, int K, int batch);
+const char *matmul_metal_naive_name(void);
+#endif
+
+// B packed once into the CPU microkernel's panel layout, for multiplying
+// a stream of A matrices (M x K, any M) by the same K x N B: each call
+// then skips repacking B. CPU only; the handle does not refer to B, so B
+// may change or be freed after packing. NULL when out of memory.
+typedef struct MatmulPackedB MatmulPackedB;
+MatmulPackedB *matmul_pack_b(const float *B, int K, int N);
+int matmul_packed(const float *A, const MatmulPackedB *B, float *C, int M);
+void matmul_free_packed_b(MatmulPackedB *B);
+
+// Sparse A in CSR: row i has nonzeros val[p] in columns col[p] for p in
+// [row_ptr[i], row_ptr[i + 1]), columns in any order, int offsets.
+typedef struct {
+    int rows, cols;
+    const int *row_ptr;   // rows + 1 entries
+    const int *col;
+    const float *val;
+} MatmulCsr;
+
+// C (A->rows x N) = A × B for sparse A and dense row-major B (A->cols x
+// N), on the CPU threads, each taking rows with about the same number of
+// nonzeros
+int matmul_csr(const MatmulCsr *A, const float *B, float *C, int N);
+const char *matmul_csr_name(void);
+// CSR copy of the nonzeros of a dense M x K matrix; matmul_csr_free
+// releases it. Returns 0, or 1 when out of memory or there are more than
+// INT_MAX nonzeros.
+int matmul_csr_from_dense(const float *A, int M, int K, MatmulCsr *out);
+void matmul_csr_free(MatmulCsr *A);
+// Fraction of the n elements that are nonzero
+double matmul_density(const float *A, long n);
+
+// matmul() for a dense-stored A, or matmul_csr() on its nonzeros when at
+// most MATMUL_SPARSE_DENSITY of them (and no more than INT_MAX) are
+// nonzero. bench --kind sparse puts the CPU crossover near 0.1 at
+// 1024-2048 (a prebuilt CSR); this one is a little lower so the
+// conversion on each call still pays.
+#define MATMUL_SPARSE_DENSITY 0.08
+int matmul_auto(const float *A, const float *B, float *C, int M, int N, int K);
+
+// Strassen-Winograd on the CPU (matmul_strassen.c): while every side is
+// above `cutoff` (0: MATMUL_STRASSEN_CUTOFF) a level replaces one of eight
+// quadrant products with fifteen quadrant additions; products at or below
+// it are matmul_cpu()'s. About 3.7 n^2 floats of workspace, kept between
+// calls. Returns 0, or 1 when out of memory.
+//
+// Its error is normwise rather than per element: max |C - A×B| stays
+// below matmul_strassen_bound() * u * max|A| * max|B| to first order
+// (u = FLT_EPSILON / 2), against K^2 for the conventional product.
+int matmul_strassen(const float *A, const float *B, float *C, int M, int N, int K, int cutoff);
+double matmul_strassen_bound(int M, int N, int K, int cutoff);
+
+// With MATMUL_STRASSEN=1 in the environment matmul_cpu() takes the
+// Strassen path for products with every side at least MATMUL_STRASSEN_MIN.
+// From bench --kind strassen: at 4096 a 1024 cutoff (two levels) is about
+// 20% faster; at 2048 and below the gain is under 10%, not worth the
+// accuracy, and smaller cutoffs lose it again to the additions.
+#define MATMUL_STRASSEN_CUTOFF 1024
+#define MATMUL_STRASSEN_MIN 4096
+
+// Low-precision inputs, CPU only (matmul_lowp.c). bf16 and fp16 are
+// uint16_t bit patterns, accumulated in float. int8 accumulates in int32,
+// exact as long as the true products fit; the scaled form takes
+// symmetric per-row scales of A and per-column scales of B
+// (matmul_quantize_rows/cols) and writes float. On CPUs with AVX-512
+// BF16 / VNNI those run as dot-product instructions; elsewhere packing
+// widens to float or int16.
+int matmul_bf16(const uint16_t *A, const uint16_t *B, float *C, int M, int N, int K);
+int matmul_fp16(const uint16_t *A, const uint16_t *B, float *C, int M, int N, int K);
+int matmul_s8(const int8_t *A, const int8_t *B, int32_t *C, int M, int N, int K);
+int matmul_s8_scaled(const int8_t *A, const float *scale_a, const int8_t *B, const float *scale_b,
+                     float *C, int M, int N, int K);
+const char *matmul_lowp_isa(void);   // e.g. "bf16 avx512bf16, fp16 f16c, int8 avx512vnni"
+
+// Round to nearest even; NaN stays NaN, fp16 overflows to infinity
+uint16_t matmul_bf16_from_float(float f);
+float matmul_bf16_to_float(uint16_t h);
+uint16_t matmul_fp16_from_float(float f);
+float matmul_fp16_to_float(uint16_t h);
+void matmul_bf16_from_floats(const float *src, uint16_t *dst, long n);
+void matmul_fp16_from_floats(const float *src, uint16_t *dst, long n);
+
+// X (rows x cols) -> round(X / scale) with scale = max |x| / 127 per row
+// (rows of A) or per column (columns of B); an all-zero line gets scale 1
+void matmul_quantize_rows(const float *X, int rows, int cols, int8_t *Q, float *scale);
+void matmul_quantize_cols(const float *X, int rows, int cols, int8_t *Q, float *scale);
+
+// Item i of a batch given either way, for the backends
+typedef struct {
+    const float *const *Ap, *const *Bp;
+    float *const *Cp;                    // pointer arrays, or NULL ...
+    const float *A, *B;
+    float *C;                            // ... base pointers and strides
+    long stride_a, stride_b, stride_c;
+} MatmulBatch;
+
+static inline const float *matmul_batch_a(const MatmulBatch *b, int i) {
+    return b->Ap ? b->Ap[i] : b->A + i * b->stride_a;
+}
+static inline const float *matmul_batch_b(const MatmulBatch *b, int i) {
+    return b->Bp ? b->Bp[i] : b->B + i * b->stride_b;
+}
+static inline float *matmul_batch_c(const MatmulBatch *b, int i) {
+    return b->Cp ? b->Cp[i] : b->C + i * b->stride_c;
+}
+
+// Tile edge T of the tiled Metal kernel: the largest power of two up to
+// MATMUL_MAX_TILE whose T x T threadgroup and two T x T float tiles fit
+// the pipeline's limits
+#define MATMUL_MAX_TILE 32
+int matmul_pick_tile(unsigned long max_threads, unsigned long max_threadgroup_bytes);
+
+// The tiled kernel's loop nest in C, threadgroup by threadgroup
+// (matmul_tiled.c), for testing the tiling without a GPU
+int matmul_tiled_emulated(const float *A, const float *B, float *C,
+                          int M, int N, int K, int tile);
+
+// Triple loop with double accumulation, for checking the backends
+void matmul_reference(const float *A, const float *B, float *C, int M, int N, int K);
+
+// Largest |C - A×B| over the elements, each relative to sum_k |A_ik B_kj|,
+// the most any rounding of that dot product can be off by. A correct
+// float backend stays below about K * FLT_EPSILON.
+double matmul_error(const float *A, const float *B, const float *C, int M, int N, int K);
+
+// The same over at most `samples` elements spread across C, for sizes
+// where the full O(MNK) check would take longer than the multiply
+double matmul_error_sampled(const float *A, const float *B, const float *C,
+                            int M, int N, int K, long samples);
+
+#endif
@@ -3,21 +3,70 @@ using namespace metal;
 
 // Compute C = A × B
 // A: MxK,  B: KxN,  C: MxN
+// Grid z is the batch item; the strides are the elements between items of
+// A, B and C (0 for an A or B shared by the whole batch). Same layout as
+// Params in matmul_metal.m; the host keeps every index below 2^32.
+struct Params {
+    uint M, N, K;
+    uint T;                  // tile edge, matmul_tiled only
+    uint stride_a, stride_b, stride_c;
+};
+
 kernel void matmul(
     device const float* A [[buffer(0)]],
     device const float* B [[buffer(1)]],
     device float*       C [[buffer(2)]],
-    constant uint& M     [[buffer(3)]],
-    constant uint& N     [[buffer(4)]],
-    constant uint& K     [[buffer(5)]],
-    uint2 gid            [[thread_position_in_grid]]
+    constant Params& p   [[buffer(3)]],
+    uint3 gid            [[thread_position_in_grid]]
 ) {
+    const uint M = p.M, N = p.N, K = p.K;
     if (gid.x >= N || gid.y >= M)
         return;
 
+    device const float* a = A + gid.z * p.stride_a;
+    device const float* b = B + gid.z * p.stride_b;
     float sum = 0.0;
     for (uint k = 0; k < K; ++k)
-        sum += A[gid.y * K + k] * B[k * N + gid.x];
+        sum += a[gid.y * K + k] * b[k * N + gid.x];
+
+    C[gid.z * p.stride_c + gid.y * N + gid.x] = sum;
+}
+
+// Same product, tiled: each threadgroup computes a T x T block of C,
+// walking K in steps of T. Per step every thread loads one element of A
+// and one of B into threadgroup memory, so each device read is reused T
+// times instead of once. T is chosen by the host (matmul_pick_tile) and
+// the dispatch is whole threadgroups, so out-of-range threads still take
+// part in the loads (as zeros) and the barriers. matmul_tiled.c is the
+// same loop nest in C, for one batch item.
+kernel void matmul_tiled(
+    device const float* A [[buffer(0)]],
+    device const float* B [[buffer(1)]],
+    device float*       C [[buffer(2)]],
+    constant Params& p   [[buffer(3)]],
+    threadgroup float* tiles [[threadgroup(0)]],   // 2 * T * T floats
+    uint3 gid            [[thread_position_in_grid]],
+    uint3 lid            [[thread_position_in_threadgroup]]
+) {
+    const uint M = p.M, N = p.N, K = p.K, T = p.T;
+    threadgroup float* As = tiles;          // T x T block of A, row-major
+    threadgroup float* Bs = tiles + T * T;  // T x T block of B, row-major
+    device const float* a = A + gid.z * p.stride_a;
+    device const float* b = B + gid.z * p.stride_b;
+    uint row = gid.y, col = gid.x;
+
+    float sum = 0.0;
+    for (uint k0 = 0; k0 < K; k0 += T) {
+        uint ak = k0 + lid.x, bk = k0 + lid.y;
+        As[lid.y * T + lid.x] = (row < M && ak < K) ? a[row * K + ak] : 0.0;
+        Bs[lid.y * T + lid.x] = (bk < K && col < N) ? b[bk * N + col] : 0.0;
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+
+        for (uint k = 0; k < T; ++k)
+            sum += As[lid.y * T + k] * Bs[k * T + lid.x];
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
 
-    C[gid.y * N + gid.x] = sum;
+    if (row < M && col < N)
+        C[gid.z * p.stride_c + row * N + col] = sum;
 }
@@ -0,0 +1,579 @@
+// CPU backend: cache-blocked SGEMM in the usual three-level layout. The
+// loop nest is generic over the element type (matmul_cpu.h); this file
+// has the float one, matmul_lowp.c the others.
+//
+// For each NC-wide column block of C and KC-deep slice of K, B is packed
+// into NR-wide panels (stays in L3/L2); for each MC-tall row block, A is
+// packed into MR-tall panels (stays in L2). The microkernel then keeps an
+// MR x NR tile of C in registers for the whole KC loop, reading both
+// panels sequentially. Panels are zero-padded, so edge tiles run the same
+// kernel and only their store is clipped.
+//
+// Threads each take a rectangle of C and run the whole blocked loop on it
+// with their own packing buffers, so they never synchronise. Batches of
+// small products are split by item instead: one thread per run of items,
+// each item a single-rectangle blocked loop. The threads and their
+// packing buffers are kept between calls (see the worker pool below).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "matmul.h"
+#include "matmul_cpu.h"
+
+#define NR NR_F32
+
+static int round_up(int v, int m) {
+    return (v + m - 1) / m * m;
+}
+
+// ------------------------------------------------------------
+// Microkernels: C[mr x nr] (+)= A panel × B panel
+// ------------------------------------------------------------
+
+void matmul_cpu_store_f32(const float *t, int tw, float *c, long ldc, int mr, int nr,
+                          int accumulate) {
+    for (int i = 0; i < mr; i++)
+        for (int j = 0; j < nr; j++)
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + t[i * tw + j] : t[i * tw + j];
+}
+
+static void kernel_scalar(int kc, const void *ap, const void *bp, void *c, long ldc,
+                          int mr, int nr, int accumulate) {
+    const float *a = ap, *b = bp;
+    float t[MR * NR] = { 0 };
+    for (int k = 0; k < kc; k++, a += MR, b += NR)
+        for (int i = 0; i < MR; i++)
+            for (int j = 0; j < NR; j++)
+                t[i * NR + j] += a[i] * b[j];
+    matmul_cpu_store_f32(t, NR, c, ldc, mr, nr, accumulate);
+}
+
+#ifdef MATMUL_X86
+// 12 accumulators + 2 B vectors + 1 broadcast A: 15 of the 16 ymm registers
+__attribute__((target("avx2,fma")))
+static void kernel_avx2(int kc, const void *ap, const void *bp, void *cp, long ldc,
+                        int mr, int nr, int accumulate) {
+    const float *a = ap, *b = bp;
+    float *c = cp;
+    __m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00;
+    __m256 c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m256 c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+        __m256 b0 = _mm256_load_ps(b), b1 = _mm256_load_ps(b + 8), ai;
+        ai = _mm256_broadcast_ss(a);     c00 = _mm256_fmadd_ps(ai, b0, c00); c01 = _mm256_fmadd_ps(ai, b1, c01);
+        ai = _mm256_broadcast_ss(a + 1); c10 = _mm256_fmadd_ps(ai, b0, c10); c11 = _mm256_fmadd_ps(ai, b1, c11);
+        ai = _mm256_broadcast_ss(a + 2); c20 = _mm256_fmadd_ps(ai, b0, c20); c21 = _mm256_fmadd_ps(ai, b1, c21);
+        ai = _mm256_broadcast_ss(a + 3); c30 = _mm256_fmadd_ps(ai, b0, c30); c31 = _mm256_fmadd_ps(ai, b1, c31);
+        ai = _mm256_broadcast_ss(a + 4); c40 = _mm256_fmadd_ps(ai, b0, c40); c41 = _mm256_fmadd_ps(ai, b1, c41);
+        ai = _mm256_broadcast_ss(a + 5); c50 = _mm256_fmadd_ps(ai, b0, c50); c51 = _mm256_fmadd_ps(ai, b1, c51);
+    }
+    __m256 rows[MR][2] = { { c00, c01 }, { c10, c11 }, { c20, c21 },
+                           { c30, c31 }, { c40, c41 }, { c50, c51 } };
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; i++) {
+            float *ci = c + i * ldc;
+            __m256 r0 = rows[i][0], r1 = rows[i][1];
+            if (accumulate) {
+                r0 = _mm256_add_ps(r0, _mm256_loadu_ps(ci));
+                r1 = _mm256_add_ps(r1, _mm256_loadu_ps(ci + 8));
+            }
+            _mm256_storeu_ps(ci, r0);
+            _mm256_storeu_ps(ci + 8, r1);
+        }
+    } else {
+        float t[MR * NR];
+        for (int i = 0; i < MR; i++) {
+            _mm256_storeu_ps(t + i * NR, rows[i][0]);
+            _mm256_storeu_ps(t + i * NR + 8, rows[i][1]);
+        }
+        matmul_cpu_store_f32(t, NR, c, ldc, mr, nr, accumulate);
+    }
+}
+#endif
+
+// Settings read once, whichever thread calls first
+static pthread_once_t settings_once = PTHREAD_ONCE_INIT;
+static int isa_cap, threads_env, strassen;
+
+static void read_settings(void) {
+    const char *env = getenv("MATMUL_ISA");
+    isa_cap = !env ? 2 : !strcmp(env, "scalar") ? 0 : !strcmp(env, "avx2") ? 1 : 2;
+    env = getenv("MATMUL_STRASSEN");
+    strassen = env && atoi(env) != 0;
+    env = getenv("MATMUL_THREADS");
+    threads_env = env ? atoi(env) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads_env < 1) threads_env = 1;
+}
+
+int matmul_cpu_isa_cap(void) {
+    pthread_once(&settings_once, read_settings);
+    return isa_cap;
+}
+
+void (*matmul_cpu_kernel_f32)(int kc, const void *a, const void *b, void *c, long ldc,
+                              int mr, int nr, int accumulate);
+static const char *isa = "scalar";
+
+static void pick_kernel(void) {
+    matmul_cpu_kernel_f32 = kernel_scalar;
+#ifdef MATMUL_X86
+    __builtin_cpu_init();
+    if (matmul_cpu_isa_cap() >= 1 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        matmul_cpu_kernel_f32 = kernel_avx2;
+        isa = "avx2+fma";
+    }
+#endif
+}
+
+void matmul_cpu_init(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, pick_kernel);
+}
+
+// ------------------------------------------------------------
+// Packing
+// ------------------------------------------------------------
+
+// kc x nc block of B (row stride ldb) -> NR-wide panels, each kc rows of NR
+static void pack_b_f32(const void *bp, long ldb, int kc, int nc, void *outp) {
+    const float *b = bp;
+    float *out = outp;
+    for (int j = 0; j < nc; j += NR) {
+        int w = nc - j < NR ? nc - j : NR;
+        for (int k = 0; k < kc; k++, out += NR) {
+            const float *src = b + k * ldb + j;
+            int x = 0;
+            for (; x < w; x++) out[x] = src[x];
+            for (; x < NR; x++) out[x] = 0.0f;
+        }
+    }
+}
+
+// mc x kc block of A (row stride lda) -> MR-tall panels, each kc columns of MR
+static void pack_a_f32(const void *ap, long lda, int mc, int kc, void *outp) {
+    const float *a = ap;
+    float *out = outp;
+    for (int i = 0; i < mc; i += MR) {
+        int h = mc - i < MR ? mc - i : MR;
+        for (int k = 0; k < kc; k++, out += MR) {
+            int y = 0;
+            for (; y < h; y++) out[y] = a[(i + y) * lda + k];
+            for (; y < MR; y++) out[y] = 0.0f;
+        }
+    }
+}
+
+static void kernel_f32(int kc, const void *a, const void *b, void *c, long ldc,
+                       int mr, int nr, int accumulate) {
+    matmul_cpu_kernel_f32(kc, a, b, c, ldc, mr, nr, accumulate);
+}
+
+static const GemmType f32 = {
+    .nr = NR, .kgroup = 1, .a_in = 4, .b_in = 4, .c_out = 4, .a_packed = 4, .b_packed = 4,
+    .pack_a = pack_a_f32, .pack_b = pack_b_f32, .kernel = kernel_f32,
+};
+
+// ------------------------------------------------------------
+// Blocked loop over one rectangle of C
+// ------------------------------------------------------------
+
+typedef struct {
+    const GemmType *g;
+    const char *A, *B;
+    char *C;
+    int K;
+    long lda, ldb, ldc;      // row strides, in elements
+    int m0, m1, n0, n1;      // this thread's rectangle of C
+    char *apack, *bpack;
+    const MatmulPackedB *packed;   // B already in panels (B and bpack unused)
+} Tile;
+
+static size_t a_panel_bytes(const GemmType *g, int kc) {
+    return (size_t)MR * round_up(kc, g->kgroup) * g->a_packed;
+}
+
+static size_t b_panel_bytes(const GemmType *g, int kc) {
+    return (size_t)g->nr * round_up(kc, g->kgroup) * g->b_packed + g->b_extra;
+}
+
+static void *run_tile(void *arg) {
+    Tile *t = arg;
+    const GemmType *g = t->g;
+    for (int jc = t->n0; jc < t->n1; jc += NC) {
+        int nc = t->n1 - jc < NC ? t->n1 - jc : NC;
+        for (int pc = 0; pc < t->K; pc += KC) {
+            int kc = t->K - pc < KC ? t->K - pc : KC;
+            size_t ap = a_panel_bytes(g, kc), bp = b_panel_bytes(g, kc);
+            const char *bpanels = t->bpack;
+            if (t->packed)   // jc is a multiple of nr, so its panel is whole
+                bpanels = t->packed->data + pc / KC * t->packed->slice_bytes + jc / g->nr * bp;
+            else
+                g->pack_b(t->B + (pc * t->ldb + jc) * g->b_in, t->ldb, kc, nc, t->bpack);
+            for (int ic = t->m0; ic < t->m1; ic += MC) {
+                int mc = t->m1 - ic < MC ? t->m1 - ic : MC;
+                g->pack_a(t->A + (ic * t->lda + pc) * g->a_in, t->lda, mc, kc, t->apack);
+                for (int jr = 0; jr < nc; jr += g->nr)
+                    for (int ir = 0; ir < mc; ir += MR)
+                        g->kernel(kc, t->apack + ir / MR * ap, bpanels + jr / g->nr * bp,
+                                  t->C + ((ic + ir) * t->ldc + jc + jr) * g->c_out, t->ldc,
+                                  mc - ir < MR ? mc - ir : MR, nc - jr < g->nr ? nc - jr : g->nr,
+                                  pc > 0);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int thread_count(void) {
+    pthread_once(&settings_once, read_settings);
+    return threads_env;
+}
+
+// Split C into rows x cols rectangles for t threads: the grid whose
+// rectangles have the smallest perimeter, i.e. the least packing each.
+// With B packed beforehand only A is packed, once per column of
+// rectangles: then as many rows as still each get part of M.
+static void split(int M, int N, int nr, int t, int b_packed, int *rows, int *cols) {
+    if (b_packed) {
+        for (int r = t; r >= 1; r--)
+            if (t % r == 0 && (long)(r - 1) * round_up((M + r - 1) / r, MR) < M) {
+                *rows = r;
+                *cols = t / r;
+                return;
+            }
+    }
+    long best = -1;
+    for (int r = 1; r <= t; r++) {
+        if (t % r) continue;
+        int c = t / r;
+        long h = round_up((M + r - 1) / r, MR), w = round_up((N + c - 1) / c, nr);
+        if (best < 0 || h + w < best) {
+            best = h + w;
+            *rows = r;
+            *cols = c;
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// Worker pool
+// ------------------------------------------------------------
+
+// thread_count() - 1 workers started on first use and kept, each with its
+// own packing buffers, so a call costs a wake-up and a wait instead of
+// creating threads and faulting in fresh buffers. Job i of a call runs on
+// slot i: the caller is slot 0, worker w is slot w. One call at a time;
+// concurrent callers queue on `busy`.
+static struct {
+    pthread_mutex_t busy, lock;
+    pthread_cond_t start, done;
+    int started;
+    long generation;         // bumped per call, workers wait for a new one
+    void *(*fn)(void *);
+    char *args;              // jobs of `size` bytes each
+    size_t size;
+    int jobs, pending;
+    struct { char *p; size_t bytes; } *work;   // packing buffers per slot
+} pool = {
+    .busy = PTHREAD_MUTEX_INITIALIZER, .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER,
+};
+
+static void *worker(void *arg) {
+    int slot = (int)(intptr_t)arg;
+    long seen = 0;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen)
+            pthread_cond_wait(&pool.start, &pool.lock);
+        seen = pool.generation;
+        if (slot >= pool.jobs) continue;
+        void *(*fn)(void *) = pool.fn;
+        void *job = pool.args + pool.size * slot;
+        pthread_mutex_unlock(&pool.lock);
+        fn(job);
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    return NULL;
+}
+
+// Take the pool for one call, starting it the first time
+static void pool_acquire(void) {
+    pthread_mutex_lock(&pool.busy);
+    if (pool.started) return;
+    pool.started = 1;
+    int n = thread_count();
+    pool.work = calloc(n, sizeof(*pool.work));
+    if (!pool.work) {
+        fprintf(stderr, "matmul: out of memory\n");
+        exit(1);
+    }
+    for (int w = 1; w < n; w++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker, (void *)(intptr_t)w) != 0) {
+            fprintf(stderr, "matmul: pthread_create failed\n");
+            exit(1);
+        }
+        pthread_detach(tid);
+    }
+}
+
+static void pool_release(void) {
+    pthread_mutex_unlock(&pool.busy);
+}
+
+// fn on each of the n jobs in args (n <= thread_count()), job 0 on the caller
+static void pool_run(void *(*fn)(void *), void *args, size_t size, int n) {
+    if (n > 1) {
+        pthread_mutex_lock(&pool.lock);
+        pool.fn = fn;
+        pool.args = args;
+        pool.size = size;
+        pool.jobs = n;
+        pool.pending = n - 1;
+        pool.generation++;
+        pthread_cond_broadcast(&pool.start);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    fn(args);
+    if (n > 1) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.pending)
+            pthread_cond_wait(&pool.done, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+void matmul_cpu_parallel(void *(*fn)(void *), void *jobs, size_t size, int n) {
+    pool_acquire();
+    pool_run(fn, jobs, size, n);
+    pool_release();
+}
+
+int matmul_cpu_threads(void) {
+    return thread_count();
+}
+
+const char *matmul_cpu_isa(void) {
+    matmul_cpu_init();
+    return isa;
+}
+
+// Slot's packing buffers for a rectangle up to w columns wide, grown as
+// needed and kept for the next call
+static void alloc_packs(Tile *t, int slot, int K, int w) {
+    const GemmType *g = t->g;
+    int kc = K < KC ? K : KC, panels = ((w < NC ? w : NC) + g->nr - 1) / g->nr;
+    size_t apack = round_up(MC / MR * a_panel_bytes(g, kc), 64);
+    size_t bytes = round_up(apack + panels * b_panel_bytes(g, kc), 64);
+    if (pool.work[slot].bytes < bytes) {
+        free(pool.work[slot].p);
+        pool.work[slot].p = aligned_alloc(64, bytes);
+        pool.work[slot].bytes = bytes;
+        if (!pool.work[slot].p) {
+            fprintf(stderr, "matmul: out of memory\n");
+            exit(1);
+        }
+    }
+    t->apack = pool.work[slot].p;
+    t->bpack = t->apack + apack;
+}
+
+// Either B or packed (then N and K are the packed ones); rows of A, B and
+// C are lda, ldb and ldc elements apart
+static int gemm(const GemmType *g, const void *A, long lda, const void *B, long ldb,
+                const MatmulPackedB *packed, void *C, long ldc, int M, int N, int K) {
+    if (M <= 0 || N <= 0) return 0;
+    if (K <= 0) {
+        for (int i = 0; i < M; i++)
+            memset((char *)C + i * ldc * g->c_out, 0, (size_t)g->c_out * N);
+        return 0;
+    }
+
+    long work = (long)M * N * K;
+    int threads = thread_count();
+    if (threads > work / MIN_WORK_PER_THREAD) threads = work / MIN_WORK_PER_THREAD;
+    if (threads < 1) threads = 1;
+    int rows = 1, cols = 1;
+    split(M, N, g->nr, threads, packed != NULL, &rows, &cols);
+
+    // Rectangle edges on MR/nr multiples so only the last ones have ragged tiles
+    int h = round_up((M + rows - 1) / rows, MR), w = round_up((N + cols - 1) / cols, g->nr);
+
+    pool_acquire();
+    Tile tiles[rows * cols];
+    int n = 0;
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < cols; c++) {
+            Tile *t = &tiles[n];
+            t->g = g; t->A = A; t->B = B; t->C = C; t->K = K; t->packed = packed;
+            t->lda = lda; t->ldb = ldb; t->ldc = ldc;
+            t->m0 = r * h;
+            t->m1 = t->m0 + h < M ? t->m0 + h : M;
+            t->n0 = c * w;
+            t->n1 = t->n0 + w < N ? t->n0 + w : N;
+            if (t->m0 >= t->m1 || t->n0 >= t->n1) continue;
+            alloc_packs(t, n, K, packed ? 0 : w);
+            n++;
+        }
+    pool_run(run_tile, tiles, sizeof(Tile), n);
+    pool_release();
+    return 0;
+}
+
+int matmul_cpu_gemm(const GemmType *g, const void *A, const void *B, void *C,
+                    int M, int N, int K) {
+    return gemm(g, A, K, B, N, NULL, C, N, M, N, K);
+}
+
+// ------------------------------------------------------------
+// B packed once
+// ------------------------------------------------------------
+
+// Each KC slice of K as the panels of all N columns, in the order run_tile
+// reads them, so any rectangle starting on a panel edge finds its panels
+// at slice + column / nr * panel size
+MatmulPackedB *matmul_cpu_pack_b(const GemmType *g, const void *B, int K, int N) {
+    MatmulPackedB *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->g = g;
+    p->K = K > 0 ? K : 0;
+    p->N = N > 0 ? N : 0;
+    int panels = (p->N + g->nr - 1) / g->nr, kc0 = p->K < KC ? p->K : KC;
+    p->slice_bytes = panels * b_panel_bytes(g, kc0);
+    size_t bytes = 0;
+    for (int pc = 0; pc < p->K; pc += KC)
+        bytes += panels * b_panel_bytes(g, p->K - pc < KC ? p->K - pc : KC);
+    p->data = aligned_alloc(64, round_up(bytes ? bytes : 1, 64));
+    if (!p->data) {
+        free(p);
+        return NULL;
+    }
+    for (int pc = 0; pc < p->K; pc += KC) {
+        int kc = p->K - pc < KC ? p->K - pc : KC;
+        char *slice = p->data + pc / KC * p->slice_bytes;
+        for (int jc = 0; jc < p->N; jc += NC)   // pack_b takes at most NC columns
+            g->pack_b((const char *)B + ((long)pc * N + jc) * g->b_in, N, kc,
+                      p->N - jc < NC ? p->N - jc : NC, slice + jc / g->nr * b_panel_bytes(g, kc));
+    }
+    return p;
+}
+
+int matmul_cpu_gemm_packed(const void *A, const MatmulPackedB *B, void *C, int M) {
+    return gemm(B->g, A, B->K, NULL, 0, B, C, B->N, M, B->N, B->K);
+}
+
+MatmulPackedB *matmul_pack_b(const float *B, int K, int N) {
+    matmul_cpu_init();
+    return matmul_cpu_pack_b(&f32, B, K, N);
+}
+
+int matmul_packed(const float *A, const MatmulPackedB *B, float *C, int M) {
+    return matmul_cpu_gemm_packed(A, B, C, M);
+}
+
+void matmul_free_packed_b(MatmulPackedB *B) {
+    if (!B) return;
+    free(B->data);
+    free(B);
+}
+
+int matmul_cpu(const float *A, const float *B, float *C, int M, int N, int K) {
+    matmul_cpu_init();
+    pthread_once(&settings_once, read_settings);
+    if (strassen && M >= MATMUL_STRASSEN_MIN && N >= MATMUL_STRASSEN_MIN && K >= MATMUL_STRASSEN_MIN)
+        return matmul_strassen(A, B, C, M, N, K, 0);
+    return matmul_cpu_gemm(&f32, A, B, C, M, N, K);
+}
+
+int matmul_cpu_ld(const float *A, long lda, const float *B, long ldb, float *C, long ldc,
+                  int M, int N, int K) {
+    matmul_cpu_init();
+    return gemm(&f32, A, lda, B, ldb, NULL, C, ldc, M, N, K);
+}
+
+// ------------------------------------------------------------
+// Batches: each thread takes a run of whole items
+// ------------------------------------------------------------
+
+typedef struct {
+    const MatmulBatch *batch;
+    int first, last;
+    Tile tile;               // whole-matrix rectangle, this thread's buffers
+} BatchRun;
+
+static void *run_items(void *arg) {
+    BatchRun *r = arg;
+    for (int i = r->first; i < r->last; i++) {
+        r->tile.A = (const char *)matmul_batch_a(r->batch, i);
+        r->tile.B = (const char *)matmul_batch_b(r->batch, i);
+        r->tile.C = (char *)matmul_batch_c(r->batch, i);
+        run_tile(&r->tile);
+    }
+    return NULL;
+}
+
+static int run_batch(const MatmulBatch *b, int M, int N, int K, int batch) {
+    if (batch <= 0 || M <= 0 || N <= 0) return 0;
+    if (K <= 0) {
+        for (int i = 0; i < batch; i++)
+            memset(matmul_batch_c(b, i), 0, sizeof(float) * M * N);
+        return 0;
+    }
+    matmul_cpu_init();
+
+    long work = (long)M * N * K;
+    int threads = thread_count();
+    // Fewer items than threads: better to split each item between them
+    if (batch < threads && work >= MIN_WORK_PER_THREAD * 2) {
+        for (int i = 0; i < batch; i++)
+            matmul_cpu(matmul_batch_a(b, i), matmul_batch_b(b, i), matmul_batch_c(b, i), M, N, K);
+        return 0;
+    }
+    if (threads > batch) threads = batch;
+    if (threads > work * batch / MIN_WORK_PER_THREAD) threads = work * batch / MIN_WORK_PER_THREAD;
+    if (threads < 1) threads = 1;
+
+    pool_acquire();
+    BatchRun runs[threads];
+    for (int t = 0; t < threads; t++) {
+        BatchRun *r = &runs[t];
+        r->batch = b;
+        r->first = (long)batch * t / threads;
+        r->last = (long)batch * (t + 1) / threads;
+        r->tile = (Tile){ .g = &f32, .K = K, .lda = K, .ldb = N, .ldc = N,
+                          .m0 = 0, .m1 = M, .n0 = 0, .n1 = N };
+        alloc_packs(&r->tile, t, K, N);
+    }
+    pool_run(run_items, runs, sizeof(BatchRun), threads);
+    pool_release();
+    return 0;
+}
+
+int matmul_cpu_batched(const float *const *A, const float *const *B, float *const *C,
+                       int M, int N, int K, int batch) {
+    MatmulBatch b = { .Ap = A, .Bp = B, .Cp = C };
+    return run_batch(&b, M, N, K, batch);
+}
+
+int matmul_cpu_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                               float *C, long stride_c, int M, int N, int K, int batch) {
+    MatmulBatch b = { .A = A, .B = B, .C = C,
+                      .stride_a = stride_a, .stride_b = stride_b, .stride_c = stride_c };
+    return run_batch(&b, M, N, K, batch);
+}
+
+const char *matmul_cpu_name(void) {
+    static char name[64];
+    matmul_cpu_init();
+    snprintf(name, sizeof(name), "CPU (%s, %d thread%s)", isa, thread_count(),
+             thread_count() == 1 ? "" : "s");
+    return name;
+}
@@ -0,0 +1,93 @@
+// Internals of the CPU backend, shared by the float path (matmul_cpu.c)
+// and the low-precision ones (matmul_lowp.c).
+//
+// The blocked loop nest is the same for every element type; a GemmType
+// says how a block of A or B is packed into panels (converting or
+// interleaving as it goes) and which microkernel runs on the panels.
+// Packing works on groups of kgroup consecutive K values, zero-padded,
+// so dot-product instructions that consume two or four K steps at once
+// (bf16 pairs, int8 quads) see whole groups.
+
+#ifndef MATMUL_CPU_H
+#define MATMUL_CPU_H
+
+#include <stddef.h>
+
+#include "matmul.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(MATMUL_NO_SIMD)
+#define MATMUL_X86
+#include <immintrin.h>
+#endif
+
+#define MR 6         // rows of every microkernel
+#define MC 96        // multiple of MR
+#define KC 256       // multiple of every kgroup
+#define NC 2048      // multiple of every nr
+
+// Below this many multiply-adds per thread, extra threads cost more than
+// they save
+#define MIN_WORK_PER_THREAD (64L * 64 * 64)
+
+typedef struct {
+    int nr;                  // columns of the microkernel, divides NC
+    int kgroup;              // K values packed together (1, 2 or 4)
+    int a_in, b_in, c_out;   // element bytes of A, B and C
+    int a_packed, b_packed;  // element bytes in the panels
+    int b_extra;             // bytes after each B panel, for the kernel's use
+
+    // mc x kc block of A (row stride lda elements) -> MR-tall panels
+    void (*pack_a)(const void *a, long lda, int mc, int kc, void *out);
+    // kc x nc block of B (row stride ldb elements) -> nr-wide panels
+    void (*pack_b)(const void *b, long ldb, int kc, int nc, void *out);
+    // C[mr x nr] (+)= A panel × B panel, kc deep (before padding)
+    void (*kernel)(int kc, const void *a, const void *b, void *c, long ldc,
+                   int mr, int nr, int accumulate);
+} GemmType;
+
+// Blocked product of one type over the whole matrix, threaded like
+// matmul_cpu(). Returns 0.
+int matmul_cpu_gemm(const GemmType *g, const void *A, const void *B, void *C,
+                    int M, int N, int K);
+
+// B packed once for the layout run_tile reads (matmul_pack_b): each KC
+// slice of K holds the nr-wide panels of all N columns, slice_bytes apart
+struct MatmulPackedB {
+    const GemmType *g;
+    int K, N;
+    size_t slice_bytes;
+    char *data;
+};
+
+// matmul_cpu() on submatrices: rows of A, B and C are lda, ldb and ldc
+// floats apart (the Strassen layer's quadrants)
+int matmul_cpu_ld(const float *A, long lda, const float *B, long ldb, float *C, long ldc,
+                  int M, int N, int K);
+
+MatmulPackedB *matmul_cpu_pack_b(const GemmType *g, const void *B, int K, int N);
+int matmul_cpu_gemm_packed(const void *A, const MatmulPackedB *B, void *C, int M);
+
+// Pick the float microkernel for this CPU; once, before any threads
+void matmul_cpu_init(void);
+
+// The float microkernel (MR x NR_F32, kgroup 1), for types that convert
+// to float while packing
+#define NR_F32 16
+extern void (*matmul_cpu_kernel_f32)(int kc, const void *a, const void *b, void *c, long ldc,
+                                     int mr, int nr, int accumulate);
+
+// Highest instruction set level allowed: 0 scalar, 1 AVX2, 2 AVX-512,
+// lowered with MATMUL_ISA=scalar|avx2 for testing the fallbacks
+int matmul_cpu_isa_cap(void);
+
+// fn on each of n jobs (n <= matmul_cpu_threads()) on the worker pool,
+// job 0 on the calling thread; jobs are `size` bytes apart
+void matmul_cpu_parallel(void *(*fn)(void *), void *jobs, size_t size, int n);
+int matmul_cpu_threads(void);        // MATMUL_THREADS, else the online CPUs
+const char *matmul_cpu_isa(void);    // float microkernel, e.g. "avx2+fma"
+
+// Write a float tile (row stride tw) to C, clipped to mr x nr
+void matmul_cpu_store_f32(const float *t, int tw, float *c, long ldc, int mr, int nr,
+                          int accumulate);
+
+#endif
@@ -0,0 +1,492 @@
+// Low-precision inputs on the CPU: bf16 and fp16 with float accumulation,
+// int8 with int32 accumulation. All run the blocked loop of matmul_cpu.c
+// with their own packing and microkernels:
+//
+//   bf16  AVX-512 BF16: pairs of K values interleaved per column, one
+//         vdpbf16ps per pair. Otherwise converted to float while packing
+//         and run through the float microkernel.
+//   fp16  converted to float while packing (F16C when available); there
+//         is no fp16 dot product that accumulates in fp32.
+//   int8  AVX-512 VNNI: quads of K interleaved, one vpdpbusd per quad.
+//         vpdpbusd multiplies unsigned by signed bytes, so A is packed
+//         as a + 128 and 128 * (column sum of B) taken off at the end.
+//         Otherwise pairs widened to int16 for vpmaddwd (AVX2), or plain
+//         C on the same layout.
+//
+// Inputs stay half or a quarter of the float size until they reach the
+// packed panels, which is where the memory traffic goes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "matmul.h"
+#include "matmul_cpu.h"
+
+#define NR_WIDE 32   // columns of the AVX-512 microkernels
+
+// ------------------------------------------------------------
+// Conversions
+// ------------------------------------------------------------
+
+uint16_t matmul_bf16_from_float(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    if ((u & 0x7fffffff) > 0x7f800000) return (u >> 16) | 0x40;   // quiet NaN
+    u += 0x7fff + ((u >> 16) & 1);                                  // round to nearest even
+    return u >> 16;
+}
+
+float matmul_bf16_to_float(uint16_t h) {
+    uint32_t u = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+uint16_t matmul_fp16_from_float(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    uint32_t sign = (u >> 16) & 0x8000, abs = u & 0x7fffffff;
+    if (abs > 0x7f800000) return sign | 0x7e00;      // NaN
+    if (abs >= 0x477ff000) return sign | 0x7c00;     // 65520 and up round to infinity
+    if (abs < 0x38800000) {                          // below 2^-14: subnormal half
+        if (abs < 0x33000000) return sign;           // below 2^-25: zero
+        uint32_t mant = (abs & 0x7fffff) | 0x800000;
+        int shift = 126 - (int)(abs >> 23);          // to units of 2^-24
+        uint32_t h = mant >> shift, rem = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (h & 1))) h++;
+        return sign | h;
+    }
+    uint32_t h = (abs >> 13) - (112 << 10), rem = abs & 0x1fff;   // rebias 127 -> 15
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;          // may carry into the exponent
+    return sign | h;
+}
+
+float matmul_fp16_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16, e = (h >> 10) & 0x1f, m = h & 0x3ff, u;
+    if (e == 0x1f) u = sign | 0x7f800000 | (m << 13);
+    else if (e) u = sign | ((e + 112) << 23) | (m << 13);
+    else {
+        float f = m * 5.9604644775390625e-8f;       // m * 2^-24, exact
+        return sign ? -f : f;
+    }
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+void matmul_bf16_from_floats(const float *src, uint16_t *dst, long n) {
+    for (long i = 0; i < n; i++) dst[i] = matmul_bf16_from_float(src[i]);
+}
+
+void matmul_fp16_from_floats(const float *src, uint16_t *dst, long n) {
+    for (long i = 0; i < n; i++) dst[i] = matmul_fp16_from_float(src[i]);
+}
+
+// Symmetric: scale = max |x| / 127 over the row (or column), q = round(x / scale)
+static void quantize(const float *X, long step, long stride, int count, int len,
+                     int8_t *Q, float *scale) {
+    for (int r = 0; r < count; r++) {
+        const float *x = X + r * stride;
+        float m = 0.0f;
+        for (int i = 0; i < len; i++)
+            if (fabsf(x[i * step]) > m) m = fabsf(x[i * step]);
+        scale[r] = m > 0.0f ? m / 127.0f : 1.0f;
+        for (int i = 0; i < len; i++)
+            Q[r * stride + i * step] = (int8_t)lrintf(x[i * step] / scale[r]);
+    }
+}
+
+void matmul_quantize_rows(const float *X, int rows, int cols, int8_t *Q, float *scale) {
+    quantize(X, 1, cols, rows, cols, Q, scale);
+}
+
+void matmul_quantize_cols(const float *X, int rows, int cols, int8_t *Q, float *scale) {
+    quantize(X, cols, 1, cols, rows, Q, scale);
+}
+
+// ------------------------------------------------------------
+// 16-bit floats converted to float while packing (NR_F32 panels)
+// ------------------------------------------------------------
+
+typedef float (*ToFloat)(uint16_t);
+
+static void pack_a_to_f32(const uint16_t *a, long lda, int mc, int kc, float *out, ToFloat cvt) {
+    for (int i = 0; i < mc; i += MR) {
+        int h = mc - i < MR ? mc - i : MR;
+        for (int k = 0; k < kc; k++, out += MR) {
+            int y = 0;
+            for (; y < h; y++) out[y] = cvt(a[(i + y) * lda + k]);
+            for (; y < MR; y++) out[y] = 0.0f;
+        }
+    }
+}
+
+static void pack_b_to_f32(const uint16_t *b, long ldb, int kc, int nc, float *out, ToFloat cvt) {
+    for (int j = 0; j < nc; j += NR_F32) {
+        int w = nc - j < NR_F32 ? nc - j : NR_F32;
+        for (int k = 0; k < kc; k++, out += NR_F32) {
+            const uint16_t *src = b + k * ldb + j;
+            int x = 0;
+            for (; x < w; x++) out[x] = cvt(src[x]);
+            for (; x < NR_F32; x++) out[x] = 0.0f;
+        }
+    }
+}
+
+static void pack_a_bf16_f32(const void *a, long lda, int mc, int kc, void *out) {
+    pack_a_to_f32(a, lda, mc, kc, out, matmul_bf16_to_float);
+}
+static void pack_b_bf16_f32(const void *b, long ldb, int kc, int nc, void *out) {
+    pack_b_to_f32(b, ldb, kc, nc, out, matmul_bf16_to_float);
+}
+static void pack_a_fp16_f32(const void *a, long lda, int mc, int kc, void *out) {
+    pack_a_to_f32(a, lda, mc, kc, out, matmul_fp16_to_float);
+}
+static void pack_b_fp16_f32(const void *b, long ldb, int kc, int nc, void *out) {
+    pack_b_to_f32(b, ldb, kc, nc, out, matmul_fp16_to_float);
+}
+
+#ifdef MATMUL_X86
+// Whole 16-wide panel rows with two vcvtph2ps
+__attribute__((target("avx,f16c")))
+static void pack_b_fp16_f16c(const void *bp, long ldb, int kc, int nc, void *outp) {
+    const uint16_t *b = bp;
+    float *out = outp;
+    for (int j = 0; j < nc; j += NR_F32) {
+        if (nc - j < NR_F32) {
+            pack_b_to_f32(b + j, ldb, kc, nc - j, out, matmul_fp16_to_float);
+            break;
+        }
+        for (int k = 0; k < kc; k++, out += NR_F32) {
+            const uint16_t *src = b + k * ldb + j;
+            _mm256_storeu_ps(out, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)src)));
+            _mm256_storeu_ps(out + 8, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + 8))));
+        }
+    }
+}
+#endif
+
+static void kernel_f32(int kc, const void *a, const void *b, void *c, long ldc,
+                       int mr, int nr, int accumulate) {
+    matmul_cpu_kernel_f32(kc, a, b, c, ldc, mr, nr, accumulate);
+}
+
+// ------------------------------------------------------------
+// bf16 pairs for AVX-512 BF16
+// ------------------------------------------------------------
+
+#ifdef MATMUL_X86
+// K padded to pairs; element (k, row or column) of a panel is at
+// (k / 2 * width + index) * 2 + k % 2
+static void pack_a_bf16_pairs(const void *ap, long lda, int mc, int kc, void *outp) {
+    const uint16_t *a = ap;
+    uint16_t *out = outp;
+    int kp = (kc + 1) / 2;
+    for (int i = 0; i < mc; i += MR, out += MR * kp * 2) {
+        int h = mc - i < MR ? mc - i : MR;
+        for (int g = 0; g < kp; g++)
+            for (int y = 0; y < MR; y++)
+                for (int q = 0; q < 2; q++) {
+                    int k = 2 * g + q;
+                    out[(g * MR + y) * 2 + q] = y < h && k < kc ? a[(i + y) * lda + k] : 0;
+                }
+    }
+}
+
+static void pack_b_bf16_pairs(const void *bp, long ldb, int kc, int nc, void *outp) {
+    const uint16_t *b = bp;
+    uint16_t *out = outp;
+    int kp = (kc + 1) / 2;
+    for (int j = 0; j < nc; j += NR_WIDE, out += NR_WIDE * kp * 2) {
+        int w = nc - j < NR_WIDE ? nc - j : NR_WIDE;
+        if (w < NR_WIDE || kc % 2) memset(out, 0, sizeof(*out) * NR_WIDE * kp * 2);
+        for (int k = 0; k < kc; k++)   // row by row, reading B in order
+            for (int x = 0; x < w; x++)
+                out[(k / 2 * NR_WIDE + x) * 2 + k % 2] = b[k * ldb + j + x];
+    }
+}
+
+__attribute__((target("avx512f,avx512bf16")))
+static void kernel_bf16_avx512(int kc, const void *ap, const void *bp, void *cp, long ldc,
+                               int mr, int nr, int accumulate) {
+    const int32_t *a = ap;      // one bf16 pair per int32
+    const char *b = bp;
+    float *c = cp;
+    __m512 c00 = _mm512_setzero_ps(), c01 = c00, c10 = c00, c11 = c00;
+    __m512 c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m512 c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (int g = 0; g < (kc + 1) / 2; g++, a += MR, b += 128) {
+        __m512bh b0 = (__m512bh)_mm512_loadu_si512(b), b1 = (__m512bh)_mm512_loadu_si512(b + 64), ai;
+        ai = (__m512bh)_mm512_set1_epi32(a[0]); c00 = _mm512_dpbf16_ps(c00, ai, b0); c01 = _mm512_dpbf16_ps(c01, ai, b1);
+        ai = (__m512bh)_mm512_set1_epi32(a[1]); c10 = _mm512_dpbf16_ps(c10, ai, b0); c11 = _mm512_dpbf16_ps(c11, ai, b1);
+        ai = (__m512bh)_mm512_set1_epi32(a[2]); c20 = _mm512_dpbf16_ps(c20, ai, b0); c21 = _mm512_dpbf16_ps(c21, ai, b1);
+        ai = (__m512bh)_mm512_set1_epi32(a[3]); c30 = _mm512_dpbf16_ps(c30, ai, b0); c31 = _mm512_dpbf16_ps(c31, ai, b1);
+        ai = (__m512bh)_mm512_set1_epi32(a[4]); c40 = _mm512_dpbf16_ps(c40, ai, b0); c41 = _mm512_dpbf16_ps(c41, ai, b1);
+        ai = (__m512bh)_mm512_set1_epi32(a[5]); c50 = _mm512_dpbf16_ps(c50, ai, b0); c51 = _mm512_dpbf16_ps(c51, ai, b1);
+    }
+    __m512 rows[MR][2] = { { c00, c01 }, { c10, c11 }, { c20, c21 },
+                           { c30, c31 }, { c40, c41 }, { c50, c51 } };
+    if (mr == MR && nr == NR_WIDE) {
+        for (int i = 0; i < MR; i++) {
+            float *ci = c + i * ldc;
+            __m512 r0 = rows[i][0], r1 = rows[i][1];
+            if (accumulate) {
+                r0 = _mm512_add_ps(r0, _mm512_loadu_ps(ci));
+                r1 = _mm512_add_ps(r1, _mm512_loadu_ps(ci + 16));
+            }
+            _mm512_storeu_ps(ci, r0);
+            _mm512_storeu_ps(ci + 16, r1);
+        }
+    } else {
+        float t[MR * NR_WIDE];
+        for (int i = 0; i < MR; i++) {
+            _mm512_storeu_ps(t + i * NR_WIDE, rows[i][0]);
+            _mm512_storeu_ps(t + i * NR_WIDE + 16, rows[i][1]);
+        }
+        matmul_cpu_store_f32(t, NR_WIDE, c, ldc, mr, nr, accumulate);
+    }
+}
+#endif
+
+// ------------------------------------------------------------
+// int8
+// ------------------------------------------------------------
+
+static void store_s32(const int32_t *t, int tw, int32_t *c, long ldc, int mr, int nr, int accumulate) {
+    for (int i = 0; i < mr; i++)
+        for (int j = 0; j < nr; j++)
+            c[i * ldc + j] = accumulate ? (int32_t)((uint32_t)c[i * ldc + j] + (uint32_t)t[i * tw + j])
+                                        : t[i * tw + j];
+}
+
+// Pairs widened to int16, same interleaving as the bf16 pairs
+static void pack_a_s8_pairs(const void *ap, long lda, int mc, int kc, void *outp) {
+    const int8_t *a = ap;
+    int16_t *out = outp;
+    int kp = (kc + 1) / 2;
+    for (int i = 0; i < mc; i += MR, out += MR * kp * 2) {
+        int h = mc - i < MR ? mc - i : MR;
+        for (int g = 0; g < kp; g++)
+            for (int y = 0; y < MR; y++)
+                for (int q = 0; q < 2; q++) {
+                    int k = 2 * g + q;
+                    out[(g * MR + y) * 2 + q] = y < h && k < kc ? a[(i + y) * lda + k] : 0;
+                }
+    }
+}
+
+static void pack_b_s8_pairs(const void *bp, long ldb, int kc, int nc, void *outp) {
+    const int8_t *b = bp;
+    int16_t *out = outp;
+    int kp = (kc + 1) / 2;
+    for (int j = 0; j < nc; j += NR_F32, out += NR_F32 * kp * 2) {
+        int w = nc - j < NR_F32 ? nc - j : NR_F32;
+        if (w < NR_F32 || kc % 2) memset(out, 0, sizeof(*out) * NR_F32 * kp * 2);
+        for (int k = 0; k < kc; k++)
+            for (int x = 0; x < w; x++)
+                out[(k / 2 * NR_F32 + x) * 2 + k % 2] = b[k * ldb + j + x];
+    }
+}
+
+static void kernel_s8_scalar(int kc, const void *ap, const void *bp, void *c, long ldc,
+                             int mr, int nr, int accumulate) {
+    const int16_t *a = ap, *b = bp;
+    int32_t t[MR * NR_F32] = { 0 };
+    for (int g = 0; g < (kc + 1) / 2; g++, a += 2 * MR, b += 2 * NR_F32)
+        for (int i = 0; i < MR; i++)
+            for (int j = 0; j < NR_F32; j++)
+                t[i * NR_F32 + j] += a[2 * i] * b[2 * j] + a[2 * i + 1] * b[2 * j + 1];
+    store_s32(t, NR_F32, c, ldc, mr, nr, accumulate);
+}
+
+#ifdef MATMUL_X86
+__attribute__((target("avx2")))
+static void kernel_s8_avx2(int kc, const void *ap, const void *bp, void *cp, long ldc,
+                           int mr, int nr, int accumulate) {
+    const int32_t *a = ap;      // one int16 pair per int32
+    const char *b = bp;
+    __m256i c00 = _mm256_setzero_si256(), c01 = c00, c10 = c00, c11 = c00;
+    __m256i c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m256i c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (int g = 0; g < (kc + 1) / 2; g++, a += MR, b += 64) {
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)b), b1 = _mm256_loadu_si256((const __m256i *)(b + 32)), ai;
+        ai = _mm256_set1_epi32(a[0]); c00 = _mm256_add_epi32(c00, _mm256_madd_epi16(ai, b0)); c01 = _mm256_add_epi32(c01, _mm256_madd_epi16(ai, b1));
+        ai = _mm256_set1_epi32(a[1]); c10 = _mm256_add_epi32(c10, _mm256_madd_epi16(ai, b0)); c11 = _mm256_add_epi32(c11, _mm256_madd_epi16(ai, b1));
+        ai = _mm256_set1_epi32(a[2]); c20 = _mm256_add_epi32(c20, _mm256_madd_epi16(ai, b0)); c21 = _mm256_add_epi32(c21, _mm256_madd_epi16(ai, b1));
+        ai = _mm256_set1_epi32(a[3]); c30 = _mm256_add_epi32(c30, _mm256_madd_epi16(ai, b0)); c31 = _mm256_add_epi32(c31, _mm256_madd_epi16(ai, b1));
+        ai = _mm256_set1_epi32(a[4]); c40 = _mm256_add_epi32(c40, _mm256_madd_epi16(ai, b0)); c41 = _mm256_add_epi32(c41, _mm256_madd_epi16(ai, b1));
+        ai = _mm256_set1_epi32(a[5]); c50 = _mm256_add_epi32(c50, _mm256_madd_epi16(ai, b0)); c51 = _mm256_add_epi32(c51, _mm256_madd_epi16(ai, b1));
+    }
+    int32_t t[MR * NR_F32];
+    __m256i rows[MR][2] = { { c00, c01 }, { c10, c11 }, { c20, c21 },
+                            { c30, c31 }, { c40, c41 }, { c50, c51 } };
+    for (int i = 0; i < MR; i++) {
+        _mm256_storeu_si256((__m256i *)(t + i * NR_F32), rows[i][0]);
+        _mm256_storeu_si256((__m256i *)(t + i * NR_F32 + 8), rows[i][1]);
+    }
+    store_s32(t, NR_F32, cp, ldc, mr, nr, accumulate);
+}
+#endif
+
+#ifdef MATMUL_X86
+// Quads for VNNI: A as unsigned a + 128, B as is with its per-column sums
+// over the slice (int32, NR_WIDE of them) after the panel
+static void pack_a_u8_quads(const void *ap, long lda, int mc, int kc, void *outp) {
+    const int8_t *a = ap;
+    uint8_t *out = outp;
+    int kq = (kc + 3) / 4;
+    for (int i = 0; i < mc; i += MR, out += MR * kq * 4) {
+        int h = mc - i < MR ? mc - i : MR;
+        for (int g = 0; g < kq; g++)
+            for (int y = 0; y < MR; y++)
+                for (int q = 0; q < 4; q++) {
+                    int k = 4 * g + q;
+                    out[(g * MR + y) * 4 + q] = (uint8_t)((y < h && k < kc ? a[(i + y) * lda + k] : 0) + 128);
+                }
+    }
+}
+
+static void pack_b_s8_quads(const void *bp, long ldb, int kc, int nc, void *outp) {
+    const int8_t *b = bp;
+    int8_t *out = outp;
+    int kq = (kc + 3) / 4;
+    for (int j = 0; j < nc; j += NR_WIDE) {
+        int w = nc - j < NR_WIDE ? nc - j : NR_WIDE;
+        int32_t sums[NR_WIDE] = { 0 };
+        if (w < NR_WIDE || kc % 4) memset(out, 0, NR_WIDE * kq * 4);
+        for (int k = 0; k < kc; k++)
+            for (int x = 0; x < w; x++) {
+                int8_t v = b[k * ldb + j + x];
+                out[(k / 4 * NR_WIDE + x) * 4 + k % 4] = v;
+                sums[x] += v;
+            }
+        out += NR_WIDE * kq * 4;
+        memcpy(out, sums, sizeof(sums));
+        out += sizeof(sums);
+    }
+}
+
+__attribute__((target("avx512f,avx512vnni")))
+static void kernel_s8_vnni(int kc, const void *ap, const void *bp, void *cp, long ldc,
+                           int mr, int nr, int accumulate) {
+    const int32_t *a = ap;      // one quad of unsigned bytes per int32
+    const char *b = bp;
+    int32_t *c = cp;
+    __m512i c00 = _mm512_setzero_si512(), c01 = c00, c10 = c00, c11 = c00;
+    __m512i c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m512i c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (int g = 0; g < (kc + 3) / 4; g++, a += MR, b += 128) {
+        __m512i b0 = _mm512_loadu_si512(b), b1 = _mm512_loadu_si512(b + 64), ai;
+        ai = _mm512_set1_epi32(a[0]); c00 = _mm512_dpbusd_epi32(c00, ai, b0); c01 = _mm512_dpbusd_epi32(c01, ai, b1);
+        ai = _mm512_set1_epi32(a[1]); c10 = _mm512_dpbusd_epi32(c10, ai, b0); c11 = _mm512_dpbusd_epi32(c11, ai, b1);
+        ai = _mm512_set1_epi32(a[2]); c20 = _mm512_dpbusd_epi32(c20, ai, b0); c21 = _mm512_dpbusd_epi32(c21, ai, b1);
+        ai = _mm512_set1_epi32(a[3]); c30 = _mm512_dpbusd_epi32(c30, ai, b0); c31 = _mm512_dpbusd_epi32(c31, ai, b1);
+        ai = _mm512_set1_epi32(a[4]); c40 = _mm512_dpbusd_epi32(c40, ai, b0); c41 = _mm512_dpbusd_epi32(c41, ai, b1);
+        ai = _mm512_set1_epi32(a[5]); c50 = _mm512_dpbusd_epi32(c50, ai, b0); c51 = _mm512_dpbusd_epi32(c51, ai, b1);
+    }
+    // Take off the + 128 of A: 128 * column sum (wraps like the sums themselves)
+    __m512i s0 = _mm512_slli_epi32(_mm512_loadu_si512(b), 7);
+    __m512i s1 = _mm512_slli_epi32(_mm512_loadu_si512(b + 64), 7);
+    __m512i rows[MR][2] = { { c00, c01 }, { c10, c11 }, { c20, c21 },
+                            { c30, c31 }, { c40, c41 }, { c50, c51 } };
+    int32_t t[MR * NR_WIDE];
+    for (int i = 0; i < MR; i++) {
+        _mm512_storeu_si512(t + i * NR_WIDE, _mm512_sub_epi32(rows[i][0], s0));
+        _mm512_storeu_si512(t + i * NR_WIDE + 16, _mm512_sub_epi32(rows[i][1], s1));
+    }
+    store_s32(t, NR_WIDE, c, ldc, mr, nr, accumulate);
+}
+#endif
+
+// ------------------------------------------------------------
+// Types and dispatch
+// ------------------------------------------------------------
+
+static GemmType bf16 = {
+    .nr = NR_F32, .kgroup = 1, .a_in = 2, .b_in = 2, .c_out = 4, .a_packed = 4, .b_packed = 4,
+    .pack_a = pack_a_bf16_f32, .pack_b = pack_b_bf16_f32, .kernel = kernel_f32,
+};
+static GemmType fp16 = {
+    .nr = NR_F32, .kgroup = 1, .a_in = 2, .b_in = 2, .c_out = 4, .a_packed = 4, .b_packed = 4,
+    .pack_a = pack_a_fp16_f32, .pack_b = pack_b_fp16_f32, .kernel = kernel_f32,
+};
+static GemmType s8 = {
+    .nr = NR_F32, .kgroup = 2, .a_in = 1, .b_in = 1, .c_out = 4, .a_packed = 2, .b_packed = 2,
+    .pack_a = pack_a_s8_pairs, .pack_b = pack_b_s8_pairs, .kernel = kernel_s8_scalar,
+};
+static const char *isa_bf16 = "via float", *isa_fp16 = "via float", *isa_s8 = "scalar";
+
+static void pick_types(void) {
+    matmul_cpu_init();
+#ifdef MATMUL_X86
+    __builtin_cpu_init();
+    int cap = matmul_cpu_isa_cap();
+    if (cap >= 2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bf16")) {
+        bf16 = (GemmType){
+            .nr = NR_WIDE, .kgroup = 2, .a_in = 2, .b_in = 2, .c_out = 4, .a_packed = 2, .b_packed = 2,
+            .pack_a = pack_a_bf16_pairs, .pack_b = pack_b_bf16_pairs, .kernel = kernel_bf16_avx512,
+        };
+        isa_bf16 = "avx512bf16";
+    }
+    if (cap >= 1 && __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c")) {
+        fp16.pack_b = pack_b_fp16_f16c;
+        isa_fp16 = "f16c";
+    }
+    if (cap >= 2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vnni")) {
+        s8 = (GemmType){
+            .nr = NR_WIDE, .kgroup = 4, .a_in = 1, .b_in = 1, .c_out = 4, .a_packed = 1, .b_packed = 1,
+            .b_extra = NR_WIDE * sizeof(int32_t),
+            .pack_a = pack_a_u8_quads, .pack_b = pack_b_s8_quads, .kernel = kernel_s8_vnni,
+        };
+        isa_s8 = "avx512vnni";
+    } else if (cap >= 1 && __builtin_cpu_supports("avx2")) {
+        s8.kernel = kernel_s8_avx2;
+        isa_s8 = "avx2";
+    }
+#endif
+}
+
+static void init(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, pick_types);
+}
+
+const char *matmul_lowp_isa(void) {
+    static char name[96];
+    init();
+    snprintf(name, sizeof(name), "bf16 %s, fp16 %s, int8 %s", isa_bf16, isa_fp16, isa_s8);
+    return name;
+}
+
+int matmul_bf16(const uint16_t *A, const uint16_t *B, float *C, int M, int N, int K) {
+    init();
+    return matmul_cpu_gemm(&bf16, A, B, C, M, N, K);
+}
+
+int matmul_fp16(const uint16_t *A, const uint16_t *B, float *C, int M, int N, int K) {
+    init();
+    return matmul_cpu_gemm(&fp16, A, B, C, M, N, K);
+}
+
+int matmul_s8(const int8_t *A, const int8_t *B, int32_t *C, int M, int N, int K) {
+    init();
+    return matmul_cpu_gemm(&s8, A, B, C, M, N, K);
+}
+
+int matmul_s8_scaled(const int8_t *A, const float *scale_a, const int8_t *B, const float *scale_b,
+                     float *C, int M, int N, int K) {
+    // The int32 products go into C itself and are scaled in place
+    int err = matmul_s8(A, B, (int32_t *)C, M, N, K);
+    if (err) return err;
+    for (int i = 0; i < M; i++)
+        for (int j = 0; j < N; j++) {
+            int32_t v;
+            memcpy(&v, &C[(long)i * N + j], sizeof(v));
+            C[(long)i * N + j] = v * scale_a[i] * scale_b[j];
+        }
+    return 0;
+}
@@ -0,0 +1,185 @@
+// Metal backend: runs the kernels in build/matmul.metallib
+//
+// Device, queue, library, pipelines and the buffer pool are compute.m's,
+// the same module 19_cuda_helloworld uses: made on the first call and
+// kept, so a repeated product only pays for copying its operands and the
+// dispatch. compute.m is single-threaded, so calls here are serialised on
+// one lock (the queue runs them one after another anyway).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#import <Metal/Metal.h>
+
+#include "compute.h"
+#include "matmul.h"
+
+#define METALLIB "build/matmul.metallib"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Params in matmul.metal
+typedef struct {
+    uint32_t M, N, K;
+    uint32_t T;
+    uint32_t stride_a, stride_b, stride_c;
+} Params;
+
+// One buffer with the items of an operand back to back, or just one item
+// when the whole batch shares it (stride 0). stride is -1 for pointer
+// arrays. The caller has checked that items * elems fits the kernels'
+// 32-bit indices.
+static id<MTLBuffer> input_buffer(const MatmulBatch *b, const float *(*item)(const MatmulBatch *, int),
+                                  long stride, size_t elems, int batch) {
+    int items = stride == 0 ? 1 : batch;
+    size_t bytes = sizeof(float) * elems;
+    id<MTLBuffer> buf = compute_buffer(bytes * items);
+    if (!buf || !bytes) return buf;
+    if (items == 1 || stride == (long)elems)   // already back to back
+        memcpy(buf.contents, item(b, 0), bytes * items);
+    else
+        for (int i = 0; i < items; i++)
+            memcpy((char *)buf.contents + bytes * i, item(b, i), bytes);
+    return buf;
+}
+
+static int run_locked(const char *kernel, int tiled, const MatmulBatch *b, int M, int N, int K, int batch) {
+    @autoreleasepool {
+        // ------------------------------------------------------------
+        // 1. Context and pipeline, made on first use
+        // ------------------------------------------------------------
+        if (compute_open(METALLIB) != 0) return 1;
+        id<MTLComputePipelineState> pso = compute_pipeline(kernel);
+        if (!pso) return 1;
+
+        // ------------------------------------------------------------
+        // 2. Sizes: every element of the batch must be reachable with
+        //    the kernels' uint indices
+        // ------------------------------------------------------------
+        long stride_a = b->Ap ? -1 : b->stride_a, stride_b = b->Bp ? -1 : b->stride_b;
+        size_t elems_a = (size_t)M * K, elems_b = (size_t)K * N, elems_c = (size_t)M * N;
+        size_t items_a = stride_a == 0 ? 1 : batch, items_b = stride_b == 0 ? 1 : batch;
+        if (elems_a * items_a > UINT32_MAX || elems_b * items_b > UINT32_MAX ||
+            elems_c * batch > UINT32_MAX) {
+            fprintf(stderr, "matmul: %d x %d x %d x %d is too large for the Metal kernels' 32-bit indices\n",
+                    batch, M, N, K);
+            return 1;
+        }
+        Params params = {
+            .M = M, .N = N, .K = K,
+            .stride_a = stride_a == 0 ? 0 : (uint32_t)elems_a,
+            .stride_b = stride_b == 0 ? 0 : (uint32_t)elems_b,
+            .stride_c = (uint32_t)elems_c,
+        };
+
+        // ------------------------------------------------------------
+        // 3. GPU buffers from the pool, the whole batch in each
+        // ------------------------------------------------------------
+        size_t sizeC = sizeof(float) * elems_c;
+        id<MTLBuffer> bufA = input_buffer(b, matmul_batch_a, stride_a, elems_a, batch);
+        id<MTLBuffer> bufB = input_buffer(b, matmul_batch_b, stride_b, elems_b, batch);
+        id<MTLBuffer> bufC = compute_buffer(sizeC * batch);
+        if (!bufA || !bufB || !bufC) {
+            compute_recycle(bufA);
+            compute_recycle(bufB);
+            compute_recycle(bufC);
+            return 1;
+        }
+
+        // ------------------------------------------------------------
+        // 4. Dispatch
+        // ------------------------------------------------------------
+        int err;
+        if (tiled) {
+            // T x T threads per group, as large as this pipeline allows;
+            // whole groups, since every thread takes part in the tile loads
+            params.T = matmul_pick_tile(pso.maxTotalThreadsPerThreadgroup,
+                                        compute_device().maxThreadgroupMemoryLength);
+            uint32_t t = params.T;
+            err = compute_run_groups(pso, @[bufA, bufB, bufC], &params, sizeof(params),
+                                     MTLSizeMake((N + t - 1) / t, (M + t - 1) / t, batch),
+                                     MTLSizeMake(t, t, 1), 2 * sizeof(float) * t * t);
+        } else {
+            // One thread per element of C
+            err = compute_run_groups(pso, @[bufA, bufB, bufC], &params, sizeof(params),
+                                     MTLSizeMake(N, M, batch), MTLSizeMake(1, 1, 1), 0);
+        }
+        compute_recycle(bufA);
+        compute_recycle(bufB);
+        if (err) {
+            compute_recycle(bufC);
+            return 1;
+        }
+
+        // ------------------------------------------------------------
+        // 5. Read back
+        // ------------------------------------------------------------
+        for (int i = 0; i < batch; i++)
+            memcpy(matmul_batch_c(b, i), (char *)bufC.contents + sizeC * i, sizeC);
+        compute_recycle(bufC);
+    }
+    return 0;
+}
+
+static int run(const char *kernel, int tiled, const MatmulBatch *b, int M, int N, int K, int batch) {
+    if (M <= 0 || N <= 0 || batch <= 0) return 0;
+    pthread_mutex_lock(&lock);
+    int err = run_locked(kernel, tiled, b, M, N, K, batch);
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+int matmul_metal(const float *A, const float *B, float *C, int M, int N, int K) {
+    MatmulBatch b = { .A = A, .B = B, .C = C };
+    return run("matmul_tiled", 1, &b, M, N, K, 1);
+}
+
+int matmul_metal_batched(const float *const *A, const float *const *B, float *const *C,
+                         int M, int N, int K, int batch) {
+    MatmulBatch b = { .Ap = A, .Bp = B, .Cp = C };
+    return run("matmul_tiled", 1, &b, M, N, K, batch);
+}
+
+int matmul_metal_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                                 float *C, long stride_c, int M, int N, int K, int batch) {
+    MatmulBatch b = { .A = A, .B = B, .C = C,
+                      .stride_a = stride_a, .stride_b = stride_b, .stride_c = stride_c };
+    return run("matmul_tiled", 1, &b, M, N, K, batch);
+}
+
+int matmul_metal_naive(const float *A, const float *B, float *C, int M, int N, int K) {
+    MatmulBatch b = { .A = A, .B = B, .C = C };
+    return run("matmul", 0, &b, M, N, K, 1);
+}
+
+int matmul_metal_naive_batched(const float *const *A, const float *const *B, float *const *C,
+                               int M, int N, int K, int batch) {
+    MatmulBatch b = { .Ap = A, .Bp = B, .Cp = C };
+    return run("matmul", 0, &b, M, N, K, batch);
+}
+
+int matmul_metal_naive_strided_batched(const float *A, long stride_a, const float *B, long stride_b,
+                                       float *C, long stride_c, int M, int N, int K, int batch) {
+    MatmulBatch b = { .A = A, .B = B, .C = C,
+                      .stride_a = stride_a, .stride_b = stride_b, .stride_c = stride_c };
+    return run("matmul", 0, &b, M, N, K, batch);
+}
+
+static const char *name(const char *kernel, char *buf, size_t size) {
+    pthread_mutex_lock(&lock);
+    id<MTLDevice> device = compute_open(METALLIB) == 0 ? compute_device() : nil;
+    pthread_mutex_unlock(&lock);
+    snprintf(buf, size, "Metal %s (%s)", kernel, device ? device.name.UTF8String : "no device");
+    return buf;
+}
+
+const char *matmul_metal_name(void) {
+    static char buf[128];
+    return name("tiled", buf, sizeof(buf));
+}
+
+const char *matmul_metal_naive_name(void) {
+    static char buf[128];
+    return name("naive", buf, sizeof(buf));
+}
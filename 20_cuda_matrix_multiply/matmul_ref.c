@@ -0,0 +1,48 @@
+#include <math.h>
+
+#include "matmul.h"
+
+void matmul_reference(const float *A, const float *B, float *C, int M, int N, int K) {
+    for (int i = 0; i < M; i++)
+        for (int j = 0; j < N; j++) {
+            double sum = 0.0;
+            for (int k = 0; k < K; k++)
+                sum += (double)A[(long)i * K + k] * B[(long)k * N + j];
+            C[(long)i * N + j] = (float)sum;
+        }
+}
+
+// |C_ij - (A×B)_ij| / sum_k |A_ik B_kj|
+static double element_error(const float *A, const float *B, const float *C,
+                            int N, int K, int i, int j) {
+    double sum = 0.0, mag = 0.0;
+    for (int k = 0; k < K; k++) {
+        double p = (double)A[(long)i * K + k] * B[(long)k * N + j];
+        sum += p;
+        mag += fabs(p);
+    }
+    double err = fabs(C[(long)i * N + j] - sum);
+    // An exact zero must come out exactly zero
+    return mag > 0.0 ? err / mag : (err > 0.0 ? INFINITY : 0.0);
+}
+
+double matmul_error(const float *A, const float *B, const float *C, int M, int N, int K) {
+    return matmul_error_sampled(A, B, C, M, N, K, (long)M * N);
+}
+
+double matmul_error_sampled(const float *A, const float *B, const float *C,
+                            int M, int N, int K, long samples) {
+    long total = (long)M * N;
+    if (samples > total) samples = total;
+    double worst = 0.0;
+    for (long s = 0; s < samples; s++) {
+        // Every element when samples == total, otherwise rows evenly
+        // spaced and columns scattered by a multiplicative hash
+        int i = samples == total ? s / N : (int)((double)s * M / samples);
+        int j = samples == total ? s % N : (int)(((unsigned long)s * 2654435761UL) % N);
+        double rel = element_error(A, B, C, N, K, i, j);
+        if (rel > worst || isnan(rel)) worst = rel;
+        if (isnan(worst)) break;
+    }
+    return worst;
+}
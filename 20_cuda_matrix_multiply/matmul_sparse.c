@@ -0,0 +1,218 @@
+// Sparse A (CSR) times dense B on the CPU.
+//
+// Row i of C is the sum over row i's nonzeros a_ik of a_ik * (row k of B),
+// so the work is nnz * N multiply-adds instead of M * K * N. The kernel
+// walks C in strips of 64 columns kept in registers and streams the B
+// rows of each nonzero through them, writing every element of C once.
+//
+// Threads take contiguous runs of rows with about the same number of
+// nonzeros (plus one per row, for writing it), not the same number of
+// rows: one dense row among empty ones would otherwise leave a thread
+// with all the work.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matmul.h"
+#include "matmul_cpu.h"
+
+#define STRIP 64   // columns of C per pass over a row's nonzeros
+
+// ------------------------------------------------------------
+// Row kernels: C rows [r0, r1) = A rows × B
+// ------------------------------------------------------------
+
+static void rows_scalar(const MatmulCsr *A, const float *B, float *C, int N, int r0, int r1) {
+    for (int i = r0; i < r1; i++) {
+        float *c = C + (long)i * N;
+        for (int j0 = 0; j0 < N; j0 += STRIP) {
+            int w = N - j0 < STRIP ? N - j0 : STRIP;
+            float acc[STRIP] = { 0 };
+            for (int p = A->row_ptr[i]; p < A->row_ptr[i + 1]; p++) {
+                const float *b = B + (long)A->col[p] * N + j0;
+                float a = A->val[p];
+                for (int j = 0; j < w; j++) acc[j] += a * b[j];
+            }
+            memcpy(c + j0, acc, sizeof(float) * w);
+        }
+    }
+}
+
+#ifdef MATMUL_X86
+__attribute__((target("avx2,fma")))
+static void rows_avx2(const MatmulCsr *A, const float *B, float *C, int N, int r0, int r1) {
+    for (int i = r0; i < r1; i++) {
+        float *c = C + (long)i * N;
+        int p0 = A->row_ptr[i], p1 = A->row_ptr[i + 1], j0 = 0;
+        for (; j0 + STRIP <= N; j0 += STRIP) {
+            __m256 c0 = _mm256_setzero_ps(), c1 = c0, c2 = c0, c3 = c0, c4 = c0, c5 = c0, c6 = c0, c7 = c0;
+            for (int p = p0; p < p1; p++) {
+                const float *b = B + (long)A->col[p] * N + j0;
+                __m256 a = _mm256_broadcast_ss(&A->val[p]);
+                c0 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b), c0);
+                c1 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 8), c1);
+                c2 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 16), c2);
+                c3 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 24), c3);
+                c4 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 32), c4);
+                c5 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 40), c5);
+                c6 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 48), c6);
+                c7 = _mm256_fmadd_ps(a, _mm256_loadu_ps(b + 56), c7);
+            }
+            _mm256_storeu_ps(c + j0, c0);      _mm256_storeu_ps(c + j0 + 8, c1);
+            _mm256_storeu_ps(c + j0 + 16, c2); _mm256_storeu_ps(c + j0 + 24, c3);
+            _mm256_storeu_ps(c + j0 + 32, c4); _mm256_storeu_ps(c + j0 + 40, c5);
+            _mm256_storeu_ps(c + j0 + 48, c6); _mm256_storeu_ps(c + j0 + 56, c7);
+        }
+        // Last partial strip, 8 columns at a time then one by one
+        for (; j0 < N; j0 += 8) {
+            int w = N - j0 < 8 ? N - j0 : 8;
+            if (w == 8) {
+                __m256 acc = _mm256_setzero_ps();
+                for (int p = p0; p < p1; p++)
+                    acc = _mm256_fmadd_ps(_mm256_broadcast_ss(&A->val[p]),
+                                          _mm256_loadu_ps(B + (long)A->col[p] * N + j0), acc);
+                _mm256_storeu_ps(c + j0, acc);
+            } else {
+                for (int j = j0; j < N; j++) {
+                    float acc = 0.0f;
+                    for (int p = p0; p < p1; p++) acc += A->val[p] * B[(long)A->col[p] * N + j];
+                    c[j] = acc;
+                }
+            }
+        }
+    }
+}
+#endif
+
+typedef void (*RowsFn)(const MatmulCsr *A, const float *B, float *C, int N, int r0, int r1);
+
+static RowsFn pick_rows(void) {
+#ifdef MATMUL_X86
+    __builtin_cpu_init();
+    if (matmul_cpu_isa_cap() >= 1 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return rows_avx2;
+#endif
+    return rows_scalar;
+}
+
+// ------------------------------------------------------------
+// Threads: runs of rows balanced on nonzeros
+// ------------------------------------------------------------
+
+typedef struct {
+    RowsFn rows;
+    const MatmulCsr *A;
+    const float *B;
+    float *C;
+    int N, r0, r1;
+} RowRun;
+
+static void *run_rows(void *arg) {
+    RowRun *r = arg;
+    r->rows(r->A, r->B, r->C, r->N, r->r0, r->r1);
+    return NULL;
+}
+
+// First row whose rows before it weigh at least `target`, a row weighing
+// its nonzeros plus one
+static int row_at_weight(const MatmulCsr *A, long target) {
+    int lo = 0, hi = A->rows;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if ((long)A->row_ptr[mid] - A->row_ptr[0] + mid < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int matmul_csr(const MatmulCsr *A, const float *B, float *C, int N) {
+    int M = A->rows;
+    if (M <= 0 || N <= 0) return 0;
+    RowsFn rows = pick_rows();
+
+    long nnz = A->row_ptr[M] - A->row_ptr[0], weight = nnz + M;
+    long work = nnz * N + (long)M * N;   // multiply-adds plus stores
+    int threads = matmul_cpu_threads();
+    if (threads > work / MIN_WORK_PER_THREAD) threads = work / MIN_WORK_PER_THREAD;
+    if (threads > M) threads = M;
+    if (threads < 1) threads = 1;
+
+    RowRun runs[threads];
+    for (int t = 0; t < threads; t++) {
+        runs[t] = (RowRun){ .rows = rows, .A = A, .B = B, .C = C, .N = N };
+        runs[t].r0 = t ? runs[t - 1].r1 : 0;
+        runs[t].r1 = t == threads - 1 ? M : row_at_weight(A, weight * (t + 1) / threads);
+    }
+    matmul_cpu_parallel(run_rows, runs, sizeof(RowRun), threads);
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Conversion and the dense-or-sparse choice
+// ------------------------------------------------------------
+
+static long count_nonzeros(const float *A, long n) {
+    long nnz = 0;
+    for (long i = 0; i < n; i++) nnz += A[i] != 0.0f;
+    return nnz;
+}
+
+int matmul_csr_from_dense(const float *A, int M, int K, MatmulCsr *out) {
+    long nnz = count_nonzeros(A, (long)M * K);
+    if (nnz > INT_MAX) {   // row_ptr holds int offsets
+        fprintf(stderr, "matmul: %ld nonzeros do not fit a CSR with int offsets\n", nnz);
+        return 1;
+    }
+    int *row_ptr = malloc(sizeof(int) * (M + 1)), *col = malloc(sizeof(int) * (nnz ? nnz : 1));
+    float *val = malloc(sizeof(float) * (nnz ? nnz : 1));
+    if (!row_ptr || !col || !val) {
+        free(row_ptr); free(col); free(val);
+        fprintf(stderr, "matmul: out of memory\n");
+        return 1;
+    }
+    long p = 0;
+    for (int i = 0; i < M; i++) {
+        row_ptr[i] = p;
+        for (int k = 0; k < K; k++)
+            if (A[(long)i * K + k] != 0.0f) {
+                col[p] = k;
+                val[p++] = A[(long)i * K + k];
+            }
+    }
+    row_ptr[M] = p;
+    *out = (MatmulCsr){ .rows = M, .cols = K, .row_ptr = row_ptr, .col = col, .val = val };
+    return 0;
+}
+
+void matmul_csr_free(MatmulCsr *A) {
+    free((void *)A->row_ptr);
+    free((void *)A->col);
+    free((void *)A->val);
+    *A = (MatmulCsr){ 0 };
+}
+
+double matmul_density(const float *A, long n) {
+    return n ? (double)count_nonzeros(A, n) / n : 0.0;
+}
+
+int matmul_auto(const float *A, const float *B, float *C, int M, int N, int K) {
+    // Dense too when the nonzeros overflow the CSR's int offsets
+    long n = (long)M * K, nnz = count_nonzeros(A, n);
+    if (n == 0 || (double)nnz / n > MATMUL_SPARSE_DENSITY || nnz > INT_MAX)
+        return matmul(A, B, C, M, N, K);
+    MatmulCsr csr;
+    if (matmul_csr_from_dense(A, M, K, &csr) != 0) return 1;
+    int err = matmul_csr(&csr, B, C, N);
+    matmul_csr_free(&csr);
+    return err;
+}
+
+const char *matmul_csr_name(void) {
+    static char name[64];
+    int n = matmul_cpu_threads();
+    snprintf(name, sizeof(name), "CPU CSR (%s, %d thread%s)",
+             pick_rows() == rows_scalar ? "scalar" : "avx2+fma", n, n == 1 ? "" : "s");
+    return name;
+}
@@ -0,0 +1,226 @@
+// Strassen-Winograd over the blocked CPU product, for very large multiplies.
+//
+// One level splits A, B and C into 2x2 quadrants and builds C from seven
+// quadrant products instead of eight, at the price of fifteen quadrant
+// additions (Winograd's variant of Strassen). The products recurse while
+// every side is above the cutoff and below it go to the blocked kernel,
+// so each level saves an eighth of the multiply-adds and adds O(n^2)
+// memory traffic: only worth it where the kernel's products are large
+// enough to run at full speed (MATMUL_STRASSEN_MIN, from bench).
+//
+// Odd sides are peeled: the even leading part goes through Strassen, the
+// last row and column of C are conventional products, and an odd K adds
+// a rank-one update to the even part.
+//
+// The seven products of a level run one after another, each on the whole
+// worker pool, and the additions are split between the pool's threads by
+// rows. Running the products as separate tasks would need thread counts
+// that are multiples of seven to keep every thread busy.
+//
+// The quadrant sums and three of the products live in a workspace kept
+// between calls: 11 quadrants per level, about 3.7 n^2 floats for n x n.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matmul.h"
+#include "matmul_cpu.h"
+
+// Below this many elements per thread an addition pass runs on one thread
+#define MIN_ADDS_PER_THREAD (1L << 16)
+
+static int recurses(int M, int N, int K, int cutoff) {
+    return M > cutoff && N > cutoff && K > cutoff && M >= 2 && N >= 2 && K >= 2;
+}
+
+// ------------------------------------------------------------
+// Addition passes, split by rows
+// ------------------------------------------------------------
+
+enum { FORM_S, FORM_T, COMBINE, RANK1 };
+
+// Up to four inputs with one row stride and four outputs with another
+// (the quadrants of a level share their matrix's); unused slots repeat
+// the first
+typedef struct {
+    int kind;
+    const float *x[4];
+    long ldx;
+    float *y[4];
+    long ldy;
+    int cols;
+} Pass;
+
+typedef struct {
+    const Pass *pass;
+    int r0, r1;
+} PassRows;
+
+static void *run_pass(void *arg) {
+    const PassRows *job = arg;
+    const Pass *p = job->pass;
+    for (int i = job->r0; i < job->r1; i++) {
+        const float *x0 = p->x[0] + i * p->ldx, *x1 = p->x[1] + i * p->ldx;
+        const float *x2 = p->x[2] + i * p->ldx, *x3 = p->x[3] + i * p->ldx;
+        float *y0 = p->y[0] + i * p->ldy, *y1 = p->y[1] + i * p->ldy;
+        float *y2 = p->y[2] + i * p->ldy, *y3 = p->y[3] + i * p->ldy;
+        switch (p->kind) {
+        case FORM_S:   // A11 A12 A21 A22 -> S1 S2 S3 S4
+            for (int j = 0; j < p->cols; j++) {
+                float s1 = x2[j] + x3[j], s2 = s1 - x0[j];
+                y0[j] = s1;
+                y1[j] = s2;
+                y2[j] = x0[j] - x2[j];
+                y3[j] = x1[j] - s2;
+            }
+            break;
+        case FORM_T:   // B11 B12 B21 B22 -> T1 T2 T3 T4
+            for (int j = 0; j < p->cols; j++) {
+                float t1 = x1[j] - x0[j], t2 = x3[j] - t1;
+                y0[j] = t1;
+                y1[j] = t2;
+                y2[j] = x3[j] - x1[j];
+                y3[j] = t2 - x2[j];
+            }
+            break;
+        case COMBINE:  // P1 P6 P7, and C11..C22 holding P2 P3 P4 P5
+            for (int j = 0; j < p->cols; j++) {
+                float u2 = x0[j] + x1[j], u3 = u2 + x2[j], p5 = y3[j];
+                y0[j] = x0[j] + y0[j];
+                y1[j] = u2 + p5 + y1[j];
+                y2[j] = u3 - y2[j];
+                y3[j] = u3 + p5;
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+// C += column a (stride lda) × row b, the odd K of a level
+static void *run_rank1(void *arg) {
+    const PassRows *job = arg;
+    const Pass *p = job->pass;
+    for (int i = job->r0; i < job->r1; i++) {
+        float a = p->x[0][i * p->ldx], *c = p->y[0] + i * p->ldy;
+        for (int j = 0; j < p->cols; j++) c[j] += a * p->x[1][j];
+    }
+    return NULL;
+}
+
+static void pass(int kind, const float *const x[4], long ldx, float *const y[4], long ldy,
+                 int rows, int cols) {
+    Pass p = { .kind = kind, .ldx = ldx, .ldy = ldy, .cols = cols };
+    for (int q = 0; q < 4; q++) {
+        p.x[q] = x[q] ? x[q] : x[0];
+        p.y[q] = y[q] ? y[q] : y[0];
+    }
+    int threads = matmul_cpu_threads();
+    long adds = (long)rows * cols;
+    if (threads > adds / MIN_ADDS_PER_THREAD) threads = adds / MIN_ADDS_PER_THREAD;
+    if (threads < 1) threads = 1;
+    PassRows jobs[threads];
+    for (int t = 0; t < threads; t++)
+        jobs[t] = (PassRows){ &p, (long)rows * t / threads, (long)rows * (t + 1) / threads };
+    matmul_cpu_parallel(kind == RANK1 ? run_rank1 : run_pass, jobs, sizeof(PassRows), threads);
+}
+
+// ------------------------------------------------------------
+// Recursion
+// ------------------------------------------------------------
+
+// Workspace floats for one product and the levels below it
+static size_t workspace_floats(int M, int N, int K, int cutoff) {
+    if (!recurses(M, N, K, cutoff)) return 0;
+    size_t m = M / 2, n = N / 2, k = K / 2;
+    return 4 * m * k + 4 * k * n + 3 * m * n + workspace_floats(m, n, k, cutoff);
+}
+
+static void strassen(const float *A, long lda, const float *B, long ldb, float *C, long ldc,
+                     int M, int N, int K, int cutoff, float *work) {
+    if (!recurses(M, N, K, cutoff)) {
+        matmul_cpu_ld(A, lda, B, ldb, C, ldc, M, N, K);
+        return;
+    }
+    int m = M / 2, n = N / 2, k = K / 2;
+    const float *A11 = A, *A12 = A + k, *A21 = A + m * lda, *A22 = A21 + k;
+    const float *B11 = B, *B12 = B + n, *B21 = B + k * ldb, *B22 = B21 + n;
+    float *C11 = C, *C12 = C + n, *C21 = C + m * ldc, *C22 = C21 + n;
+    float *S[4], *T[4], *P1, *P6, *P7;
+    for (int q = 0; q < 4; q++) {
+        S[q] = work;
+        work += (size_t)m * k;
+    }
+    for (int q = 0; q < 4; q++) {
+        T[q] = work;
+        work += (size_t)k * n;
+    }
+    P1 = work; P6 = P1 + (size_t)m * n; P7 = P6 + (size_t)m * n;
+    work = P7 + (size_t)m * n;
+
+    pass(FORM_S, (const float *[4]){ A11, A12, A21, A22 }, lda, S, k, m, k);
+    pass(FORM_T, (const float *[4]){ B11, B12, B21, B22 }, ldb, T, n, k, n);
+    strassen(A11, lda, B11, ldb, P1, n, m, n, k, cutoff, work);
+    strassen(A12, lda, B21, ldb, C11, ldc, m, n, k, cutoff, work);     // P2
+    strassen(S[3], k, B22, ldb, C12, ldc, m, n, k, cutoff, work);      // P3
+    strassen(A22, lda, T[3], n, C21, ldc, m, n, k, cutoff, work);      // P4
+    strassen(S[0], k, T[0], n, C22, ldc, m, n, k, cutoff, work);       // P5
+    strassen(S[1], k, T[1], n, P6, n, m, n, k, cutoff, work);
+    strassen(S[2], k, T[2], n, P7, n, m, n, k, cutoff, work);
+    pass(COMBINE, (const float *[4]){ P1, P6, P7, NULL }, n, (float *[4]){ C11, C12, C21, C22 }, ldc, m, n);
+
+    // Odd sides: the last column of K into the even part, then the last
+    // row and column of C on their own
+    int M2 = 2 * m, N2 = 2 * n, K2 = 2 * k;
+    if (K > K2)
+        pass(RANK1, (const float *[4]){ A + K2, B + K2 * ldb, NULL, NULL }, lda,
+             (float *[4]){ C, NULL, NULL, NULL }, ldc, M2, N2);
+    if (N > N2)
+        matmul_cpu_ld(A, lda, B + N2, ldb, C + N2, ldc, M2, N - N2, K);
+    if (M > M2)
+        matmul_cpu_ld(A + M2 * lda, lda, B, ldb, C + M2 * ldc, ldc, M - M2, N, K);
+}
+
+// One workspace, grown as needed and kept; one Strassen product at a time
+static struct {
+    pthread_mutex_t lock;
+    float *p;
+    size_t floats;
+} workspace = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+int matmul_strassen(const float *A, const float *B, float *C, int M, int N, int K, int cutoff) {
+    if (cutoff <= 0) cutoff = MATMUL_STRASSEN_CUTOFF;
+    size_t floats = workspace_floats(M, N, K, cutoff);
+    if (!floats) return matmul_cpu_ld(A, K, B, N, C, N, M, N, K);
+
+    pthread_mutex_lock(&workspace.lock);
+    if (workspace.floats < floats) {
+        free(workspace.p);
+        workspace.p = aligned_alloc(64, (floats * sizeof(float) + 63) / 64 * 64);
+        workspace.floats = workspace.p ? floats : 0;
+        if (!workspace.p) {
+            pthread_mutex_unlock(&workspace.lock);
+            fprintf(stderr, "matmul: out of memory\n");
+            return 1;
+        }
+    }
+    strassen(A, K, B, N, C, N, M, N, K, cutoff, workspace.p);
+    pthread_mutex_unlock(&workspace.lock);
+    return 0;
+}
+
+// First-order error bound of the recursion above, in units of u max|A|
+// max|B|: K^2 for a conventional product (each dot product is off by at
+// most K u sum |a b|), 18 b + 96 k for a level over products bounded by b
+// (Higham, Accuracy and Stability of Numerical Algorithms, 23.2.2: 18 is
+// the growth of the worst C quadrant's operands, 96 k its additions),
+// plus K for the rank-one update of an odd K
+double matmul_strassen_bound(int M, int N, int K, int cutoff) {
+    if (cutoff <= 0) cutoff = MATMUL_STRASSEN_CUTOFF;
+    double conventional = (double)K * K;
+    if (!recurses(M, N, K, cutoff)) return conventional;
+    int k = K / 2;
+    double even = 18.0 * matmul_strassen_bound(M / 2, N / 2, k, cutoff) + 96.0 * k + (K & 1 ? K : 0);
+    return even > conventional ? even : conventional;
+}
@@ -0,0 +1,60 @@
+// The loop nest of the matmul_tiled Metal kernel, run on the CPU.
+//
+// Threadgroups run one after another; inside one, each phase between two
+// threadgroup_barrier()s is a loop over all T x T threads, so every
+// thread sees the tiles exactly as it would on the GPU. The per-thread
+// accumulator lives in an array indexed by thread. Slow, but it checks
+// the indexing, edge handling and tile choice on machines without Metal.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matmul.h"
+
+int matmul_pick_tile(unsigned long max_threads, unsigned long max_threadgroup_bytes) {
+    for (int t = MATMUL_MAX_TILE; t > 1; t /= 2)
+        if ((unsigned long)t * t <= max_threads &&
+            2 * sizeof(float) * t * t <= max_threadgroup_bytes)
+            return t;
+    return 1;
+}
+
+int matmul_tiled_emulated(const float *A, const float *B, float *C,
+                          int M, int N, int K, int T) {
+    if (T < 1) T = 1;
+    float *tiles = malloc(sizeof(float) * 3 * T * T);
+    if (!tiles) { fprintf(stderr, "Out of memory.\n"); return 1; }
+    float *As = tiles, *Bs = tiles + T * T, *sum = tiles + 2 * T * T;
+
+    // Whole threadgroups, as dispatchThreadgroups launches them
+    for (int gy = 0; gy < (M + T - 1) / T; gy++)
+        for (int gx = 0; gx < (N + T - 1) / T; gx++) {
+            for (int l = 0; l < T * T; l++) sum[l] = 0.0f;
+
+            for (int k0 = 0; k0 < K; k0 += T) {
+                // Every thread loads one element of each tile ...
+                for (int ly = 0; ly < T; ly++)
+                    for (int lx = 0; lx < T; lx++) {
+                        int row = gy * T + ly, col = gx * T + lx;
+                        int ak = k0 + lx, bk = k0 + ly;
+                        As[ly * T + lx] = (row < M && ak < K) ? A[(long)row * K + ak] : 0.0f;
+                        Bs[ly * T + lx] = (bk < K && col < N) ? B[(long)bk * N + col] : 0.0f;
+                    }
+                // ... threadgroup_barrier ...
+                for (int ly = 0; ly < T; ly++)
+                    for (int lx = 0; lx < T; lx++)
+                        for (int k = 0; k < T; k++)
+                            sum[ly * T + lx] += As[ly * T + k] * Bs[k * T + lx];
+                // ... threadgroup_barrier
+            }
+
+            for (int ly = 0; ly < T; ly++)
+                for (int lx = 0; lx < T; lx++) {
+                    int row = gy * T + ly, col = gx * T + lx;
+                    if (row < M && col < N)
+                        C[(long)row * N + col] = sum[ly * T + lx];
+                }
+        }
+    free(tiles);
+    return 0;
+}
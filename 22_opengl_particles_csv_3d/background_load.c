@@ -0,0 +1,113 @@
+#include "background_load.h"
+#include "point_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Copy each parsed batch into the queue; the loader's own array may move
+static int on_batch(const Point *batch, size_t n, const Bounds *bounds, void *user) {
+    BackgroundLoad *bl = user;
+    Batch *b = malloc(sizeof(Batch) + n * sizeof(Point));
+    if (!b) { perror("malloc"); exit(1); }
+    b->next = NULL;
+    b->n = n;
+    memcpy(b->points, batch, n * sizeof(Point));
+
+    pthread_mutex_lock(&bl->lock);
+    if (bl->tail) bl->tail->next = b;
+    else bl->head = b;
+    bl->tail = b;
+    bl->bounds = *bounds;
+    int go_on = !bl->cancel;
+    pthread_mutex_unlock(&bl->lock);
+    return go_on;
+}
+
+static void *run(void *arg) {
+    BackgroundLoad *bl = arg;
+    LoadStats st;
+    Bounds bounds;
+    bl->points = load_csv_columns(bl->path, &bl->count, &bounds, bl->threads, &st,
+                                  bl->schema, &bl->attribs, on_batch, bl);
+    fprintf(stderr, "Loaded %zu points from %s (%.1f MB in %.3fs, %.1f MB/s, %d threads)\n",
+            bl->count, bl->path, st.bytes / 1e6, st.seconds,
+            st.seconds > 0 ? st.bytes / 1e6 / st.seconds : 0.0, st.threads);
+
+    pthread_mutex_lock(&bl->lock);
+    int cancel = bl->cancel;
+    pthread_mutex_unlock(&bl->lock);
+
+    if (!cancel) {
+        int depth;
+        double t = now_seconds();
+        uint32_t *order = NULL;
+        if (bl->attribs.mask) {
+            order = malloc((bl->count ? bl->count : 1) * sizeof(uint32_t));
+            if (!order) { perror("malloc"); exit(1); }
+        }
+        bl->nodes = octree_build(bl->points, bl->count, bounds, order, &bl->node_count, &depth);
+        if (order) {
+            attribs_permute(&bl->attribs, order, bl->count);
+            free(order);
+        }
+        fprintf(stderr, "Octree: %zu nodes, depth %d, built in %.3fs\n",
+                bl->node_count, depth, now_seconds() - t);
+        if (bl->use_cache)
+            bl->cached = point_cache_write(bl->path, bl->points, bl->count, bounds,
+                                           bl->nodes, bl->node_count, bl->schema,
+                                           &bl->attribs, bl->quantize);
+    }
+
+    pthread_mutex_lock(&bl->lock);
+    bl->bounds = bounds;
+    bl->done = 1;
+    pthread_mutex_unlock(&bl->lock);
+    return NULL;
+}
+
+void background_load_start(BackgroundLoad *bl, const char *path, const Schema *schema,
+                           int threads, int use_cache, int quantize) {
+    memset(bl, 0, sizeof(*bl));
+    bl->path = path;
+    bl->schema = schema;
+    bl->threads = threads;
+    bl->use_cache = use_cache;
+    bl->quantize = quantize;
+    pthread_mutex_init(&bl->lock, NULL);
+    int err = pthread_create(&bl->tid, NULL, run, bl);
+    if (err) { fprintf(stderr, "pthread_create: %s\n", strerror(err)); exit(1); }
+}
+
+Batch *background_load_take(BackgroundLoad *bl, Bounds *bounds, int *done) {
+    pthread_mutex_lock(&bl->lock);
+    Batch *b = bl->head;
+    bl->head = bl->tail = NULL;
+    *bounds = bl->bounds;
+    *done = bl->done;
+    pthread_mutex_unlock(&bl->lock);
+    return b;
+}
+
+void background_load_cancel(BackgroundLoad *bl) {
+    pthread_mutex_lock(&bl->lock);
+    bl->cancel = 1;
+    pthread_mutex_unlock(&bl->lock);
+}
+
+void background_load_join(BackgroundLoad *bl) {
+    pthread_join(bl->tid, NULL);
+    pthread_mutex_destroy(&bl->lock);
+    for (Batch *b = bl->head, *next; b; b = next) {
+        next = b->next;
+        free(b);
+    }
+    bl->head = bl->tail = NULL;
+}
@@ -0,0 +1,57 @@
+// Loads a CSV on a background thread so the viewer can draw while it
+// parses. Points arrive as batches the render thread takes each frame;
+// once the whole file is in, the thread builds the octree and writes the
+// cache, and the finished arrays are handed over.
+
+#ifndef BACKGROUND_LOAD_H
+#define BACKGROUND_LOAD_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "csv_loader.h"
+#include "octree.h"
+
+typedef struct Batch {
+    struct Batch *next;
+    size_t n;
+    Point points[];
+} Batch;
+
+typedef struct {
+    const char *path;
+    const Schema *schema;    // NULL for x,y,z
+    int threads, use_cache, quantize;
+    pthread_t tid;
+    pthread_mutex_t lock;
+
+    // Guarded by lock
+    Batch *head, *tail;      // batches not taken yet
+    Bounds bounds;           // of everything loaded so far
+    int done;
+    int cancel;
+
+    // Owned by the loader thread until done, then by whoever joins
+    Point *points;
+    size_t count;
+    PointAttribs attribs;    // in octree order, like points
+    OctreeNode *nodes;
+    size_t node_count;
+    int cached;              // the .pcache sidecar was written
+} BackgroundLoad;
+
+// schema must outlive the load
+void background_load_start(BackgroundLoad *bl, const char *path, const Schema *schema,
+                           int threads, int use_cache, int quantize);
+
+// Take the pending batches (oldest first; free() each) and the current
+// bounds. *done is set once the points and octree are ready to collect
+// with background_load_join().
+Batch *background_load_take(BackgroundLoad *bl, Bounds *bounds, int *done);
+
+// Wait for the thread. Call after done, or after background_load_cancel()
+// to stop early; a cancelled load builds no octree and writes no cache.
+void background_load_join(BackgroundLoad *bl);
+void background_load_cancel(BackgroundLoad *bl);
+
+#endif
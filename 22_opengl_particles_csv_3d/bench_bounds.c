@@ -0,0 +1,171 @@
+// Bounds microbenchmark: the original branchy loop from main.c against
+// the scalar, SSE and AVX2 paths in bounds.c. Then the frustum box test
+// (frustum.c), SIMD against scalar, over random boxes and view matrices;
+// both add in the same order, so every result must match exactly.
+//
+//   make bench            # 16M points
+//   ./bench_bounds 1000000 20
+
+#include "bounds.h"
+#include "frustum.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FRUSTUM_MATRICES 64
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// compute_bounds() as it was before bounds.c
+static Bounds baseline(const Point *points, size_t point_count) {
+    Bounds b = {points[0].x, points[0].x,
+                points[0].y, points[0].y,
+                points[0].z, points[0].z};
+    for (size_t i = 1; i < point_count; i++) {
+        if (points[i].x < b.minX) b.minX = points[i].x;
+        if (points[i].x > b.maxX) b.maxX = points[i].x;
+        if (points[i].y < b.minY) b.minY = points[i].y;
+        if (points[i].y > b.maxY) b.maxY = points[i].y;
+        if (points[i].z < b.minZ) b.minZ = points[i].z;
+        if (points[i].z > b.maxZ) b.maxZ = points[i].z;
+    }
+    return b;
+}
+
+static int same(Bounds a, Bounds b) {
+    for (int i = 0; i < 6; i++)
+        if ((&a.minX)[i] != (&b.minX)[i]) return 0;
+    return 1;
+}
+
+static float frand(float lo, float hi) {
+    return lo + rand() / (float)RAND_MAX * (hi - lo);
+}
+
+// c = a * b, column-major
+static void mat_mul(const float a[16], const float b[16], float c[16]) {
+    for (int col = 0; col < 4; col++)
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) sum += a[k * 4 + row] * b[col * 4 + k];
+            c[col * 4 + row] = sum;
+        }
+}
+
+// A perspective projection of a camera turned and moved at random, like
+// main.c's; every other one just random entries, planes in any direction
+static void random_mvp(float m[16], int camera) {
+    if (!camera) {
+        for (int i = 0; i < 16; i++) m[i] = frand(-1.0f, 1.0f);
+        return;
+    }
+    float fov = frand(0.3f, 2.0f), aspect = frand(0.5f, 2.5f), n = frand(0.01f, 1.0f), f = frand(50.0f, 500.0f);
+    float t = 1.0f / tanf(fov / 2);
+    float proj[16] = { t / aspect, 0, 0, 0,  0, t, 0, 0,
+                       0, 0, (f + n) / (n - f), -1,  0, 0, 2 * f * n / (n - f), 0 };
+    float yaw = frand(-3.14f, 3.14f), pitch = frand(-1.5f, 1.5f);
+    float cy = cosf(yaw), sy = sinf(yaw), cp = cosf(pitch), sp = sinf(pitch);
+    float rot_y[16] = { cy, 0, -sy, 0,  0, 1, 0, 0,  sy, 0, cy, 0,  0, 0, 0, 1 };
+    float rot_x[16] = { 1, 0, 0, 0,  0, cp, sp, 0,  0, -sp, cp, 0,  0, 0, 0, 1 };
+    float move[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,
+                       frand(-50, 50), frand(-50, 50), frand(-200, 0), 1 };
+    float view[16], rot[16];
+    mat_mul(rot_x, rot_y, rot);
+    mat_mul(move, rot, view);
+    mat_mul(proj, view, m);
+}
+
+// Every box against every matrix with both tests; 1 when they all agree
+static int check_frustum(const Bounds *boxes, size_t n) {
+    size_t outcome[3] = { 0 }, mismatches = 0;
+    double best[2] = { 1e30, 1e30 };
+    for (int k = 0; k < FRUSTUM_MATRICES; k++) {
+        float mvp[16];
+        Frustum fr;
+        random_mvp(mvp, k & 1);
+        frustum_from_matrix(mvp, &fr);
+        for (size_t i = 0; i < n; i++) {
+            int simd = frustum_test_box(&fr, &boxes[i]);
+            mismatches += simd != frustum_test_box_scalar(&fr, &boxes[i]);
+            outcome[simd]++;
+        }
+        // Time the two on this matrix
+        for (int impl = 0; impl < 2; impl++) {
+            volatile int sink = 0;
+            double t = now_seconds();
+            for (size_t i = 0; i < n; i++)
+                sink += impl ? frustum_test_box_scalar(&fr, &boxes[i]) : frustum_test_box(&fr, &boxes[i]);
+            t = now_seconds() - t;
+            if (t < best[impl]) best[impl] = t;
+        }
+    }
+    printf("\n%zu boxes x %d matrices: %zu outside, %zu intersecting, %zu inside\n",
+           n, FRUSTUM_MATRICES, outcome[FRUSTUM_OUTSIDE], outcome[FRUSTUM_INTERSECTS], outcome[FRUSTUM_INSIDE]);
+    printf("box_test,ms,Mboxes/s,match\n");
+    printf("simd,%.3f,%.1f,%s\n", best[0] * 1e3, n / best[0] / 1e6, mismatches ? "NO" : "yes");
+    printf("scalar,%.3f,%.1f,yes\n", best[1] * 1e3, n / best[1] / 1e6);
+    if (mismatches) fprintf(stderr, "frustum_test_box disagrees with the scalar test on %zu boxes\n", mismatches);
+    return !mismatches;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 16u << 20;
+    int reps = argc > 2 ? atoi(argv[2]) : 10;
+    if (n < 1 || reps < 1) { fprintf(stderr, "usage: %s [points] [reps]\n", argv[0]); return 1; }
+
+    Point *pts = malloc(n * sizeof(Point));
+    if (!pts) { perror("malloc"); return 1; }
+    srand(1);
+    for (size_t i = 0; i < n; i++)
+        pts[i] = (Point){ rand() / (float)RAND_MAX * 200 - 100,
+                          rand() / (float)RAND_MAX * 50,
+                          rand() / (float)RAND_MAX * -10 };
+
+    struct { const char *name; Bounds (*fn)(const Point *, size_t); } impls[] = {
+        { "baseline", baseline },
+        { "scalar",   bounds_compute_scalar },
+        { "sse",      bounds_compute_sse },
+        { "avx2",     bounds_compute_avx2 },
+    };
+    Bounds ref = baseline(pts, n);
+    printf("%zu points, %d reps, dispatch picks %s\n", n, reps, bounds_impl_name());
+    printf("impl,ms,GB/s,match\n");
+    int ok = 1;
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        Bounds b = impls[k].fn(pts, n);   // warm up
+        double best = 1e30;
+        for (int r = 0; r < reps; r++) {
+            double t = now_seconds();
+            b = impls[k].fn(pts, n);
+            t = now_seconds() - t;
+            if (t < best) best = t;
+        }
+        int m = same(b, ref);
+        ok &= m;
+        printf("%s,%.3f,%.2f,%s\n", impls[k].name, best * 1e3,
+               n * sizeof(Point) / best / 1e9, m ? "yes" : "NO");
+    }
+    free(pts);
+
+    // Boxes from node-sized to scene-sized, anywhere around the camera
+    size_t boxes_n = 1 << 16;
+    Bounds *boxes = malloc(boxes_n * sizeof(Bounds));
+    if (!boxes) { perror("malloc"); return 1; }
+    for (size_t i = 0; i < boxes_n; i++) {
+        float c[3], h[3];
+        for (int a = 0; a < 3; a++) {
+            c[a] = frand(-300.0f, 300.0f);
+            h[a] = powf(10.0f, frand(-2.0f, 2.0f));
+        }
+        boxes[i] = (Bounds){ c[0] - h[0], c[0] + h[0], c[1] - h[1], c[1] + h[1], c[2] - h[2], c[2] + h[2] };
+    }
+    ok &= check_frustum(boxes, boxes_n);
+    free(boxes);
+    return ok ? 0 : 1;
+}
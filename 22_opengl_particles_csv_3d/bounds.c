@@ -0,0 +1,128 @@
+#include "bounds.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BOUNDS_X86 1
+#include <immintrin.h>
+#endif
+
+Bounds bounds_empty(void) {
+    return (Bounds){ INFINITY, -INFINITY, INFINITY, -INFINITY, INFINITY, -INFINITY };
+}
+
+Bounds bounds_merge(Bounds a, Bounds b) {
+    bounds_add(&a, (Point){ b.minX, b.minY, b.minZ });
+    bounds_add(&a, (Point){ b.maxX, b.maxY, b.maxZ });
+    return a;
+}
+
+static Bounds finish(Bounds b, size_t n) {
+    return n ? b : (Bounds){0};
+}
+
+Bounds bounds_compute_scalar(const Point *pts, size_t n) {
+    Bounds b = bounds_empty();
+    for (size_t i = 0; i < n; i++)
+        bounds_add(&b, pts[i]);
+    return finish(b, n);
+}
+
+// ------------------------------------------------------------
+// SIMD
+//
+// Points are packed xyz, so a run of 4 points (SSE) or 8 points (AVX2)
+// is exactly 3 registers, and lane j of register r always holds
+// component (r * width + j) % 3. Each register gets its own min and max
+// accumulator and the lanes are folded into x/y/z once at the end. The
+// data is the first operand of min/max, so NaN coordinates leave the
+// accumulator unchanged.
+// ------------------------------------------------------------
+
+// Fold 3*width accumulated lanes back to per-axis bounds
+static void fold_lanes(Bounds *b, const float *mins, const float *maxs, int lanes) {
+    float *mn[3] = { &b->minX, &b->minY, &b->minZ };
+    float *mx[3] = { &b->maxX, &b->maxY, &b->maxZ };
+    for (int i = 0; i < lanes; i++) {
+        if (mins[i] < *mn[i % 3]) *mn[i % 3] = mins[i];
+        if (maxs[i] > *mx[i % 3]) *mx[i % 3] = maxs[i];
+    }
+}
+
+#ifdef BOUNDS_X86
+__attribute__((target("sse")))
+Bounds bounds_compute_sse(const Point *pts, size_t n) {
+    const float *f = &pts[0].x;
+    __m128 mn0 = _mm_set1_ps(INFINITY), mn1 = mn0, mn2 = mn0;
+    __m128 mx0 = _mm_set1_ps(-INFINITY), mx1 = mx0, mx2 = mx0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, f += 12) {
+        __m128 a = _mm_loadu_ps(f), b = _mm_loadu_ps(f + 4), c = _mm_loadu_ps(f + 8);
+        mn0 = _mm_min_ps(a, mn0); mx0 = _mm_max_ps(a, mx0);
+        mn1 = _mm_min_ps(b, mn1); mx1 = _mm_max_ps(b, mx1);
+        mn2 = _mm_min_ps(c, mn2); mx2 = _mm_max_ps(c, mx2);
+    }
+    float mins[12], maxs[12];
+    _mm_storeu_ps(mins, mn0); _mm_storeu_ps(mins + 4, mn1); _mm_storeu_ps(mins + 8, mn2);
+    _mm_storeu_ps(maxs, mx0); _mm_storeu_ps(maxs + 4, mx1); _mm_storeu_ps(maxs + 8, mx2);
+
+    Bounds b = bounds_empty();
+    fold_lanes(&b, mins, maxs, 12);
+    for (; i < n; i++)
+        bounds_add(&b, pts[i]);
+    return finish(b, n);
+}
+
+__attribute__((target("avx2")))
+Bounds bounds_compute_avx2(const Point *pts, size_t n) {
+    const float *f = &pts[0].x;
+    __m256 mn0 = _mm256_set1_ps(INFINITY), mn1 = mn0, mn2 = mn0;
+    __m256 mx0 = _mm256_set1_ps(-INFINITY), mx1 = mx0, mx2 = mx0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, f += 24) {
+        __m256 a = _mm256_loadu_ps(f), b = _mm256_loadu_ps(f + 8), c = _mm256_loadu_ps(f + 16);
+        mn0 = _mm256_min_ps(a, mn0); mx0 = _mm256_max_ps(a, mx0);
+        mn1 = _mm256_min_ps(b, mn1); mx1 = _mm256_max_ps(b, mx1);
+        mn2 = _mm256_min_ps(c, mn2); mx2 = _mm256_max_ps(c, mx2);
+    }
+    float mins[24], maxs[24];
+    _mm256_storeu_ps(mins, mn0); _mm256_storeu_ps(mins + 8, mn1); _mm256_storeu_ps(mins + 16, mn2);
+    _mm256_storeu_ps(maxs, mx0); _mm256_storeu_ps(maxs + 8, mx1); _mm256_storeu_ps(maxs + 16, mx2);
+
+    Bounds b = bounds_empty();
+    fold_lanes(&b, mins, maxs, 24);
+    for (; i < n; i++)
+        bounds_add(&b, pts[i]);
+    return finish(b, n);
+}
+#else
+Bounds bounds_compute_sse(const Point *pts, size_t n) { return bounds_compute_scalar(pts, n); }
+Bounds bounds_compute_avx2(const Point *pts, size_t n) { return bounds_compute_scalar(pts, n); }
+#endif
+
+static int impl = -1;   // 0 scalar, 1 sse, 2 avx2
+
+static int detect_impl(void) {
+    if (impl < 0) {
+        impl = 0;
+#ifdef BOUNDS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) impl = 2;
+        else if (__builtin_cpu_supports("sse")) impl = 1;
+#endif
+    }
+    return impl;
+}
+
+const char *bounds_impl_name(void) {
+    static const char *names[] = { "scalar", "sse", "avx2" };
+    return names[detect_impl()];
+}
+
+Bounds bounds_compute(const Point *pts, size_t n) {
+    switch (detect_impl()) {
+    case 2:  return bounds_compute_avx2(pts, n);
+    case 1:  return bounds_compute_sse(pts, n);
+    default: return bounds_compute_scalar(pts, n);
+    }
+}
@@ -0,0 +1,40 @@
+// Axis-aligned bounds of a point array.
+//
+// bounds_compute() is one pass with SIMD min/max (AVX2 or SSE on x86,
+// scalar elsewhere), picked at runtime. NaN coordinates are ignored.
+// The loader computes bounds while parsing, so this is for recomputing
+// after the point set changes (e.g. filtering).
+
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <stddef.h>
+
+#include "csv_loader.h"
+
+// min = +inf, max = -inf: the identity for bounds_merge
+Bounds bounds_empty(void);
+Bounds bounds_merge(Bounds a, Bounds b);
+
+static inline void bounds_add(Bounds *b, Point p) {
+    if (p.x < b->minX) b->minX = p.x;
+    if (p.x > b->maxX) b->maxX = p.x;
+    if (p.y < b->minY) b->minY = p.y;
+    if (p.y > b->maxY) b->maxY = p.y;
+    if (p.z < b->minZ) b->minZ = p.z;
+    if (p.z > b->maxZ) b->maxZ = p.z;
+}
+
+// All zero when n == 0
+Bounds bounds_compute(const Point *pts, size_t n);
+
+// The individual paths, for benchmarking. The SIMD ones fall back to
+// scalar when not built for x86.
+Bounds bounds_compute_scalar(const Point *pts, size_t n);
+Bounds bounds_compute_sse(const Point *pts, size_t n);
+Bounds bounds_compute_avx2(const Point *pts, size_t n);
+
+// "avx2", "sse" or "scalar"
+const char *bounds_impl_name(void);
+
+#endif
@@ -0,0 +1,461 @@
+#include "csv_loader.h"
+#include "bounds.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Don't bother splitting files smaller than this per thread
+#define MIN_CHUNK_BYTES (1 << 20)
+// Progressive loads parse windows of this size, doubling each time
+#define FIRST_WINDOW_BYTES (1 << 20)
+#define MAX_WINDOW_BYTES   (64 << 20)
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ------------------------------------------------------------
+// Float parsing
+//
+// Decimal input is reduced to an integer mantissa m and a power of ten e.
+// When m and 10^|e| are both exact in float, one float multiply or divide
+// is correctly rounded, i.e. what strtof returns. Otherwise double is
+// used, falling back to strtof in the rare case the double lands exactly
+// halfway between two floats (where rounding twice could differ), and for
+// anything unusual (hex, inf, nan, very long mantissas, huge exponents).
+// ------------------------------------------------------------
+
+static const float pow10f_tab[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+static const double pow10_tab[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Copy the whole token at p (up to the next comma or line end) and let
+// strtof handle it; long tokens (many digits) go through the heap
+static const char *parse_float_slow(const char *p, const char *end, float *out) {
+    char small[64];
+    size_t n = 0;
+    while (p + n < end && p[n] != ',' && p[n] != '\n' && p[n] != '\r')
+        n++;
+    char *buf = n < sizeof(small) ? small : malloc(n + 1);
+    if (!buf) { perror("malloc"); exit(1); }
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    char *stop;
+    float v = strtof(buf, &stop);
+    size_t used = stop - buf;
+    if (buf != small) free(buf);
+    if (!used) return NULL;
+    *out = v;
+    return p + used;
+}
+
+const char *parse_float(const char *p, const char *end, float *out) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f'))
+        p++;
+    const char *start = p;
+
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) { neg = *p == '-'; p++; }
+
+    uint64_t m = 0;
+    int digits = 0;       // significant digits kept in m
+    int any = 0;          // saw at least one digit
+    int e = 0;
+
+    for (; p < end && is_digit(*p); p++) {
+        any = 1;
+        if (digits < 19) { m = m * 10 + (*p - '0'); if (m) digits++; }
+        else e++;
+    }
+    if (p < end && (*p == 'x' || *p == 'X'))
+        return parse_float_slow(start, end, out);
+    if (p < end && *p == '.') {
+        p++;
+        for (; p < end && is_digit(*p); p++) {
+            any = 1;
+            if (digits < 19) { m = m * 10 + (*p - '0'); if (m) digits++; e--; }
+        }
+    }
+    if (!any)
+        return parse_float_slow(start, end, out);   // inf, nan, or not a number
+
+    // Exponent only counts if at least one digit follows, like strtof
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0;
+        if (q < end && (*q == '-' || *q == '+')) { eneg = *q == '-'; q++; }
+        if (q < end && is_digit(*q)) {
+            int x = 0;
+            for (; q < end && is_digit(*q); q++)
+                if (x < 100000) x = x * 10 + (*q - '0');
+            e += eneg ? -x : x;
+            p = q;
+        }
+    }
+
+    if (m == 0) { *out = neg ? -0.0f : 0.0f; return p; }
+    if (digits >= 19)
+        return parse_float_slow(start, end, out);
+
+    float f;
+    if (m < (1u << 24) && e >= -10 && e <= 10) {
+        f = e < 0 ? (float)m / pow10f_tab[-e] : (float)m * pow10f_tab[e];
+    } else if (m < (1ull << 53) && e >= -22 && e <= 22) {
+        double d = e < 0 ? (double)m / pow10_tab[-e] : (double)m * pow10_tab[e];
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        if ((bits & 0x1FFFFFFF) == 0x10000000)
+            return parse_float_slow(start, end, out);
+        f = (float)d;
+    } else {
+        return parse_float_slow(start, end, out);
+    }
+
+    *out = neg ? -f : f;
+    return p;
+}
+
+// Parse "x,y,z..." from one line; 0 if the line isn't a point
+static int parse_row(const char *p, const char *eol, Point *pt) {
+    p = parse_float(p, eol, &pt->x);
+    if (!p || p >= eol || *p++ != ',') return 0;
+    p = parse_float(p, eol, &pt->y);
+    if (!p || p >= eol || *p++ != ',') return 0;
+    p = parse_float(p, eol, &pt->z);
+    return p != NULL;
+}
+
+static void range_add(float r[2], float v) {
+    if (v < r[0]) r[0] = v;
+    if (v > r[1]) r[1] = v;
+}
+
+static void range_merge(float r[2], const float o[2]) {
+    if (o[0] <= o[1]) { range_add(r, o[0]); range_add(r, o[1]); }
+}
+
+// Parse one line by schema into slot i of the point and attribute
+// arrays; 0 if the line isn't a point. Skipped columns may hold anything.
+static int parse_row_schema(const char *p, const char *eol, const Schema *s,
+                            Point *pt, PointAttribs *a, size_t i) {
+    for (int c = 0; c < s->count; c++) {
+        if (c > 0 && (p >= eol || *p++ != ','))
+            return 0;
+        if (s->role[c] == COL_SKIP) {
+            const char *comma = memchr(p, ',', eol - p);
+            p = comma ? comma : eol;
+            continue;
+        }
+        float v;
+        p = parse_float(p, eol, &v);
+        if (!p) return 0;
+        switch (s->role[c]) {
+        case COL_X: pt->x = v; break;
+        case COL_Y: pt->y = v; break;
+        case COL_Z: pt->z = v; break;
+        case COL_INTENSITY: a->intensity[i] = v; break;
+        case COL_TIME: a->time[i] = v; break;
+        case COL_FRAME: a->frame[i] = v; break;
+        default: {
+            // r, g, b as 0-255
+            float q = v < 0 ? 0 : v > 255 ? 255 : v == v ? v + 0.5f : 0;
+            a->rgba[4 * i + s->role[c] - COL_R] = (uint8_t)q;
+            a->rgba[4 * i + 3] = 255;
+        }
+        }
+    }
+    return 1;
+}
+
+// ------------------------------------------------------------
+// Threaded load
+//
+// Pass 1 counts lines per chunk, which gives every chunk a fixed slot in
+// one preallocated array. Pass 2 parses each chunk straight into its
+// slot. Lines that aren't points leave a gap that is closed afterwards;
+// the header is skipped up front so normally there are none. Progressive
+// loads run both passes once per window of the file.
+// ------------------------------------------------------------
+
+typedef struct {
+    const char *begin, *end;
+    const Schema *schema;   // NULL for plain x,y,z
+    Point *out;
+    PointAttribs attribs;   // arrays point at this chunk's slot
+    size_t lines;
+    size_t rows;
+    Bounds bounds;
+} Chunk;
+
+static void *count_lines(void *arg) {
+    Chunk *c = arg;
+    size_t n = 0;
+    for (const char *p = c->begin; p < c->end; p++)
+        n += *p == '\n';
+    if (c->end > c->begin && c->end[-1] != '\n')
+        n++;
+    c->lines = n;
+    return NULL;
+}
+
+static void *parse_chunk(void *arg) {
+    Chunk *c = arg;
+    const char *p = c->begin;
+    size_t n = 0;
+    Bounds b = bounds_empty();
+    if (!c->schema) {
+        while (p < c->end) {
+            const char *eol = memchr(p, '\n', c->end - p);
+            if (!eol) eol = c->end;
+            if (parse_row(p, eol, &c->out[n]))
+                bounds_add(&b, c->out[n++]);
+            p = eol + 1;
+        }
+    } else {
+        PointAttribs *a = &c->attribs;
+        a->intensity_range[0] = a->time_range[0] = INFINITY;
+        a->intensity_range[1] = a->time_range[1] = -INFINITY;
+        while (p < c->end) {
+            const char *eol = memchr(p, '\n', c->end - p);
+            if (!eol) eol = c->end;
+            if (parse_row_schema(p, eol, c->schema, &c->out[n], a, n)) {
+                bounds_add(&b, c->out[n]);
+                if (a->intensity) range_add(a->intensity_range, a->intensity[n]);
+                if (a->time) range_add(a->time_range, a->time[n]);
+                n++;
+            }
+            p = eol + 1;
+        }
+    }
+    c->rows = n;
+    c->bounds = b;
+    return NULL;
+}
+
+static void run_all(Chunk *chunks, int n, void *(*fn)(void *)) {
+    pthread_t *tids = malloc(n * sizeof(pthread_t));
+    for (int t = 1; t < n; t++) {
+        int err = pthread_create(&tids[t], NULL, fn, &chunks[t]);
+        if (err) { fprintf(stderr, "pthread_create: %s\n", strerror(err)); exit(1); }
+    }
+    fn(&chunks[0]);
+    for (int t = 1; t < n; t++)
+        pthread_join(tids[t], NULL);
+    free(tids);
+}
+
+// Point chunk c's attribute arrays at slot i of a
+static void attribs_slot(Chunk *c, const PointAttribs *a, size_t i) {
+    c->attribs.mask = a->mask;
+    c->attribs.intensity = a->intensity ? a->intensity + i : NULL;
+    c->attribs.time = a->time ? a->time + i : NULL;
+    c->attribs.rgba = a->rgba ? a->rgba + 4 * i : NULL;
+    c->attribs.frame = a->frame ? a->frame + i : NULL;
+}
+
+// Parse [begin, end) with up to threads threads and append the points to
+// *points (grown as needed), merging their bounds into *b. With a schema
+// the attribute arrays in *a grow alongside and their ranges are merged.
+static void parse_window(const char *begin, const char *end, int threads,
+                         const Schema *schema, Point **points, PointAttribs *a,
+                         size_t *n, size_t *cap, Bounds *b) {
+    size_t window = end - begin;
+    if ((size_t)threads > window / MIN_CHUNK_BYTES)
+        threads = (int)(window / MIN_CHUNK_BYTES);
+    if (threads < 1)
+        threads = 1;
+
+    // Split at newline boundaries
+    Chunk *chunks = calloc(threads, sizeof(Chunk));
+    const char *p = begin;
+    for (int t = 0; t < threads; t++) {
+        const char *cut = begin + window * (t + 1) / threads;
+        if (t == threads - 1 || cut >= end) {
+            cut = end;
+        } else if (cut < p) {
+            cut = p;
+        } else {
+            const char *nl = memchr(cut, '\n', end - cut);
+            cut = nl ? nl + 1 : end;
+        }
+        chunks[t].begin = p;
+        chunks[t].end = cut;
+        p = cut;
+    }
+
+    run_all(chunks, threads, count_lines);
+
+    size_t lines = 0;
+    for (int t = 0; t < threads; t++)
+        lines += chunks[t].lines;
+
+    if (*n + lines > *cap) {
+        size_t want = *cap * 2 > *n + lines ? *cap * 2 : *n + lines;
+        Point *grown = realloc(*points, (want ? want : 1) * sizeof(Point));
+        if (!grown) { perror("malloc"); exit(1); }
+        *points = grown;
+        if (schema) attribs_reserve(a, want);
+        *cap = want;
+    }
+    size_t offset = *n;
+    for (int t = 0; t < threads; t++) {
+        chunks[t].schema = schema;
+        chunks[t].out = *points + offset;
+        if (schema) attribs_slot(&chunks[t], a, offset);
+        offset += chunks[t].lines;
+    }
+
+    run_all(chunks, threads, parse_chunk);
+
+    // Close gaps left by lines that weren't points, merge per-thread bounds
+    for (int t = 0; t < threads; t++) {
+        size_t rows = chunks[t].rows;
+        if (chunks[t].out != *points + *n) {
+            memmove(*points + *n, chunks[t].out, rows * sizeof(Point));
+            const PointAttribs *ca = &chunks[t].attribs;
+            if (ca->intensity) memmove(a->intensity + *n, ca->intensity, rows * sizeof(float));
+            if (ca->time) memmove(a->time + *n, ca->time, rows * sizeof(float));
+            if (ca->rgba) memmove(a->rgba + 4 * *n, ca->rgba, rows * 4);
+            if (ca->frame) memmove(a->frame + *n, ca->frame, rows * sizeof(float));
+        }
+        if (schema) {
+            range_merge(a->intensity_range, chunks[t].attribs.intensity_range);
+            range_merge(a->time_range, chunks[t].attribs.time_range);
+        }
+        *n += rows;
+        *b = bounds_merge(*b, chunks[t].bounds);
+    }
+    free(chunks);
+}
+
+Point *load_csv_mmap(const char *path, size_t *count, Bounds *bounds,
+                     int threads, LoadStats *stats) {
+    return load_csv_columns(path, count, bounds, threads, stats, NULL, NULL, NULL, NULL);
+}
+
+Point *load_csv_progressive(const char *path, size_t *count, Bounds *bounds,
+                            int threads, LoadStats *stats,
+                            LoadProgress progress, void *user) {
+    return load_csv_columns(path, count, bounds, threads, stats, NULL, NULL, progress, user);
+}
+
+Point *load_csv_columns(const char *path, size_t *count, Bounds *bounds,
+                        int threads, LoadStats *stats,
+                        const Schema *schema, PointAttribs *attribs,
+                        LoadProgress progress, void *user) {
+    double start = now_seconds();
+
+    // The plain x,y,z schema takes the fast path and has no attributes
+    if (schema && schema_is_default(schema))
+        schema = NULL;
+    PointAttribs a = { 0 };
+    if (schema) {
+        a.mask = schema_attribs(schema);
+        a.intensity_range[0] = a.time_range[0] = INFINITY;
+        a.intensity_range[1] = a.time_range[1] = -INFINITY;
+    }
+    if (attribs) *attribs = (PointAttribs){ 0 };
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { perror("open csv"); exit(1); }
+    struct stat st;
+    if (fstat(fd, &st) < 0) { perror("stat csv"); exit(1); }
+    size_t size = (size_t)st.st_size;
+
+    *count = 0;
+    *bounds = (Bounds){0};
+    if (size == 0) {
+        close(fd);
+        if (attribs) attribs->mask = a.mask;
+        if (stats) *stats = (LoadStats){ 0, now_seconds() - start, 0 };
+        return NULL;
+    }
+
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) { perror("mmap csv"); exit(1); }
+    close(fd);
+    madvise((void *)data, size, MADV_WILLNEED);
+
+    const char *end = data + size;
+
+    // Skip leading lines that aren't points (the header)
+    const char *body = data;
+    for (;;) {
+        const char *eol = memchr(body, '\n', end - body);
+        if (!eol) break;
+        Point tmp;
+        if (!schema) {
+            if (parse_row(body, eol, &tmp)) break;
+        } else {
+            // Scratch attributes, the real arrays don't exist yet
+            float f[3];
+            uint8_t rgba[4];
+            PointAttribs probe = { a.mask, &f[0], &f[1], rgba, &f[2], {0}, {0} };
+            if (parse_row_schema(body, eol, schema, &tmp, &probe, 0)) break;
+        }
+        body = eol + 1;
+    }
+
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int used = threads;
+    if ((size_t)used > (size_t)(end - body) / MIN_CHUNK_BYTES)
+        used = (int)((end - body) / MIN_CHUNK_BYTES);
+    if (used < 1)
+        used = 1;
+
+    // Without a callback the whole body is one window. With one, windows
+    // start small so the first batch arrives quickly whatever the file
+    // size, then double to keep every thread busy.
+    Point *points = NULL;
+    size_t n = 0, cap = 0;
+    Bounds b = bounds_empty();
+    size_t window = progress ? FIRST_WINDOW_BYTES : (size_t)(end - body);
+    for (const char *p = body; p < end; ) {
+        const char *cut = (size_t)(end - p) <= window ? end : p + window;
+        if (cut < end) {
+            const char *nl = memchr(cut, '\n', end - cut);
+            cut = nl ? nl + 1 : end;
+        }
+        size_t before = n;
+        parse_window(p, cut, threads, schema, &points, &a, &n, &cap, &b);
+        p = cut;
+        if (progress && n > before && !progress(points + before, n - before, &b, user))
+            break;
+        if (window < MAX_WINDOW_BYTES) window *= 2;
+    }
+    if (n) *bounds = b;
+
+    munmap((void *)data, size);
+
+    if (attribs) {
+        if (!(a.intensity_range[0] <= a.intensity_range[1]))
+            a.intensity_range[0] = a.intensity_range[1] = 0;
+        if (!(a.time_range[0] <= a.time_range[1]))
+            a.time_range[0] = a.time_range[1] = 0;
+        *attribs = a;
+    } else {
+        attribs_free(&a);
+    }
+
+    *count = n;
+    if (stats) *stats = (LoadStats){ size, now_seconds() - start, used };
+    return points;
+}
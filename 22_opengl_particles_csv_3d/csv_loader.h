@@ -0,0 +1,59 @@
+// Fast CSV point loader: mmap + one thread per chunk + a locale-free
+// float parser. Accepts the same rows as sscanf(line, "%f,%f,%f"):
+// lines that don't start with three comma separated numbers (such as the
+// "x,y,z" header) are skipped, extra columns are ignored.
+
+#ifndef CSV_LOADER_H
+#define CSV_LOADER_H
+
+#include <stddef.h>
+#include "point_attribs.h"
+
+typedef struct {
+    float x, y, z;
+} Point;
+
+typedef struct {
+    float minX, maxX;
+    float minY, maxY;
+    float minZ, maxZ;
+} Bounds;
+
+typedef struct {
+    size_t bytes;      // size of the file
+    double seconds;    // wall time for the whole load
+    int threads;       // threads actually used
+} LoadStats;
+
+// Load every point in path into a newly malloc'd array (free() it).
+// threads <= 0 uses one thread per online CPU. Exits on I/O errors.
+// Bounds are computed per thread while parsing and merged at the end
+// (all zero if there are no points).
+Point *load_csv_mmap(const char *path, size_t *count, Bounds *bounds,
+                     int threads, LoadStats *stats);
+
+// Called after each batch of a progressive load. batch is only valid
+// during the call; bounds covers every point loaded so far. Return 0 to
+// stop loading early (the points so far are still returned).
+typedef int (*LoadProgress)(const Point *batch, size_t n, const Bounds *bounds, void *user);
+
+// Same as load_csv_mmap, but parses the file in growing windows and calls
+// progress (from the calling thread) after each one.
+Point *load_csv_progressive(const char *path, size_t *count, Bounds *bounds,
+                            int threads, LoadStats *stats,
+                            LoadProgress progress, void *user);
+
+// Same as load_csv_progressive, reading columns by schema (NULL for
+// x,y,z). Rows are only points if every schema column parses. Attribute
+// arrays go into *attribs (free with attribs_free()); the progress
+// callback still sees positions only.
+Point *load_csv_columns(const char *path, size_t *count, Bounds *bounds,
+                        int threads, LoadStats *stats,
+                        const Schema *schema, PointAttribs *attribs,
+                        LoadProgress progress, void *user);
+
+// Parse one number the way strtof would in the C locale. Returns a
+// pointer just past it, or NULL if there is no number at p.
+const char *parse_float(const char *p, const char *end, float *out);
+
+#endif
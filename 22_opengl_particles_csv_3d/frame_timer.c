@@ -0,0 +1,115 @@
+#include "frame_timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int have_timer_query(void) {
+    GLint major = 0, minor = 0, n = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 3 || (major == 3 && minor >= 3))
+        return 1;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; i++)
+        if (!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_timer_query"))
+            return 1;
+    return 0;
+}
+
+void frame_timer_init(FrameTimer *t) {
+    memset(t, 0, sizeof(*t));
+    t->gpu = have_timer_query();
+    if (t->gpu)
+        glGenQueries(2 * TIMER_QUERIES, &t->queries[0][0]);
+    for (int i = 0; i < TIMER_QUERIES; i++)
+        t->query_frame[i] = -1;
+}
+
+void frame_timer_free(FrameTimer *t) {
+    if (t->gpu)
+        glDeleteQueries(2 * TIMER_QUERIES, &t->queries[0][0]);
+    free(t->cpu_ms);
+    free(t->gpu_ms);
+    memset(t, 0, sizeof(*t));
+}
+
+// Wait for query slot i and store its result
+static void collect(FrameTimer *t, int i) {
+    if (t->query_frame[i] < 0) return;
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(t->queries[i][1], GL_QUERY_RESULT, &end);
+    glGetQueryObjectui64v(t->queries[i][0], GL_QUERY_RESULT, &begin);
+    t->gpu_ms[t->query_frame[i]] = (end - begin) / 1e6;
+    t->query_frame[i] = -1;
+}
+
+void frame_timer_begin(FrameTimer *t) {
+    if (t->frames == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 256;
+        t->cpu_ms = realloc(t->cpu_ms, t->cap * sizeof(double));
+        t->gpu_ms = realloc(t->gpu_ms, t->cap * sizeof(double));
+        if (!t->cpu_ms || !t->gpu_ms) { perror("malloc"); exit(1); }
+    }
+    t->gpu_ms[t->frames] = -1;
+    if (t->gpu) {
+        int i = t->frames % TIMER_QUERIES;
+        collect(t, i);   // from TIMER_QUERIES frames ago, normally done by now
+        glQueryCounter(t->queries[i][0], GL_TIMESTAMP);
+        t->query_frame[i] = (long)t->frames;
+    }
+    t->start = now_seconds();
+}
+
+void frame_timer_end(FrameTimer *t, size_t points_drawn) {
+    t->cpu_ms[t->frames] = (now_seconds() - t->start) * 1e3;
+    if (t->gpu)
+        glQueryCounter(t->queries[(t->frames % TIMER_QUERIES)][1], GL_TIMESTAMP);
+    t->points += points_drawn;
+    t->frames++;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentiles of v[0..n), which gets sorted
+static void print_percentiles(FILE *out, const char *name, double *v, size_t n) {
+    if (!n) { fprintf(out, "%s_ms: n/a\n", name); return; }
+    qsort(v, n, sizeof(double), cmp_double);
+    const double pct[] = { 50, 90, 95, 99 };
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) sum += v[i];
+    fprintf(out, "%s_ms: mean=%.3f", name, sum / n);
+    for (size_t k = 0; k < sizeof(pct) / sizeof(pct[0]); k++) {
+        size_t r = (size_t)(pct[k] / 100.0 * n + 0.999999);
+        fprintf(out, " p%.0f=%.3f", pct[k], v[(r ? r : 1) - 1]);
+    }
+    fprintf(out, " max=%.3f\n", v[n - 1]);
+}
+
+void frame_timer_report(FrameTimer *t, FILE *out) {
+    for (int i = 0; i < TIMER_QUERIES; i++)
+        collect(t, i);
+
+    size_t n = t->frames;
+    double *v = malloc((n ? n : 1) * sizeof(double));
+    if (!v) { perror("malloc"); exit(1); }
+
+    fprintf(out, "frames=%zu points/frame=%.0f\n", n, n ? t->points / n : 0.0);
+    memcpy(v, t->cpu_ms, n * sizeof(double));
+    print_percentiles(out, "cpu", v, n);
+    size_t g = 0;
+    for (size_t i = 0; i < n; i++)
+        if (t->gpu_ms[i] >= 0) v[g++] = t->gpu_ms[i];
+    if (t->gpu) print_percentiles(out, "gpu", v, g);
+    else fprintf(out, "gpu_ms: n/a (no timer queries)\n");
+    free(v);
+}
@@ -0,0 +1,38 @@
+// Per-frame CPU and GPU timing with percentile reports.
+//
+// CPU time is the wall time between frame_timer_begin() and
+// frame_timer_end(), i.e. culling, LOD selection and issuing draw calls.
+// GPU time is the difference of two GL_TIMESTAMP queries around the
+// frame's commands when the context has them (OpenGL 3.3 or
+// ARB_timer_query). Query results are read a few frames
+// late so the CPU never waits on the GPU for them.
+
+#ifndef FRAME_TIMER_H
+#define FRAME_TIMER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+#define TIMER_QUERIES 4
+
+typedef struct {
+    int gpu;                         // timer queries available
+    GLuint queries[TIMER_QUERIES][2];   // GL_TIMESTAMP at begin and end
+    long query_frame[TIMER_QUERIES]; // frame each query belongs to, -1 if idle
+    double *cpu_ms, *gpu_ms;         // per frame; gpu_ms < 0 until known
+    size_t frames, cap;
+    double start;
+    double points;                   // sum of points drawn
+} FrameTimer;
+
+void frame_timer_init(FrameTimer *t);
+void frame_timer_free(FrameTimer *t);
+
+void frame_timer_begin(FrameTimer *t);
+void frame_timer_end(FrameTimer *t, size_t points_drawn);
+
+// Collect outstanding GPU times and print percentiles of both
+void frame_timer_report(FrameTimer *t, FILE *out);
+
+#endif
@@ -0,0 +1,65 @@
+#include "frustum.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+void frustum_from_matrix(const float m[16], Frustum *f) {
+    // Row r of the matrix is (m[r], m[4 + r], m[8 + r], m[12 + r]);
+    // the planes are row 3 +- rows 0, 1 and 2
+    for (int i = 0; i < 6; i++) {
+        int r = i / 2;
+        float s = i & 1 ? -1.0f : 1.0f;
+        f->nx[i] = m[3] + s * m[r];
+        f->ny[i] = m[7] + s * m[4 + r];
+        f->nz[i] = m[11] + s * m[8 + r];
+        f->d[i] = m[15] + s * m[12 + r];
+    }
+    for (int i = 6; i < 8; i++) {
+        f->nx[i] = f->ny[i] = f->nz[i] = 0.0f;
+        f->d[i] = 1.0f;
+    }
+}
+
+int frustum_test_box_scalar(const Frustum *f, const Bounds *b) {
+    int inside = 1;
+    for (int i = 0; i < 8; i++) {
+        float ax = f->nx[i] * b->minX, bx = f->nx[i] * b->maxX;
+        float ay = f->ny[i] * b->minY, by = f->ny[i] * b->maxY;
+        float az = f->nz[i] * b->minZ, bz = f->nz[i] * b->maxZ;
+        // Same order of additions as the SIMD version
+        float far = ((ax > bx ? ax : bx) + (ay > by ? ay : by)) + ((az > bz ? az : bz) + f->d[i]);
+        float near = ((ax < bx ? ax : bx) + (ay < by ? ay : by)) + ((az < bz ? az : bz) + f->d[i]);
+        if (far < 0) return FRUSTUM_OUTSIDE;
+        if (near < 0) inside = 0;
+    }
+    return inside ? FRUSTUM_INSIDE : FRUSTUM_INTERSECTS;
+}
+
+#ifdef __SSE__
+int frustum_test_box(const Frustum *f, const Bounds *b) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 mnx = _mm_set1_ps(b->minX), mxx = _mm_set1_ps(b->maxX);
+    const __m128 mny = _mm_set1_ps(b->minY), mxy = _mm_set1_ps(b->maxY);
+    const __m128 mnz = _mm_set1_ps(b->minZ), mxz = _mm_set1_ps(b->maxZ);
+    int outside = 0, partial = 0;
+    for (int i = 0; i < 8; i += 4) {
+        __m128 nx = _mm_loadu_ps(f->nx + i), ny = _mm_loadu_ps(f->ny + i);
+        __m128 nz = _mm_loadu_ps(f->nz + i), d = _mm_loadu_ps(f->d + i);
+        __m128 ax = _mm_mul_ps(nx, mnx), bx = _mm_mul_ps(nx, mxx);
+        __m128 ay = _mm_mul_ps(ny, mny), by = _mm_mul_ps(ny, mxy);
+        __m128 az = _mm_mul_ps(nz, mnz), bz = _mm_mul_ps(nz, mxz);
+        __m128 far = _mm_add_ps(_mm_add_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)),
+                                _mm_add_ps(_mm_max_ps(az, bz), d));
+        __m128 near = _mm_add_ps(_mm_add_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)),
+                                 _mm_add_ps(_mm_min_ps(az, bz), d));
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(far, zero));
+        partial |= _mm_movemask_ps(_mm_cmplt_ps(near, zero));
+    }
+    return outside ? FRUSTUM_OUTSIDE : partial ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+}
+#else
+int frustum_test_box(const Frustum *f, const Bounds *b) {
+    return frustum_test_box_scalar(f, b);
+}
+#endif
@@ -0,0 +1,32 @@
+// View frustum culling of axis-aligned boxes.
+//
+// The six planes come straight out of a model-view-projection matrix, so
+// they are in the same space as the points (no need to transform boxes).
+// They are stored as structure of arrays, padded to eight with planes
+// that pass everything, so the box test is two 4-wide SSE passes: for
+// every plane at once, the box corner furthest along the plane normal
+// decides "outside" and the nearest one decides "inside".
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "csv_loader.h"
+
+enum { FRUSTUM_OUTSIDE = 0, FRUSTUM_INTERSECTS = 1, FRUSTUM_INSIDE = 2 };
+
+typedef struct {
+    float nx[8], ny[8], nz[8], d[8];   // inside where n . p + d >= 0
+} Frustum;
+
+// Planes of clip space -w <= x, y, z <= w for a column-major matrix
+void frustum_from_matrix(const float mvp[16], Frustum *f);
+
+// FRUSTUM_* for box b. Conservative: boxes near a frustum corner can be
+// reported as intersecting while actually outside.
+int frustum_test_box(const Frustum *f, const Bounds *b);
+
+// Plain C version of the same test; bench_bounds checks the SIMD one
+// against it
+int frustum_test_box_scalar(const Frustum *f, const Bounds *b);
+
+#endif
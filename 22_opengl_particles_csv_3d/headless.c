@@ -0,0 +1,194 @@
+#include "headless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <png.h>
+
+static int has_extension(const char *list, const char *name) {
+    size_t n = strlen(name);
+    for (const char *p = list; p && (p = strstr(p, name)); p += n)
+        if ((p == list || p[-1] == ' ') && (p[n] == ' ' || p[n] == '\0'))
+            return 1;
+    return 0;
+}
+
+// Prefer Mesa's surfaceless platform, then the first EGL device (e.g. a
+// headless NVIDIA box), then whatever the default display is
+static EGLDisplay open_display(void) {
+    const char *client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (get_platform_display && has_extension(client, "EGL_MESA_platform_surfaceless")) {
+        EGLDisplay d = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (d != EGL_NO_DISPLAY && eglInitialize(d, NULL, NULL)) return d;
+    }
+    if (get_platform_display && has_extension(client, "EGL_EXT_platform_device")) {
+        PFNEGLQUERYDEVICESEXTPROC query_devices =
+            (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+        EGLDeviceEXT dev;
+        EGLint n = 0;
+        if (query_devices && query_devices(1, &dev, &n) && n > 0) {
+            EGLDisplay d = get_platform_display(EGL_PLATFORM_DEVICE_EXT, dev, NULL);
+            if (d != EGL_NO_DISPLAY && eglInitialize(d, NULL, NULL)) return d;
+        }
+    }
+    EGLDisplay d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (d != EGL_NO_DISPLAY && eglInitialize(d, NULL, NULL)) return d;
+    return EGL_NO_DISPLAY;
+}
+
+int headless_create(Headless *h, int width, int height) {
+    memset(h, 0, sizeof(*h));
+    h->width = width;
+    h->height = height;
+
+    EGLDisplay d = open_display();
+    if (d == EGL_NO_DISPLAY) { fprintf(stderr, "headless: no EGL display\n"); return 0; }
+    h->display = d;
+
+    // Without surfaceless contexts, make current on a 1x1 pbuffer; the
+    // FBO is what gets drawn either way
+    int surfaceless = has_extension(eglQueryString(d, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    EGLint config_attrs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint n = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(d, config_attrs, &config, 1, &n) || n < 1) {
+        fprintf(stderr, "headless: no EGL config for desktop OpenGL\n");
+        headless_destroy(h);
+        return 0;
+    }
+
+    EGLint context_attrs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    h->context = eglCreateContext(d, config, EGL_NO_CONTEXT, context_attrs);
+    if (h->context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "headless: can't create an OpenGL 3.2 core context (0x%x)\n", eglGetError());
+        headless_destroy(h);
+        return 0;
+    }
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        EGLint pbuffer_attrs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(d, config, pbuffer_attrs);
+        if (surface == EGL_NO_SURFACE) {
+            fprintf(stderr, "headless: can't create a pbuffer (0x%x)\n", eglGetError());
+            headless_destroy(h);
+            return 0;
+        }
+        h->surface = surface;
+    }
+    if (!eglMakeCurrent(d, surface, surface, h->context)) {
+        fprintf(stderr, "headless: eglMakeCurrent failed (0x%x)\n", eglGetError());
+        headless_destroy(h);
+        return 0;
+    }
+    return 1;
+}
+
+// Called once GL entry points are loaded (after glewInit)
+static void create_fbo(Headless *h) {
+    glGenRenderbuffers(1, &h->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, h->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, h->width, h->height);
+    glGenRenderbuffers(1, &h->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, h->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, h->width, h->height);
+
+    glGenFramebuffers(1, &h->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, h->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, h->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, h->depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "headless: framebuffer incomplete\n");
+        exit(1);
+    }
+}
+
+void headless_bind(Headless *h) {
+    if (!h->fbo) create_fbo(h);
+    glBindFramebuffer(GL_FRAMEBUFFER, h->fbo);
+}
+
+void headless_destroy(Headless *h) {
+    if (h->context) {
+        if (h->fbo) {
+            glDeleteFramebuffers(1, &h->fbo);
+            glDeleteRenderbuffers(1, &h->color);
+            glDeleteRenderbuffers(1, &h->depth);
+        }
+        eglMakeCurrent(h->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(h->display, h->context);
+    }
+    if (h->surface)
+        eglDestroySurface(h->display, h->surface);
+    if (h->display)
+        eglTerminate(h->display);
+    memset(h, 0, sizeof(*h));
+}
+
+int headless_write_png(const Headless *h, const char *path) {
+    size_t stride = (size_t)h->width * 3;
+    unsigned char *pixels = malloc(stride * h->height);
+    if (!pixels) { perror("malloc"); return 0; }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, h->fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, h->width, h->height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) { perror(path); free(pixels); return 0; }
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        fprintf(stderr, "%s: PNG write failed\n", path);
+        png_destroy_write_struct(&png, &info);
+        fclose(f);
+        free(pixels);
+        return 0;
+    }
+    png_init_io(png, f);
+    png_set_IHDR(png, info, h->width, h->height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    // GL rows start at the bottom
+    for (int y = h->height - 1; y >= 0; y--)
+        png_write_row(png, pixels + y * stride);
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    free(pixels);
+    return fclose(f) == 0;
+}
+
+#else
+
+int headless_create(Headless *h, int width, int height) {
+    memset(h, 0, sizeof(*h));
+    (void)width; (void)height;
+    fprintf(stderr, "headless: built without EGL (make HEADLESS=1)\n");
+    return 0;
+}
+
+void headless_bind(Headless *h) { (void)h; }
+void headless_destroy(Headless *h) { memset(h, 0, sizeof(*h)); }
+
+int headless_write_png(const Headless *h, const char *path) {
+    (void)h; (void)path;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,30 @@
+// Offscreen OpenGL 3.2 core context through EGL, rendering into an FBO,
+// for --headless runs with no display (Mesa's llvmpipe is enough).
+//
+// Only built with -DHAVE_EGL (the Makefile's HEADLESS=1, on by default
+// on Linux); otherwise headless_create() reports that and fails.
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <GL/glew.h>
+
+typedef struct {
+    void *display, *context, *surface;   // EGLDisplay, EGLContext, EGLSurface
+    GLuint fbo, color, depth;
+    int width, height;
+} Headless;
+
+// Create the context and make it current. Returns 1 on success;
+// failures are reported.
+int headless_create(Headless *h, int width, int height);
+void headless_destroy(Headless *h);
+
+// Bind the width x height FBO, creating it on first use. Needs GL entry
+// points, so call it after glewInit().
+void headless_bind(Headless *h);
+
+// Write the FBO's colour buffer as an RGB PNG. Returns 1 on success.
+int headless_write_png(const Headless *h, const char *path);
+
+#endif
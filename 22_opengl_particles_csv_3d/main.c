@@ -1,46 +1,75 @@
-// Modern macOS OpenGL 2.1 particle viewer with VBOs
-// Usage: ./main data.csv
+// OpenGL 3.2 core profile particle viewer: VAOs, VBOs and one shader program
+// Usage: ./main [--threads N] [--verify-loader] [--no-cache] [--quantize]
+//               [--budget POINTS] [--size WxH] [--columns SPEC]
+//               [--color-by rgb|intensity|time] [--time-window T0:T1]
+//               [--fps N] [--no-cull] [--point-size R]
+//               [--headless [--frames N] [--png out.png]]
+//               data.csv [frame2.csv ...]
+//
+// The first launch streams the CSV in on a background thread, drawing
+// points as they arrive, and writes data.csv.pcache next to the CSV;
+// later launches map it instead of parsing, until the CSV's size or
+// mtime changes.
+//
+// Points are drawn through an LOD octree: each frame the nodes largest on
+// screen are picked until --budget points (0 = all of them) are selected,
+// skipping nodes outside the view frustum (unless --no-cull). Points are
+// sized as spheres of radius R (by default the mean spacing of the drawn
+// points), at most 5 pixels; --point-size 0 keeps them all 5 pixels.
+//
+// --columns names the CSV's columns (default x,y,z), e.g.
+// "x,y,z,intensity,time" or "-,x,y,z,r,g,b" (- skips one). Intensity,
+// time and colour go into their own VBOs next to the positions, so
+// --color-by and --time-window are applied by the shader.
+//
+// Several CSVs, or a frame column in --columns, play back as a time
+// series at --fps timesteps per second, blending positions between
+// timesteps (see playback.h). Playback draws positions only.
+//
+// --headless renders --frames N frames offscreen through EGL (no display
+// needed) and prints CPU and GPU frame time percentiles; --png saves the
+// last frame.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <float.h>
+#include <time.h>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-typedef struct {
-    float x, y, z;
-} Point;
+#include "csv_loader.h"
+#include "point_cache.h"
+#include "bounds.h"
+#include "octree.h"
+#include "background_load.h"
+#include "shaders.h"
+#include "headless.h"
+#include "frame_timer.h"
+#include "playback.h"
+#include "frustum.h"
+
+#define DEFAULT_BUDGET 3000000
+#define FOVY 60.0f
+#define DEFAULT_FPS 10.0
+#define HEADLESS_HZ 60.0   // display rate headless playback pretends to have
+#define POINT_PIXELS 5.0f  // largest point size
 
 static Point *points = NULL;
 static size_t point_count = 0;
 static GLuint vbo = 0;
+static GLuint vao = 0;
+static PointCache cache;   // mapped sidecar, when one is in use
+static const OctreeNode *nodes = NULL;
+static size_t node_count = 0;
+static PointAttribs attribs;          // same order as points
+static GLuint attrib_vbos[3] = {0};   // intensity, time, rgba
 
-typedef struct {
-    float minX, maxX;
-    float minY, maxY;
-    float minZ, maxZ;
-} Bounds;
-
-static Bounds compute_bounds(void) {
-    Bounds b = {0};
-    if (point_count == 0) return b;
-
-    b.minX = b.maxX = points[0].x;
-    b.minY = b.maxY = points[0].y;
-    b.minZ = b.maxZ = points[0].z;
-
-    for (size_t i = 1; i < point_count; i++) {
-        if (points[i].x < b.minX) b.minX = points[i].x;
-        if (points[i].x > b.maxX) b.maxX = points[i].x;
-        if (points[i].y < b.minY) b.minY = points[i].y;
-        if (points[i].y > b.maxY) b.maxY = points[i].y;
-        if (points[i].z < b.minZ) b.minZ = points[i].z;
-        if (points[i].z > b.maxZ) b.maxZ = points[i].z;
-    }
-    return b;
-}
-
-static void load_csv(const char *path) {
+// Original line-by-line loader, kept as the reference for --verify-loader
+static Point *load_csv_stdio(const char *path, size_t *count) {
+    Point *points = NULL;
+    size_t point_count = 0;
     FILE *f = fopen(path, "r");
     if (!f) { perror("open csv"); exit(1); }
 
@@ -57,33 +86,89 @@ static void load_csv(const char *path) {
         points[point_count++] = (Point){x, y, z};
     }
     fclose(f);
-    fprintf(stderr, "Loaded %zu points from %s\n", point_count, path);
+    *count = point_count;
+    return points;
+}
+
+static Bounds load_csv(const char *path, const Schema *schema, int threads, int verify) {
+    LoadStats st;
+    Bounds bounds;
+    points = load_csv_columns(path, &point_count, &bounds, threads, &st,
+                              schema, &attribs, NULL, NULL);
+    fprintf(stderr, "Loaded %zu points from %s (%.1f MB in %.3fs, %.1f MB/s, %d threads)\n",
+            point_count, path, st.bytes / 1e6, st.seconds,
+            st.seconds > 0 ? st.bytes / 1e6 / st.seconds : 0.0, st.threads);
+
+    if (verify) {
+        size_t ref_count;
+        Point *ref = load_csv_stdio(path, &ref_count);
+        size_t diff = 0;
+        for (size_t i = 0; i < point_count && i < ref_count; i++)
+            diff += memcmp(&points[i], &ref[i], sizeof(Point)) != 0;
+        // Compare by value: min/max order can pick either of -0 and +0
+        Bounds rb = bounds_compute_scalar(ref, ref_count);
+        Bounds sb = bounds_compute(ref, ref_count);
+        int bounds_ok = 1;
+        for (int i = 0; i < 6; i++) {
+            float r = (&rb.minX)[i];
+            bounds_ok &= (&bounds.minX)[i] == r && (&sb.minX)[i] == r;
+        }
+        fprintf(stderr, "Verify: %zu vs %zu points, %zu differ, bounds %s\n",
+                point_count, ref_count, diff, bounds_ok ? "match" : "differ");
+        free(ref);
+        if (diff || ref_count != point_count || !bounds_ok) exit(1);
+    }
+    return bounds;
 }
 
 static void error_callback(int error, const char *desc) {
     fprintf(stderr, "GLFW error: %s\n", desc);
 }
 
-static void draw_bounding_box(Bounds b) {
-    glColor3f(1.0f, 0.0f, 0.0f);
-    glLineWidth(2.0f);
-    glBegin(GL_LINES);
-    // Bottom
-    glVertex3f(b.minX,b.minY,b.minZ); glVertex3f(b.maxX,b.minY,b.minZ);
-    glVertex3f(b.maxX,b.minY,b.minZ); glVertex3f(b.maxX,b.minY,b.maxZ);
-    glVertex3f(b.maxX,b.minY,b.maxZ); glVertex3f(b.minX,b.minY,b.maxZ);
-    glVertex3f(b.minX,b.minY,b.maxZ); glVertex3f(b.minX,b.minY,b.minZ);
-    // Top
-    glVertex3f(b.minX,b.maxY,b.minZ); glVertex3f(b.maxX,b.maxY,b.minZ);
-    glVertex3f(b.maxX,b.maxY,b.minZ); glVertex3f(b.maxX,b.maxY,b.maxZ);
-    glVertex3f(b.maxX,b.maxY,b.maxZ); glVertex3f(b.minX,b.maxY,b.maxZ);
-    glVertex3f(b.minX,b.maxY,b.maxZ); glVertex3f(b.minX,b.maxY,b.minZ);
-    // Verticals
-    glVertex3f(b.minX,b.minY,b.minZ); glVertex3f(b.minX,b.maxY,b.minZ);
-    glVertex3f(b.maxX,b.minY,b.minZ); glVertex3f(b.maxX,b.maxY,b.minZ);
-    glVertex3f(b.maxX,b.minY,b.maxZ); glVertex3f(b.maxX,b.maxY,b.maxZ);
-    glVertex3f(b.minX,b.minY,b.maxZ); glVertex3f(b.minX,b.maxY,b.maxZ);
-    glEnd();
+// Bounding box as 12 GL_LINES segments, in a static VBO that is only
+// rewritten when the bounds change (while streaming)
+static GLuint box_vao = 0, box_vbo = 0;
+
+static void box_upload(Bounds b) {
+    const float x[2] = { b.minX, b.maxX }, y[2] = { b.minY, b.maxY }, z[2] = { b.minZ, b.maxZ };
+    float v[24][3];
+    int n = 0;
+    // Each edge joins two corners that differ in one axis
+    for (int axis = 0; axis < 3; axis++)
+        for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+                for (int end = 0; end < 2; end++, n++) {
+                    int c[3];
+                    c[axis] = end;
+                    c[(axis + 1) % 3] = i;
+                    c[(axis + 2) % 3] = j;
+                    v[n][0] = x[c[0]]; v[n][1] = y[c[1]]; v[n][2] = z[c[2]];
+                }
+    if (!box_vao) {
+        glGenVertexArrays(1, &box_vao);
+        glGenBuffers(1, &box_vbo);
+        glBindVertexArray(box_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, box_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(ATTR_POSITION);
+        glVertexAttribPointer(ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, box_vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(v), v);
+    }
+}
+
+// out = a * b, column-major
+static void mat4_mul(const float a[16], const float b[16], float out[16]) {
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            out[c*4+r] = a[r]*b[c*4] + a[4+r]*b[c*4+1] + a[8+r]*b[c*4+2] + a[12+r]*b[c*4+3];
+}
+
+static void rotate_y(float deg, float m[16]) {
+    float a = deg * (float)M_PI / 180.0f, c = cosf(a), s = sinf(a);
+    memset(m, 0, 16 * sizeof(float));
+    m[0] = c; m[8] = s; m[5] = 1; m[2] = -s; m[10] = c; m[15] = 1;
 }
 
 static void perspective(float fov_deg, float aspect, float near, float far, float m[16]) {
@@ -120,74 +205,476 @@ static void lookAt(float eyeX,float eyeY,float eyeZ,
     m[3]=0;  m[7]=0;  m[11]=0;  m[15]=1;
 }
 
-int main(int argc,char **argv){
-    if(argc<2){fprintf(stderr,"Usage: %s data.csv\n",argv[0]);return 1;}
-    load_csv(argv[1]);
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-    Bounds bounds=compute_bounds();
-    float centerX=(bounds.minX+bounds.maxX)/2.0f;
-    float centerY=(bounds.minY+bounds.maxY)/2.0f;
-    float centerZ=(bounds.minZ+bounds.maxZ)/2.0f;
+// ------------------------------------------------------------
+// Streaming VBOs: while a background load runs, batches are appended to
+// fixed-size buffers so nothing already uploaded has to move
+// ------------------------------------------------------------
 
-    float maxExtent=fmaxf(bounds.maxX-bounds.minX,
-                     fmaxf(bounds.maxY-bounds.minY,
-                           bounds.maxZ-bounds.minZ));
+#define STREAM_BLOCK_POINTS (1 << 20)
 
-    float camDist=maxExtent*1.5f;
-    float camX=centerX+camDist;
-    float camY=centerY+camDist;
-    float camZ=centerZ+camDist;
+static GLuint stream_vao = 0;
+static GLuint *stream_vbos = NULL;
+static size_t stream_blocks = 0;
+static size_t stream_fill = 0;      // points in the last block
 
-    glfwSetErrorCallback(error_callback);
-    if(!glfwInit())return 1;
+static void stream_append(const Point *p, size_t n) {
+    while (n) {
+        if (!stream_blocks || stream_fill == STREAM_BLOCK_POINTS) {
+            stream_vbos = realloc(stream_vbos, (stream_blocks + 1) * sizeof(GLuint));
+            if (!stream_vbos) { perror("malloc"); exit(1); }
+            glGenBuffers(1, &stream_vbos[stream_blocks]);
+            glBindBuffer(GL_ARRAY_BUFFER, stream_vbos[stream_blocks]);
+            glBufferData(GL_ARRAY_BUFFER, STREAM_BLOCK_POINTS * sizeof(Point), NULL, GL_STATIC_DRAW);
+            stream_blocks++;
+            stream_fill = 0;
+        }
+        size_t take = STREAM_BLOCK_POINTS - stream_fill;
+        if (take > n) take = n;
+        glBindBuffer(GL_ARRAY_BUFFER, stream_vbos[stream_blocks - 1]);
+        glBufferSubData(GL_ARRAY_BUFFER, stream_fill * sizeof(Point), take * sizeof(Point), p);
+        stream_fill += take;
+        p += take;
+        n -= take;
+    }
+}
 
-    GLFWwindow *win=glfwCreateWindow(800,600,"Particle Viewer",NULL,NULL);
-    if(!win){glfwTerminate();return 1;}
-    glfwMakeContextCurrent(win);
-    glewInit();
+static void stream_draw(void) {
+    if (!stream_vao) {
+        glGenVertexArrays(1, &stream_vao);
+        glBindVertexArray(stream_vao);
+        glEnableVertexAttribArray(ATTR_POSITION);
+    }
+    glBindVertexArray(stream_vao);
+    for (size_t i = 0; i < stream_blocks; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, stream_vbos[i]);
+        glVertexAttribPointer(ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)(i + 1 < stream_blocks ? STREAM_BLOCK_POINTS : stream_fill));
+    }
+}
+
+static void stream_free(void) {
+    if (stream_blocks)
+        glDeleteBuffers((GLsizei)stream_blocks, stream_vbos);
+    glDeleteVertexArrays(1, &stream_vao);
+    free(stream_vbos);
+    stream_vbos = NULL;
+    stream_vao = 0;
+    stream_blocks = stream_fill = 0;
+}
+
+// Final, octree-ordered VBO; int16 positions are decoded in the shader
+static void upload_points(void) {
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(ATTR_POSITION);
+    if (cache.quantized) {
+        glBufferData(GL_ARRAY_BUFFER, cache.data_bytes, cache.data, GL_STATIC_DRAW);
+        glVertexAttribPointer(ATTR_POSITION, 3, GL_SHORT, GL_FALSE, 0, 0);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, point_count * sizeof(Point), points, GL_STATIC_DRAW);
+        glVertexAttribPointer(ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    }
+
+    // One VBO per attribute, so positions never share a buffer with them
+    const struct { const void *data; GLuint index; GLint size; GLenum type; size_t bytes; } arrays[3] = {
+        { attribs.intensity, ATTR_INTENSITY, 1, GL_FLOAT, sizeof(float) },
+        { attribs.time, ATTR_TIME, 1, GL_FLOAT, sizeof(float) },
+        { attribs.rgba, ATTR_COLOR, 4, GL_UNSIGNED_BYTE, 4 },
+    };
+    for (int i = 0; i < 3; i++) {
+        if (!arrays[i].data) continue;
+        glGenBuffers(1, &attrib_vbos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, attrib_vbos[i]);
+        glBufferData(GL_ARRAY_BUFFER, point_count * arrays[i].bytes, arrays[i].data, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(arrays[i].index);
+        glVertexAttribPointer(arrays[i].index, arrays[i].size, arrays[i].type,
+                              arrays[i].type == GL_UNSIGNED_BYTE, 0, 0);
+    }
+}
+
+// Octree over points; attribs are reordered to match
+static OctreeNode *build_octree(Bounds bounds, size_t *count, int *depth) {
+    uint32_t *order = NULL;
+    if (attribs.mask) {
+        order = malloc((point_count ? point_count : 1) * sizeof(uint32_t));
+        if (!order) { perror("malloc"); exit(1); }
+    }
+    OctreeNode *n = octree_build(points, point_count, bounds, order, count, depth);
+    if (order) {
+        attribs_permute(&attribs, order, point_count);
+        free(order);
+    }
+    return n;
+}
+
+int main(int argc,char **argv){
+    int threads=0, verify=0, use_cache=1, quantize=0;
+    int headless=0, frames=300, width=800, height=600;
+    size_t budget=DEFAULT_BUDGET;
+    double fps=DEFAULT_FPS;
+    int cull=1;
+    float point_size=-1.0f;   // world units, < 0 picks one from the density
+    const char *path=NULL, *png_path=NULL, *color_by_name="rgb";
+    const char **paths=calloc(argc,sizeof(char*));
+    int path_count=0;
+    Schema schema;
+    schema_default(&schema);
+    float time_window[2]={-FLT_MAX,FLT_MAX};
+    int windowed=0;
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--threads")&&i+1<argc) threads=atoi(argv[++i]);
+        else if(!strcmp(argv[i],"--verify-loader")) verify=1;
+        else if(!strcmp(argv[i],"--no-cache")) use_cache=0;
+        else if(!strcmp(argv[i],"--quantize")) quantize=1;
+        else if(!strcmp(argv[i],"--budget")&&i+1<argc) budget=strtoull(argv[++i],NULL,10);
+        else if(!strcmp(argv[i],"--headless")) headless=1;
+        else if(!strcmp(argv[i],"--frames")&&i+1<argc) frames=atoi(argv[++i]);
+        else if(!strcmp(argv[i],"--png")&&i+1<argc) png_path=argv[++i];
+        else if(!strcmp(argv[i],"--size")&&i+1<argc) sscanf(argv[++i],"%dx%d",&width,&height);
+        else if(!strcmp(argv[i],"--columns")&&i+1<argc){ if(!schema_parse(argv[++i],&schema)) return 1; }
+        else if(!strcmp(argv[i],"--color-by")&&i+1<argc) color_by_name=argv[++i];
+        else if(!strcmp(argv[i],"--fps")&&i+1<argc) fps=atof(argv[++i]);
+        else if(!strcmp(argv[i],"--no-cull")) cull=0;
+        else if(!strcmp(argv[i],"--point-size")&&i+1<argc) point_size=(float)atof(argv[++i]);
+        else if(!strcmp(argv[i],"--time-window")&&i+1<argc){
+            if(sscanf(argv[++i],"%f:%f",&time_window[0],&time_window[1])!=2){
+                fprintf(stderr,"--time-window: expected T0:T1\n");
+                return 1;
+            }
+            windowed=1;
+        }
+        else paths[path_count++]=argv[i];
+    }
+    path=paths[0];
+    if(!path||width<1||height<1||!(fps>0)){
+        fprintf(stderr,"Usage: %s [--threads N] [--verify-loader] [--no-cache] [--quantize] [--budget POINTS] [--size WxH]\n"
+                       "          [--columns SPEC] [--color-by rgb|intensity|time] [--time-window T0:T1]\n"
+                       "          [--fps N] [--no-cull] [--point-size R]\n"
+                       "          [--headless [--frames N] [--png out.png]] data.csv [frame2.csv ...]\n",argv[0]);
+        return 1;
+    }
+    unsigned have=schema_attribs(&schema);
+    int color_by;
+    if(!strcmp(color_by_name,"rgb")) color_by=COLOR_BY_RGB;
+    else if(!strcmp(color_by_name,"intensity")&&(have&ATTRIB_INTENSITY)) color_by=COLOR_BY_INTENSITY;
+    else if(!strcmp(color_by_name,"time")&&(have&ATTRIB_TIME)) color_by=COLOR_BY_TIME;
+    else{
+        fprintf(stderr,"--color-by %s: no such column in --columns\n",color_by_name);
+        return 1;
+    }
+    if(windowed&&!(have&ATTRIB_TIME)){
+        fprintf(stderr,"--time-window: no time column in --columns\n");
+        return 1;
+    }
+    if(windowed&&!(time_window[0]<=time_window[1])){
+        fprintf(stderr,"--time-window: T0 must not be after T1\n");
+        return 1;
+    }
+    if(verify&&!schema_is_default(&schema)){
+        fprintf(stderr,"--verify-loader only checks x,y,z files\n");
+        return 1;
+    }
+    int playback=path_count>1||(have&ATTRIB_FRAME);
+    if(playback&&(verify||color_by!=COLOR_BY_RGB||windowed)){
+        fprintf(stderr,"Playback draws positions only: no --verify-loader, --color-by or --time-window\n");
+        return 1;
+    }
+
+    // A valid cache, --verify-loader or --headless loads up front (so every
+    // benchmarked frame draws the same data); otherwise the CSV streams in
+    // on a background thread while the window is already up
+    Bounds bounds={0};
+    OctreeNode *built=NULL;
+    BackgroundLoad bl;
+    int streaming=0;
+    double t0=now_seconds();
+    int attribs_mapped=0;
+    if(playback){
+        // Timesteps load on their own thread once GL is up
+    }else if(use_cache&&!verify&&point_cache_open(path,quantize,&schema,&cache)){
+        // Float payloads are used in place; int16 ones only go to the GPU
+        bounds=cache.bounds;
+        point_count=cache.count;
+        if(!cache.quantized) points=(Point*)cache.data;
+        nodes=cache.nodes;
+        node_count=cache.node_count;
+        attribs=cache.attribs;
+        attribs_mapped=1;
+        fprintf(stderr,"Loaded %zu points from %s.pcache in %.3fs\n",point_count,path,now_seconds()-t0);
+    }else if(verify||headless){
+        bounds=load_csv(path,&schema,threads,verify);
+        int depth;
+        double tb=now_seconds();
+        built=build_octree(bounds,&node_count,&depth);
+        nodes=built;
+        fprintf(stderr,"Octree: %zu nodes, depth %d, built in %.3fs\n",node_count,depth,now_seconds()-tb);
+        if(use_cache&&point_cache_write(path,points,point_count,bounds,nodes,node_count,&schema,&attribs,quantize)&&quantize)
+            point_cache_open(path,quantize,&schema,&cache);
+    }else{
+        streaming=1;
+    }
+
+    GLFWwindow *win=NULL;
+    Headless hl;
+    if(headless){
+        if(!headless_create(&hl,width,height))return 1;
+    }else{
+        glfwSetErrorCallback(error_callback);
+        if(!glfwInit())return 1;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,2);
+        glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT,GL_TRUE);
+        win=glfwCreateWindow(width,height,"Particle Viewer",NULL,NULL);
+        if(!win){glfwTerminate();return 1;}
+        glfwMakeContextCurrent(win);
+    }
+    glewExperimental=GL_TRUE;   // core profile entry points
+    GLenum glew_err=glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX builds of GLEW complain without an X display but load fine on EGL
+    if(headless&&glew_err==GLEW_ERROR_NO_GLX_DISPLAY) glew_err=GLEW_OK;
+#endif
+    if(glew_err!=GLEW_OK){fprintf(stderr,"glewInit: %s\n",glewGetErrorString(glew_err));return 1;}
+    glGetError();   // glewInit can leave GL_INVALID_ENUM behind on core profiles
+    if(headless) headless_bind(&hl);
 
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_POINT_SMOOTH);
-    glPointSize(5.0f);
+    glEnable(GL_PROGRAM_POINT_SIZE);
     glClearColor(0.05f,0.05f,0.1f,1.0f);
 
-    // Upload VBO
-    glGenBuffers(1,&vbo);
-    glBindBuffer(GL_ARRAY_BUFFER,vbo);
-    glBufferData(GL_ARRAY_BUFFER,point_count*sizeof(Point),points,GL_STATIC_DRAW);
+    PointProgram prog;
+    point_program_create(&prog);
+    glUseProgram(prog.program);
+    glVertexAttrib1f(ATTR_SIZE,POINT_PIXELS);
+
+    LodSelection sel={0};
+    Playback pb;
+    if(playback){
+        playback_start(&pb,paths,path_count,&schema,threads,fps);
+    }else if(streaming){
+        background_load_start(&bl,path,&schema,threads,use_cache,quantize);
+    }else{
+        upload_points();
+        lod_selection_init(&sel,node_count);
+    }
+    float qoffset[3],qscale[3];
+    point_cache_dequant(&bounds,qoffset,qscale);
+    int fb_w=0, fb_h=0;
+    size_t streamed=0;
+
+    // Projection changes with the framebuffer, view with the bounds
+    float proj[16], view[16], proj_view[16], eye_world[3]={0}, view_extent=0;
+    Bounds view_bounds;
+    int view_valid=0;
+
+    FrameTimer timer;
+    if(headless) frame_timer_init(&timer);
 
     float angle=0.0f;
-    while(!glfwWindowShouldClose(win)){
-        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+    int frame=0;
+    int ready=1;
+    size_t drawn=0;
+    double last=now_seconds();
+    while(headless?frame<frames:!glfwWindowShouldClose(win)){
+        if(playback){
+            // Headless frames advance the clock as if shown at HEADLESS_HZ
+            double now=now_seconds();
+            ready=playback_update(&pb,headless?1.0/HEADLESS_HZ:now-last);
+            last=now;
+            bounds=pb.bounds;
+            if(ready<0){
+                fprintf(stderr,"playback: no frames in %s\n",paths[0]);
+                exit(1);
+            }
+            if(!ready&&headless){
+                // Nothing to time before the first timestep
+                nanosleep(&(struct timespec){0,1000000},NULL);
+                continue;
+            }
+        }
+        if(streaming){
+            // Upload what arrived since the last frame
+            int done;
+            Batch *b=background_load_take(&bl,&bounds,&done);
+            while(b){
+                Batch *next=b->next;
+                if(!streamed) fprintf(stderr,"First points on screen after %.3fs\n",now_seconds()-t0);
+                stream_append(b->points,b->n);
+                streamed+=b->n;
+                free(b);
+                b=next;
+            }
+            if(done){
+                // Swap the streaming buffers for the octree-ordered one
+                background_load_join(&bl);
+                points=bl.points;
+                point_count=bl.count;
+                built=bl.nodes;
+                nodes=built;
+                node_count=bl.node_count;
+                attribs=bl.attribs;
+                if(quantize&&bl.cached) point_cache_open(path,quantize,&schema,&cache);
+                stream_free();
+                upload_points();
+                lod_selection_init(&sel,node_count);
+                point_cache_dequant(&bounds,qoffset,qscale);
+                streaming=0;
+            }
+        }
+
+        if(headless) frame_timer_begin(&timer);
+        int w=width,h=height;
+        if(win) glfwGetFramebufferSize(win,&w,&h);
+        if(w!=fb_w||h!=fb_h){
+            fb_w=w; fb_h=h;
+            glViewport(0,0,fb_w,fb_h);
+            perspective(FOVY,fb_h>0?(float)fb_w/fb_h:1.0f,0.1f,1000.0f,proj);
+            view_valid=0;
+        }
+        // Camera follows the bounds, which grow while streaming
+        if(!view_valid||memcmp(&view_bounds,&bounds,sizeof(Bounds))){
+            float centerX=(bounds.minX+bounds.maxX)/2.0f;
+            float centerY=(bounds.minY+bounds.maxY)/2.0f;
+            float centerZ=(bounds.minZ+bounds.maxZ)/2.0f;
+
+            float maxExtent=fmaxf(bounds.maxX-bounds.minX,
+                             fmaxf(bounds.maxY-bounds.minY,
+                                   bounds.maxZ-bounds.minZ));
+
+            view_extent=maxExtent;
+            float camDist=maxExtent*1.5f;
+            eye_world[0]=centerX+camDist;
+            eye_world[1]=centerY+camDist;
+            eye_world[2]=centerZ+camDist;
+            lookAt(eye_world[0],eye_world[1],eye_world[2],centerX,centerY,centerZ,0,1,0,view);
+            mat4_mul(proj,view,proj_view);
+            box_upload(bounds);
+            view_bounds=bounds;
+            view_valid=1;
+        }
+
+        float model[16], mvp[16];
+        rotate_y(angle,model);
+        mat4_mul(proj_view,model,mvp);
+        glUniformMatrix4fv(prog.mvp,1,GL_FALSE,mvp);
 
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        float proj[16]; perspective(60.0f,800.0f/600.0f,0.1f,1000.0f,proj);
-        glLoadMatrixf(proj);
+        // Camera position in point space undoes the model rotation
+        float a=angle*(float)M_PI/180.0f;
+        float camX=eye_world[0], camY=eye_world[1], camZ=eye_world[2];
+        float eye[3]={camX*cosf(a)-camZ*sinf(a),camY,camX*sinf(a)+camZ*cosf(a)};
+        float px_per_rad=fb_h/(2.0f*tanf(FOVY*0.5f*(float)M_PI/180.0f));
+        // Everything in view when there is no budget, otherwise LOD too
+        int draw_all=!budget||budget>=point_count;
+        Frustum frustum;
+        frustum_from_matrix(mvp,&frustum);
+        if(!streaming&&!playback&&(cull||!draw_all))
+            octree_select(nodes,node_count,eye,px_per_rad,draw_all?0.0f:1.0f,draw_all?0:budget,
+                          cull?&frustum:NULL,&sel);
 
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        float view[16]; lookAt(camX,camY,camZ,centerX,centerY,centerZ,0,1,0,view);
-        glLoadMatrixf(view);
-        glRotatef(angle,0.0f,1.0f,0.0f);
+        // Point radius from the density of what is drawn, on average
+        size_t cloud=streaming?streamed:playback?drawn:draw_all?point_count:budget;
+        float radius=point_size>=0?point_size:cloud?view_extent/cbrtf((float)cloud):0;
         angle+=0.3f;
 
-        draw_bounding_box(bounds);
+        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+        if((streaming&&!streamed)||!ready){
+            glfwSwapBuffers(win);
+            glfwPollEvents();
+            continue;
+        }
+
+        glUniform3f(prog.offset,0.0f,0.0f,0.0f);
+        glUniform3f(prog.scale,1.0f,1.0f,1.0f);
+        glUniform1i(prog.round,0);
+        glUniform1f(prog.size_scale,0.0f);
+        glUniform1i(prog.color_by,COLOR_BY_RGB);
+        glUniform2f(prog.time_window,-FLT_MAX,FLT_MAX);
+        glVertexAttrib4f(ATTR_COLOR,1.0f,0.0f,0.0f,1.0f);
+        glBindVertexArray(box_vao);
+        glDrawArrays(GL_LINES,0,24);
 
         // Draw points via VBO
-        glEnableClientState(GL_VERTEX_ARRAY);
-        glBindBuffer(GL_ARRAY_BUFFER,vbo);
-        glVertexPointer(3,GL_FLOAT,0,0);
-        glColor3f(0.7f,0.8f,1.0f);
-        glDrawArrays(GL_POINTS,0,(GLsizei)point_count);
-        glDisableClientState(GL_VERTEX_ARRAY);
+        glUniform1i(prog.round,1);
+        glVertexAttrib4f(ATTR_COLOR,0.7f,0.8f,1.0f,1.0f);
+        glUniform1f(prog.size_scale,radius*px_per_rad);
+        if(streaming){
+            // Positions only until the load finishes; colour and the time window
+            // apply from then on
+            stream_draw();
+            drawn=streamed;
+        }else if(playback){
+            drawn=playback_draw(&pb,prog.blend);
+        }else{
+            glUniform1i(prog.color_by,color_by);
+            glUniform2fv(prog.ramp,1,color_by==COLOR_BY_TIME?attribs.time_range:attribs.intensity_range);
+            glUniform2fv(prog.time_window,1,time_window);
+            if(cache.quantized){
+                // int16 positions decode as offset + q * scale
+                glUniform3fv(prog.offset,1,qoffset);
+                glUniform3fv(prog.scale,1,qscale);
+            }
+            glBindVertexArray(vao);
+            if(draw_all&&!cull){
+                glDrawArrays(GL_POINTS,0,(GLsizei)point_count);
+                drawn=point_count;
+            }else{
+                glMultiDrawArrays(GL_POINTS,sel.first,sel.count,(GLsizei)sel.ranges);
+                drawn=sel.points;
+            }
+        }
 
-        glfwSwapBuffers(win);
-        glfwPollEvents();
+        if(headless){
+            frame_timer_end(&timer,drawn);
+            glFlush();   // what a swap would do
+        }else{
+            glfwSwapBuffers(win);
+            glfwPollEvents();
+        }
+        frame++;
+    }
+
+    if(headless){
+        frame_timer_report(&timer,stdout);
+        if(playback)
+            printf("playback: %ld timesteps uploaded, clock stalled %.3fs\n",pb.uploads,pb.stalled);
+        frame_timer_free(&timer);
+        if(png_path&&headless_write_png(&hl,png_path))
+            fprintf(stderr,"Wrote %s\n",png_path);
     }
 
+    if(streaming){
+        // Closed mid-load: stop parsing and drop what was read
+        background_load_cancel(&bl);
+        background_load_join(&bl);
+        stream_free();
+        free(bl.points);
+        free(bl.nodes);
+        attribs_free(&bl.attribs);
+    }
+    if(playback) playback_stop(&pb);
+    lod_selection_free(&sel);
     glDeleteBuffers(1,&vbo);
-    glfwTerminate();
-    free(points);
+    glDeleteBuffers(3,attrib_vbos);
+    glDeleteVertexArrays(1,&vao);
+    glDeleteBuffers(1,&box_vbo);
+    glDeleteVertexArrays(1,&box_vao);
+    point_program_destroy(&prog);
+    if(headless) headless_destroy(&hl);
+    else glfwTerminate();
+    free(built);
+    if(points!=(const Point*)cache.data) free(points);
+    if(!attribs_mapped) attribs_free(&attribs);
+    point_cache_close(&cache);
+    free(paths);
     return 0;
 }
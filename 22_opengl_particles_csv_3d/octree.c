@@ -0,0 +1,336 @@
+#include "octree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+
+// Nodes with at most this many points aren't split
+#define LEAF_POINTS 8192
+#define MAX_DEPTH   20
+// Sampling grid per node, per axis: at most GRID^3 points per inner node
+#define GRID        16
+
+typedef struct {
+    Point *points;
+    Point *tmp;
+    uint32_t *order, *order_tmp;    // original index of each point, or NULL
+    OctreeNode *nodes;
+    size_t node_count, node_cap;
+    uint32_t stamp[GRID * GRID * GRID];
+    uint32_t gen;
+    int depth;
+} Builder;
+
+static uint32_t alloc_nodes(Builder *b, int n) {
+    if (b->node_count + n > b->node_cap) {
+        while (b->node_count + n > b->node_cap)
+            b->node_cap = b->node_cap ? b->node_cap * 2 : 1024;
+        b->nodes = realloc(b->nodes, b->node_cap * sizeof(OctreeNode));
+        if (!b->nodes) { perror("octree"); exit(1); }
+    }
+    uint32_t first = (uint32_t)b->node_count;
+    b->node_count += n;
+    return first;
+}
+
+// Grid cell along one axis; NaN lands in cell 0
+static int grid_cell(float v, float lo, float inv) {
+    float t = (v - lo) * inv;
+    return t > 0 ? (t < GRID - 1 ? (int)t : GRID - 1) : 0;
+}
+
+// Sample node idx and sort the rest of its points by octant. Returns the
+// number of non-empty children (0 for a leaf) with their ranges and cells.
+static int split(Builder *b, uint32_t idx, size_t begin, size_t end, int depth,
+                 size_t start[8], size_t size[8], Bounds cell[8]) {
+    Bounds box = b->nodes[idx].box;
+    size_t n = end - begin;
+    if (depth > b->depth) b->depth = depth;
+
+    b->nodes[idx].first = (uint32_t)begin;
+    b->nodes[idx].count = (uint32_t)n;
+    b->nodes[idx].child = 0;
+    b->nodes[idx].child_count = 0;
+    if (n <= LEAF_POINTS || depth >= MAX_DEPTH)
+        return 0;
+
+    // Keep the first point that falls in each grid cell, moved to the front
+    float inv = GRID / (box.maxX - box.minX);
+    if (!isfinite(inv)) inv = 0;
+    uint32_t gen = ++b->gen;
+    Point *p = b->points;
+    size_t kept = begin;
+    for (size_t i = begin; i < end; i++) {
+        int c = (grid_cell(p[i].z, box.minZ, inv) * GRID +
+                 grid_cell(p[i].y, box.minY, inv)) * GRID +
+                 grid_cell(p[i].x, box.minX, inv);
+        if (b->stamp[c] != gen) {
+            b->stamp[c] = gen;
+            Point t = p[kept]; p[kept] = p[i]; p[i] = t;
+            if (b->order) {
+                uint32_t o = b->order[kept]; b->order[kept] = b->order[i]; b->order[i] = o;
+            }
+            kept++;
+        }
+    }
+    b->nodes[idx].count = (uint32_t)(kept - begin);
+    if (kept == end)
+        return 0;
+
+    // Counting sort of the rest by octant
+    float cx = (box.minX + box.maxX) * 0.5f;
+    float cy = (box.minY + box.maxY) * 0.5f;
+    float cz = (box.minZ + box.maxZ) * 0.5f;
+    size_t counts[8] = {0};
+    for (size_t i = kept; i < end; i++)
+        counts[(p[i].x >= cx) | (p[i].y >= cy) << 1 | (p[i].z >= cz) << 2]++;
+    size_t fill[8], s = kept;
+    for (int o = 0; o < 8; o++) { fill[o] = s; s += counts[o]; }
+    for (size_t i = kept; i < end; i++) {
+        size_t to = fill[(p[i].x >= cx) | (p[i].y >= cy) << 1 | (p[i].z >= cz) << 2]++;
+        b->tmp[to] = p[i];
+        if (b->order) b->order_tmp[to] = b->order[i];
+    }
+    memcpy(p + kept, b->tmp + kept, (end - kept) * sizeof(Point));
+    if (b->order)
+        memcpy(b->order + kept, b->order_tmp + kept, (end - kept) * sizeof(uint32_t));
+
+    int k = 0;
+    for (int o = 0; o < 8; o++) {
+        if (!counts[o]) continue;
+        start[k] = fill[o] - counts[o];
+        size[k] = counts[o];
+        Bounds *cb = &cell[k++];
+        cb->minX = o & 1 ? cx : box.minX; cb->maxX = o & 1 ? box.maxX : cx;
+        cb->minY = o & 2 ? cy : box.minY; cb->maxY = o & 2 ? box.maxY : cy;
+        cb->minZ = o & 4 ? cz : box.minZ; cb->maxZ = o & 4 ? box.maxZ : cz;
+    }
+    return k;
+}
+
+static void build(Builder *b, uint32_t idx, size_t begin, size_t end, int depth) {
+    size_t start[8], size[8];
+    Bounds cell[8];
+    int k = split(b, idx, begin, end, depth, start, size, cell);
+    if (!k) return;
+    uint32_t child = alloc_nodes(b, k);
+    b->nodes[idx].child = child;
+    b->nodes[idx].child_count = k;
+    for (int c = 0; c < k; c++) {
+        b->nodes[child + c].box = cell[c];
+        build(b, child + c, start[c], start[c] + size[c], depth + 1);
+    }
+}
+
+// One subtree under the root, built on its own thread into its own
+// node array (local node 0 is the subtree root)
+typedef struct {
+    Builder b;
+    size_t begin, end;
+} Subtree;
+
+static void *build_subtree(void *arg) {
+    Subtree *s = arg;
+    build(&s->b, 0, s->begin, s->end, 1);
+    return NULL;
+}
+
+OctreeNode *octree_build(Point *points, size_t count, Bounds bounds,
+                         uint32_t *order, size_t *node_count, int *depth) {
+    if (count > UINT32_MAX) { fprintf(stderr, "octree: too many points\n"); exit(1); }
+
+    Builder *b = calloc(1, sizeof(Builder));
+    Subtree *sub = calloc(8, sizeof(Subtree));
+    if (!b || !sub) { perror("octree"); exit(1); }
+    b->points = points;
+    b->tmp = malloc((count ? count : 1) * sizeof(Point));
+    if (!b->tmp) { perror("octree"); exit(1); }
+    if (order) {
+        for (size_t i = 0; i < count; i++)
+            order[i] = (uint32_t)i;
+        b->order = order;
+        b->order_tmp = malloc((count ? count : 1) * sizeof(uint32_t));
+        if (!b->order_tmp) { perror("octree"); exit(1); }
+    }
+
+    // Root cell: a cube around the bounds, so children stay cubes
+    float cx = (bounds.minX + bounds.maxX) * 0.5f;
+    float cy = (bounds.minY + bounds.maxY) * 0.5f;
+    float cz = (bounds.minZ + bounds.maxZ) * 0.5f;
+    float h = fmaxf(bounds.maxX - bounds.minX,
+              fmaxf(bounds.maxY - bounds.minY, bounds.maxZ - bounds.minZ)) * 0.5f;
+    uint32_t root = alloc_nodes(b, 1);
+    b->nodes[root].box = (Bounds){ cx - h, cx + h, cy - h, cy + h, cz - h, cz + h };
+
+    size_t start[8], size[8];
+    Bounds cell[8];
+    int k = split(b, root, 0, count, 0, start, size, cell);
+
+    // Point ranges of the children don't overlap, so they build in parallel
+    pthread_t tids[8];
+    for (int c = 0; c < k; c++) {
+        sub[c].b.points = points;
+        sub[c].b.tmp = b->tmp;
+        sub[c].b.order = b->order;
+        sub[c].b.order_tmp = b->order_tmp;
+        alloc_nodes(&sub[c].b, 1);
+        sub[c].b.nodes[0].box = cell[c];
+        sub[c].begin = start[c];
+        sub[c].end = start[c] + size[c];
+        int err = pthread_create(&tids[c], NULL, build_subtree, &sub[c]);
+        if (err) { fprintf(stderr, "pthread_create: %s\n", strerror(err)); exit(1); }
+    }
+    for (int c = 0; c < k; c++)
+        pthread_join(tids[c], NULL);
+
+    // Splice: the subtree roots become the root's children, the rest of
+    // each subtree follows in turn
+    if (k) {
+        uint32_t child = alloc_nodes(b, k);
+        b->nodes[root].child = child;
+        b->nodes[root].child_count = k;
+    }
+    for (int c = 0; c < k; c++) {
+        uint32_t base = alloc_nodes(b, (int)sub[c].b.node_count - 1) - 1;
+        for (size_t j = 0; j < sub[c].b.node_count; j++) {
+            OctreeNode n = sub[c].b.nodes[j];
+            if (n.child) n.child += base;
+            b->nodes[j ? base + j : (size_t)1 + c] = n;
+        }
+        if (sub[c].b.depth > b->depth) b->depth = sub[c].b.depth;
+        free(sub[c].b.nodes);
+    }
+
+    OctreeNode *nodes = b->nodes;
+    *node_count = b->node_count;
+    if (depth) *depth = b->depth;
+    free(b->tmp);
+    free(b->order_tmp);
+    free(b);
+    free(sub);
+    return nodes;
+}
+
+// ------------------------------------------------------------
+// Per-frame selection
+// ------------------------------------------------------------
+
+struct LodHeapItem {
+    float pixels;
+    uint32_t node;
+    int inside;      // node is entirely in the frustum, so its subtree is too
+};
+
+void lod_selection_init(LodSelection *sel, size_t node_count) {
+    memset(sel, 0, sizeof(*sel));
+    size_t n = node_count ? node_count : 1;
+    sel->first = malloc(n * sizeof(int));
+    sel->count = malloc(n * sizeof(int));
+    sel->picked = malloc(n * sizeof(uint32_t));
+    sel->heap = malloc(n * sizeof(struct LodHeapItem));
+    if (!sel->first || !sel->count || !sel->picked || !sel->heap) { perror("octree"); exit(1); }
+    sel->cap = n;
+}
+
+void lod_selection_free(LodSelection *sel) {
+    free(sel->first);
+    free(sel->count);
+    free(sel->picked);
+    free(sel->heap);
+    memset(sel, 0, sizeof(*sel));
+}
+
+// Projected radius of a node's cell, in pixels
+static float node_pixels(const OctreeNode *n, const float eye[3], float pixels_per_radian) {
+    float h = (n->box.maxX - n->box.minX) * 0.5f;
+    float dx = (n->box.minX + h) - eye[0];
+    float dy = (n->box.minY + h) - eye[1];
+    float dz = (n->box.minZ + h) - eye[2];
+    float r = h * 1.7320508f;
+    float d = sqrtf(dx * dx + dy * dy + dz * dz);
+    return d > r ? r / d * pixels_per_radian : FLT_MAX;
+}
+
+static void heap_push(struct LodHeapItem *heap, size_t *n, struct LodHeapItem it) {
+    size_t i = (*n)++;
+    while (i > 0 && heap[(i - 1) / 2].pixels < it.pixels) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = it;
+}
+
+static struct LodHeapItem heap_pop(struct LodHeapItem *heap, size_t *n) {
+    struct LodHeapItem top = heap[0], last = heap[--*n];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= *n) break;
+        if (c + 1 < *n && heap[c + 1].pixels > heap[c].pixels) c++;
+        if (heap[c].pixels <= last.pixels) break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    if (*n) heap[i] = last;
+    return top;
+}
+
+static const OctreeNode *sort_nodes;
+
+static int by_first(const void *a, const void *b) {
+    uint32_t fa = sort_nodes[*(const uint32_t *)a].first;
+    uint32_t fb = sort_nodes[*(const uint32_t *)b].first;
+    return (fa > fb) - (fa < fb);
+}
+
+void octree_select(const OctreeNode *nodes, size_t node_count,
+                   const float eye[3], float pixels_per_radian,
+                   float min_pixels, size_t budget, const Frustum *frustum,
+                   LodSelection *sel) {
+    sel->ranges = sel->points = sel->nodes = sel->culled = 0;
+    if (!node_count) return;
+
+    // Largest on screen first; a skipped node's subtree is never visited,
+    // so every picked node's parent is picked too. Culled nodes don't
+    // count against the budget and neither does anything under them.
+    size_t heap_n = 0;
+    heap_push(sel->heap, &heap_n, (struct LodHeapItem){ FLT_MAX, 0, !frustum });
+    while (heap_n) {
+        struct LodHeapItem it = heap_pop(sel->heap, &heap_n);
+        if (it.pixels < min_pixels)
+            break;
+        const OctreeNode *n = &nodes[it.node];
+        int inside = it.inside;
+        if (!inside) {
+            int t = frustum_test_box(frustum, &n->box);
+            if (t == FRUSTUM_OUTSIDE) { sel->culled++; continue; }
+            inside = t == FRUSTUM_INSIDE;
+        }
+        if (budget && sel->nodes && sel->points + n->count > budget)
+            continue;
+        sel->picked[sel->nodes++] = it.node;
+        sel->points += n->count;
+        for (uint32_t c = 0; c < n->child_count; c++) {
+            uint32_t ci = n->child + c;
+            heap_push(sel->heap, &heap_n,
+                      (struct LodHeapItem){ node_pixels(&nodes[ci], eye, pixels_per_radian), ci, inside });
+        }
+    }
+
+    // Merge ranges that are adjacent in the buffer
+    sort_nodes = nodes;
+    qsort(sel->picked, sel->nodes, sizeof(uint32_t), by_first);
+    for (size_t i = 0; i < sel->nodes; i++) {
+        const OctreeNode *n = &nodes[sel->picked[i]];
+        if (sel->ranges && (size_t)sel->first[sel->ranges - 1] + sel->count[sel->ranges - 1] == n->first) {
+            sel->count[sel->ranges - 1] += n->count;
+        } else {
+            sel->first[sel->ranges] = (int)n->first;
+            sel->count[sel->ranges] = (int)n->count;
+            sel->ranges++;
+        }
+    }
+}
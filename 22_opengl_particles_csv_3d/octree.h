@@ -0,0 +1,65 @@
+// Level-of-detail octree over a point cloud.
+//
+// octree_build() reorders the points so every node owns one contiguous
+// range of the array (and so of the VBO): a node keeps a spatially even
+// sample of its points (at most one per cell of a 16^3 grid) and passes
+// the rest down to its children. Points are laid out depth first, so a
+// node's range is followed by its children's. Drawing any set of nodes
+// that includes all their ancestors gives a coarse-to-fine subset of the
+// cloud; drawing every node gives every point exactly once.
+//
+// octree_select() picks nodes each frame, largest on screen first, until
+// a point budget is used up, and returns them as merged draw ranges.
+// Nodes outside the view frustum are culled along with their subtrees.
+
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "csv_loader.h"
+#include "frustum.h"
+
+// Fixed layout: stored as is in the point cache
+typedef struct {
+    Bounds box;             // the node's cell (a cube)
+    uint32_t first, count;  // own points: [first, first + count)
+    uint32_t child;         // index of the first child, 0 for a leaf
+    uint32_t child_count;   // children are stored next to each other
+} OctreeNode;
+
+// Reorder points in place and return the malloc'd node array (root first).
+// If order isn't NULL it receives count indices, order[i] being where
+// points[i] was before, for reordering other per-point arrays to match.
+// Exits on allocation failure.
+OctreeNode *octree_build(Point *points, size_t count, Bounds bounds,
+                         uint32_t *order, size_t *node_count, int *depth);
+
+typedef struct {
+    int *first;             // draw ranges for glMultiDrawArrays
+    int *count;
+    size_t ranges;
+    size_t points;          // points selected
+    size_t nodes;           // nodes selected
+    size_t culled;          // subtrees dropped by the frustum test
+    // scratch, sized for node_count
+    uint32_t *picked;
+    struct LodHeapItem *heap;
+    size_t cap;
+} LodSelection;
+
+void lod_selection_init(LodSelection *sel, size_t node_count);
+void lod_selection_free(LodSelection *sel);
+
+// eye is in the same space as the points. pixels_per_radian converts a
+// node's angular radius to pixels (viewport height / (2 tan(fovy / 2))).
+// Nodes smaller than min_pixels are skipped; the root is always picked
+// unless it is culled. budget == 0 means no limit. frustum (in point
+// space) may be NULL to skip culling.
+void octree_select(const OctreeNode *nodes, size_t node_count,
+                   const float eye[3], float pixels_per_radian,
+                   float min_pixels, size_t budget, const Frustum *frustum,
+                   LodSelection *sel);
+
+#endif
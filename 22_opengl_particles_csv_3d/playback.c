@@ -0,0 +1,243 @@
+#include "playback.h"
+#include "bounds.h"
+#include "shaders.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static PlaybackFrame *frame_new(const Point *points, size_t n, long seq, int index) {
+    PlaybackFrame *f = malloc(sizeof(PlaybackFrame) + n * sizeof(Point));
+    if (!f) { perror("malloc"); exit(1); }
+    f->next = NULL;
+    f->seq = seq;
+    f->index = index;
+    f->n = n;
+    f->bounds = bounds_compute(points, n);
+    memcpy(f->points, points, n * sizeof(Point));
+    return f;
+}
+
+// Queue f, waiting while PLAYBACK_AHEAD frames are already waiting.
+// Returns 0 (and frees f) once the playback is stopped.
+static int push(Playback *pb, PlaybackFrame *f) {
+    pthread_mutex_lock(&pb->lock);
+    while (pb->queued >= PLAYBACK_AHEAD && !pb->stop)
+        pthread_cond_wait(&pb->cond, &pb->lock);
+    int stop = pb->stop;
+    if (!stop) {
+        if (pb->tail) pb->tail->next = f;
+        else pb->head = f;
+        pb->tail = f;
+        pb->queued++;
+    }
+    pthread_mutex_unlock(&pb->lock);
+    if (stop) free(f);
+    return !stop;
+}
+
+static PlaybackFrame *take(Playback *pb) {
+    pthread_mutex_lock(&pb->lock);
+    PlaybackFrame *f = pb->head;
+    if (f) {
+        pb->head = f->next;
+        if (!pb->head) pb->tail = NULL;
+        pb->queued--;
+        pthread_cond_signal(&pb->cond);
+    }
+    pthread_mutex_unlock(&pb->lock);
+    return f;
+}
+
+typedef struct {
+    float frame;
+    uint32_t row;
+} FrameKey;
+
+static int cmp_key(const void *a, const void *b) {
+    const FrameKey *x = a, *y = b;
+    if (x->frame != y->frame) return x->frame < y->frame ? -1 : 1;
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+// Load the single CSV and group its rows by frame column. Returns the
+// number of frames; frame i is (*all)[(*start)[i] .. (*start)[i + 1]).
+static int split_frames(Playback *pb, Point **all, size_t **start) {
+    size_t n;
+    Bounds b;
+    PointAttribs a;
+    Point *p = load_csv_columns(pb->paths[0], &n, &b, pb->threads, NULL, pb->schema, &a, NULL, NULL);
+    if (n > UINT32_MAX) { fprintf(stderr, "playback: too many points\n"); exit(1); }
+
+    FrameKey *keys = malloc((n ? n : 1) * sizeof(FrameKey));
+    *all = malloc((n ? n : 1) * sizeof(Point));
+    *start = malloc((n + 1) * sizeof(size_t));
+    if (!keys || !*all || !*start) { perror("malloc"); exit(1); }
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++)
+        if (a.frame[i] == a.frame[i])   // rows without a frame are dropped
+            keys[kept++] = (FrameKey){ a.frame[i], (uint32_t)i };
+    qsort(keys, kept, sizeof(FrameKey), cmp_key);
+
+    int frames = 0;
+    for (size_t i = 0; i < kept; i++) {
+        if (!i || keys[i].frame != keys[i - 1].frame)
+            (*start)[frames++] = i;
+        (*all)[i] = p[keys[i].row];
+    }
+    (*start)[frames] = kept;
+    fprintf(stderr, "Playback: %zu points in %d frames from %s\n", kept, frames, pb->paths[0]);
+
+    free(keys);
+    free(p);
+    attribs_free(&a);
+    return frames;
+}
+
+static void *run(void *arg) {
+    Playback *pb = arg;
+    int by_column = pb->path_count == 1 && (schema_attribs(pb->schema) & ATTRIB_FRAME);
+    Point *all = NULL;
+    size_t *start = NULL;
+    int frames = by_column ? split_frames(pb, &all, &start) : pb->path_count;
+    if (!frames) {
+        pthread_mutex_lock(&pb->lock);
+        pb->empty = 1;
+        pthread_mutex_unlock(&pb->lock);
+    }
+
+    // Loop forever; every pass over the files parses them again so only
+    // the ring and the queue are ever held
+    for (long seq = 0; frames > 0; seq++) {
+        int index = (int)(seq % frames);
+        PlaybackFrame *f;
+        if (by_column) {
+            f = frame_new(all + start[index], start[index + 1] - start[index], seq, index);
+        } else {
+            size_t n;
+            Bounds b;
+            PointAttribs a;
+            Point *p = load_csv_columns(pb->paths[index], &n, &b, pb->threads, NULL,
+                                        pb->schema, &a, NULL, NULL);
+            f = frame_new(p, n, seq, index);
+            free(p);
+            attribs_free(&a);
+        }
+        if (!push(pb, f)) break;
+    }
+    free(all);
+    free(start);
+    return NULL;
+}
+
+void playback_start(Playback *pb, const char **paths, int path_count,
+                    const Schema *schema, int threads, double fps) {
+    memset(pb, 0, sizeof(*pb));
+    pb->paths = paths;
+    pb->path_count = path_count;
+    pb->schema = schema;
+    pb->threads = threads;
+    pb->fps = fps;
+    for (int s = 0; s < PLAYBACK_SLOTS; s++)
+        pb->slot_seq[s] = -1;
+
+    glGenVertexArrays(1, &pb->vao);
+    glGenBuffers(PLAYBACK_SLOTS, pb->vbos);
+    glBindVertexArray(pb->vao);
+    glEnableVertexAttribArray(ATTR_POSITION);
+
+    pthread_mutex_init(&pb->lock, NULL);
+    pthread_cond_init(&pb->cond, NULL);
+    int err = pthread_create(&pb->tid, NULL, run, pb);
+    if (err) { fprintf(stderr, "pthread_create: %s\n", strerror(err)); exit(1); }
+}
+
+static int slot_of(const Playback *pb, long seq) {
+    for (int s = 0; s < PLAYBACK_SLOTS; s++)
+        if (pb->slot_seq[s] == seq) return s;
+    return -1;
+}
+
+int playback_update(Playback *pb, double dt) {
+    // Slots behind the current timestep are free for the next ones
+    long k = (long)pb->t;
+    for (;;) {
+        int s = 0;
+        while (s < PLAYBACK_SLOTS && pb->slot_seq[s] >= k) s++;
+        if (s == PLAYBACK_SLOTS) break;
+        PlaybackFrame *f = take(pb);
+        if (!f) break;
+        glBindBuffer(GL_ARRAY_BUFFER, pb->vbos[s]);
+        glBufferData(GL_ARRAY_BUFFER, f->n * sizeof(Point), f->points, GL_STREAM_DRAW);
+        pb->slot_seq[s] = f->seq;
+        pb->slot_index[s] = f->index;
+        pb->slot_n[s] = f->n;
+        if (f->n) pb->bounds = pb->uploads ? bounds_merge(pb->bounds, f->bounds) : f->bounds;
+        if (f->seq == 0) pb->started = 1;
+        pb->uploads++;
+        free(f);
+    }
+    if (!pb->started) {
+        pthread_mutex_lock(&pb->lock);
+        int empty = pb->empty;
+        pthread_mutex_unlock(&pb->lock);
+        return empty ? -1 : 0;
+    }
+
+    // Frames arrive in order, so the newest one bounds the clock
+    long newest = 0;
+    for (int s = 0; s < PLAYBACK_SLOTS; s++)
+        if (pb->slot_seq[s] > newest) newest = pb->slot_seq[s];
+    pb->t += dt * pb->fps;
+    if (pb->t > newest) {
+        pb->stalled += (pb->t - newest) / pb->fps;
+        pb->t = newest;
+    }
+    return 1;
+}
+
+size_t playback_draw(Playback *pb, GLint blend_uniform) {
+    long k = (long)pb->t;
+    int a = slot_of(pb, k), b = slot_of(pb, k + 1);
+    if (a < 0) return 0;
+
+    glBindVertexArray(pb->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pb->vbos[a]);
+    glVertexAttribPointer(ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+    // Blend into the next timestep, except across the loop back to the
+    // start; points missing from either one aren't drawn meanwhile
+    size_t n = pb->slot_n[a];
+    float blend = 0.0f;
+    if (b >= 0 && pb->slot_index[b] == pb->slot_index[a] + 1) {
+        blend = (float)(pb->t - k);
+        if (pb->slot_n[b] < n) n = pb->slot_n[b];
+        glBindBuffer(GL_ARRAY_BUFFER, pb->vbos[b]);
+        glVertexAttribPointer(ATTR_NEXT, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(ATTR_NEXT);
+    } else {
+        glDisableVertexAttribArray(ATTR_NEXT);
+    }
+    glUniform1f(blend_uniform, blend);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)n);
+    glUniform1f(blend_uniform, 0.0f);
+    return n;
+}
+
+void playback_stop(Playback *pb) {
+    pthread_mutex_lock(&pb->lock);
+    pb->stop = 1;
+    pthread_cond_broadcast(&pb->cond);
+    pthread_mutex_unlock(&pb->lock);
+    pthread_join(pb->tid, NULL);
+    for (PlaybackFrame *f = pb->head, *next; f; f = next) {
+        next = f->next;
+        free(f);
+    }
+    pb->head = pb->tail = NULL;
+    pthread_mutex_destroy(&pb->lock);
+    pthread_cond_destroy(&pb->cond);
+    glDeleteBuffers(PLAYBACK_SLOTS, pb->vbos);
+    glDeleteVertexArrays(1, &pb->vao);
+}
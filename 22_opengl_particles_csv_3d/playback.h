@@ -0,0 +1,80 @@
+// Time-series playback: a sequence of point cloud timesteps, either one
+// CSV per timestep or one CSV with a frame column (--columns ...,frame).
+//
+// A loader thread parses timesteps ahead, at most PLAYBACK_AHEAD waiting
+// at a time, and the render thread uploads them into a ring of
+// PLAYBACK_SLOTS VBOs, so memory stays bounded however long the sequence
+// is. The clock advances at a fixed number of timesteps per second; the
+// shader blends point i of one timestep into point i of the next, and
+// the clock waits (counted as a stall) rather than skip a timestep that
+// isn't on the GPU yet. The sequence loops.
+
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <GL/glew.h>
+
+#include "csv_loader.h"
+
+#define PLAYBACK_SLOTS 4
+#define PLAYBACK_AHEAD 2
+
+typedef struct PlaybackFrame {
+    struct PlaybackFrame *next;
+    long seq;                // position in the looping sequence
+    int index;               // timestep
+    size_t n;
+    Bounds bounds;
+    Point points[];
+} PlaybackFrame;
+
+typedef struct {
+    const char **paths;
+    int path_count;
+    const Schema *schema;
+    int threads;
+    double fps;              // timesteps per second
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    // Guarded by lock
+    PlaybackFrame *head, *tail;
+    int queued;
+    int stop;
+    int empty;               // the loader found no timesteps and quit
+
+    // Render thread only
+    GLuint vao;
+    GLuint vbos[PLAYBACK_SLOTS];
+    long slot_seq[PLAYBACK_SLOTS];   // -1 when empty
+    int slot_index[PLAYBACK_SLOTS];
+    size_t slot_n[PLAYBACK_SLOTS];
+    double t;                // playback position, in seq units
+    double stalled;          // seconds the clock waited for a timestep
+    long uploads;
+    Bounds bounds;           // of every timestep uploaded so far
+    int started;             // first timestep is on the GPU
+} Playback;
+
+// Start loading; needs a current GL context for the ring. With one path
+// and a frame column in schema the file is split by frame (ascending,
+// rows keep their order); otherwise every path is one timestep. paths
+// and schema must outlive the playback.
+void playback_start(Playback *pb, const char **paths, int path_count,
+                    const Schema *schema, int threads, double fps);
+
+// Upload timesteps that arrived and advance the clock by dt seconds.
+// Returns 0 while there is nothing to draw yet, -1 if there never will
+// be (no row of the CSV had a frame value).
+int playback_update(Playback *pb, double dt);
+
+// Draw the current position with the point program bound, setting its
+// blend uniform. Returns the number of points drawn.
+size_t playback_draw(Playback *pb, GLint blend_uniform);
+
+void playback_stop(Playback *pb);
+
+#endif
@@ -0,0 +1,132 @@
+#include "point_attribs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct { const char *name; int role; } columns[] = {
+    { "x", COL_X }, { "y", COL_Y }, { "z", COL_Z },
+    { "intensity", COL_INTENSITY }, { "time", COL_TIME },
+    { "r", COL_R }, { "g", COL_G }, { "b", COL_B }, { "frame", COL_FRAME },
+    { "-", COL_SKIP },
+};
+
+int schema_parse(const char *spec, Schema *s) {
+    memset(s, 0, sizeof(*s));
+    unsigned seen = 0;
+    const char *p = spec;
+    for (;;) {
+        size_t len = strcspn(p, ",");
+        int role = -1;
+        for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++)
+            if (strlen(columns[i].name) == len && !strncmp(p, columns[i].name, len))
+                role = columns[i].role;
+        if (role < 0) {
+            fprintf(stderr, "--columns: unknown column '%.*s'\n", (int)len, p);
+            return 0;
+        }
+        if (s->count == SCHEMA_MAX_COLUMNS) {
+            fprintf(stderr, "--columns: at most %d columns\n", SCHEMA_MAX_COLUMNS);
+            return 0;
+        }
+        if (role != COL_SKIP && (seen & 1u << role)) {
+            fprintf(stderr, "--columns: '%.*s' given twice\n", (int)len, p);
+            return 0;
+        }
+        seen |= 1u << role;
+        s->role[s->count++] = (uint8_t)role;
+        if (!p[len]) break;
+        p += len + 1;
+    }
+    // Trailing skips read nothing
+    while (s->count && s->role[s->count - 1] == COL_SKIP)
+        s->count--;
+
+    unsigned xyz = 1u << COL_X | 1u << COL_Y | 1u << COL_Z;
+    unsigned rgb = 1u << COL_R | 1u << COL_G | 1u << COL_B;
+    if ((seen & xyz) != xyz) {
+        fprintf(stderr, "--columns: x, y and z are required\n");
+        return 0;
+    }
+    if ((seen & rgb) && (seen & rgb) != rgb) {
+        fprintf(stderr, "--columns: r, g and b go together\n");
+        return 0;
+    }
+    return 1;
+}
+
+void schema_default(Schema *s) {
+    memset(s, 0, sizeof(*s));
+    s->count = 3;
+    s->role[0] = COL_X;
+    s->role[1] = COL_Y;
+    s->role[2] = COL_Z;
+}
+
+int schema_is_default(const Schema *s) {
+    return s->count == 3 && s->role[0] == COL_X && s->role[1] == COL_Y && s->role[2] == COL_Z;
+}
+
+unsigned schema_attribs(const Schema *s) {
+    unsigned mask = 0;
+    for (int i = 0; i < s->count; i++) {
+        if (s->role[i] == COL_INTENSITY) mask |= ATTRIB_INTENSITY;
+        if (s->role[i] == COL_TIME) mask |= ATTRIB_TIME;
+        if (s->role[i] == COL_R) mask |= ATTRIB_RGB;
+        if (s->role[i] == COL_FRAME) mask |= ATTRIB_FRAME;
+    }
+    return mask;
+}
+
+size_t attribs_point_bytes(unsigned mask) {
+    return (mask & ATTRIB_INTENSITY ? sizeof(float) : 0) +
+           (mask & ATTRIB_TIME ? sizeof(float) : 0) +
+           (mask & ATTRIB_RGB ? 4 : 0) +
+           (mask & ATTRIB_FRAME ? sizeof(float) : 0);
+}
+
+static void *grow(void *p, size_t bytes) {
+    p = realloc(p, bytes ? bytes : 1);
+    if (!p) { perror("malloc"); exit(1); }
+    return p;
+}
+
+void attribs_reserve(PointAttribs *a, size_t n) {
+    if (a->mask & ATTRIB_INTENSITY) a->intensity = grow(a->intensity, n * sizeof(float));
+    if (a->mask & ATTRIB_TIME) a->time = grow(a->time, n * sizeof(float));
+    if (a->mask & ATTRIB_RGB) a->rgba = grow(a->rgba, n * 4);
+    if (a->mask & ATTRIB_FRAME) a->frame = grow(a->frame, n * sizeof(float));
+}
+
+void attribs_free(PointAttribs *a) {
+    free(a->intensity);
+    free(a->time);
+    free(a->rgba);
+    free(a->frame);
+    a->intensity = a->time = a->frame = NULL;
+    a->rgba = NULL;
+}
+
+void attribs_permute(PointAttribs *a, const uint32_t *order, size_t n) {
+    if (a->mask & (ATTRIB_INTENSITY | ATTRIB_TIME | ATTRIB_FRAME)) {
+        float *tmp = grow(NULL, n * sizeof(float));
+        float **arrays[3] = { &a->intensity, &a->time, &a->frame };
+        for (int k = 0; k < 3; k++) {
+            float *src = *arrays[k];
+            if (!src) continue;
+            for (size_t i = 0; i < n; i++)
+                tmp[i] = src[order[i]];
+            *arrays[k] = tmp;
+            tmp = src;
+        }
+        free(tmp);
+    }
+    if (a->mask & ATTRIB_RGB) {
+        uint32_t *src = (uint32_t *)a->rgba;
+        uint32_t *dst = grow(NULL, n * 4);
+        for (size_t i = 0; i < n; i++)
+            dst[i] = src[order[i]];
+        a->rgba = (uint8_t *)dst;
+        free(src);
+    }
+}
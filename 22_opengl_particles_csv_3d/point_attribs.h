@@ -0,0 +1,61 @@
+// Per-point attributes from extra CSV columns, kept as a structure of
+// arrays next to the xyz positions so each one can live in its own VBO.
+//
+// The column schema is given as a comma separated list naming each CSV
+// column in order: x, y, z (required), intensity, time, r, g, b (0-255),
+// frame (the timestep a row belongs to, for playback), or "-" to skip
+// one. Columns after the last named one are ignored.
+// "x,y,z" is the default and matches the plain loader.
+
+#ifndef POINT_ATTRIBS_H
+#define POINT_ATTRIBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCHEMA_MAX_COLUMNS 16
+
+enum {
+    COL_SKIP, COL_X, COL_Y, COL_Z, COL_INTENSITY, COL_TIME, COL_R, COL_G, COL_B, COL_FRAME
+};
+
+// Which attribute arrays a schema produces
+enum {
+    ATTRIB_INTENSITY = 1u << 0,
+    ATTRIB_TIME      = 1u << 1,
+    ATTRIB_RGB       = 1u << 2,
+    ATTRIB_FRAME     = 1u << 3,
+};
+
+typedef struct {
+    int count;                           // columns that are read
+    uint8_t role[SCHEMA_MAX_COLUMNS];    // COL_* per column
+} Schema;
+
+typedef struct {
+    unsigned mask;           // ATTRIB_* present
+    float *intensity;        // n floats
+    float *time;             // n floats
+    uint8_t *rgba;           // 4n bytes, alpha 255
+    float *frame;            // n floats
+    float intensity_range[2];
+    float time_range[2];
+} PointAttribs;
+
+// Parse a schema spec. Returns 1 on success, otherwise prints why.
+int schema_parse(const char *spec, Schema *s);
+void schema_default(Schema *s);
+int schema_is_default(const Schema *s);
+unsigned schema_attribs(const Schema *s);
+
+// Grow every array in a->mask to hold n points (contents kept)
+void attribs_reserve(PointAttribs *a, size_t n);
+void attribs_free(PointAttribs *a);
+
+// Reorder so that new[i] = old[order[i]]
+void attribs_permute(PointAttribs *a, const uint32_t *order, size_t n);
+
+// Bytes per point across all arrays in mask
+size_t attribs_point_bytes(unsigned mask);
+
+#endif
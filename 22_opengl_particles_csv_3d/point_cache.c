@@ -0,0 +1,238 @@
+#include "point_cache.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC     "PCACHE01"
+#define CACHE_VERSION   3
+#define CACHE_QUANTIZED 1u
+
+// On-disk header, native endianness. Padded so the payload is aligned.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;
+    uint64_t src_size;
+    int64_t src_mtime_sec;
+    int64_t src_mtime_nsec;
+    Bounds bounds;
+    uint64_t node_count;
+    uint32_t column_count;                 // schema the CSV was read with
+    uint8_t columns[SCHEMA_MAX_COLUMNS];
+    float intensity_range[2];
+    float time_range[2];
+    uint8_t reserved[12];
+} CacheHeader;
+
+_Static_assert(sizeof(CacheHeader) == 128, "cache header must stay 128 bytes");
+
+static void cache_path(const char *csv_path, char *out, size_t n) {
+    snprintf(out, n, "%s.pcache", csv_path);
+}
+
+// Attribute arrays follow the points and the nodes follow them, both
+// 8-byte aligned
+static size_t attribs_offset(size_t data_bytes) {
+    return (sizeof(CacheHeader) + data_bytes + 7) & ~(size_t)7;
+}
+
+static size_t nodes_offset(size_t data_bytes, size_t attrib_bytes) {
+    return (attribs_offset(data_bytes) + attrib_bytes + 7) & ~(size_t)7;
+}
+
+static void source_stamp(const struct stat *st, int64_t *sec, int64_t *nsec) {
+#ifdef __APPLE__
+    *sec = st->st_mtimespec.tv_sec;
+    *nsec = st->st_mtimespec.tv_nsec;
+#else
+    *sec = st->st_mtim.tv_sec;
+    *nsec = st->st_mtim.tv_nsec;
+#endif
+}
+
+void point_cache_dequant(const Bounds *b, float offset[3], float scale[3]) {
+    const float mn[3] = { b->minX, b->minY, b->minZ };
+    const float mx[3] = { b->maxX, b->maxY, b->maxZ };
+    for (int i = 0; i < 3; i++) {
+        scale[i] = (mx[i] - mn[i]) / 65535.0f;
+        offset[i] = mn[i] + 32768.0f * scale[i];
+    }
+}
+
+int point_cache_open(const char *csv_path, int quantized, const Schema *schema,
+                     PointCache *pc) {
+    memset(pc, 0, sizeof(*pc));
+    Schema want;
+    if (schema) want = *schema;
+    else schema_default(&want);
+
+    struct stat src;
+    if (stat(csv_path, &src) < 0) return 0;
+
+    char path[4096];
+    cache_path(csv_path, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(CacheHeader)) { close(fd); return 0; }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const CacheHeader *h = map;
+    int64_t sec, nsec;
+    source_stamp(&src, &sec, &nsec);
+    size_t elem = (h->flags & CACHE_QUANTIZED) ? 3 * sizeof(int16_t) : sizeof(Point);
+    unsigned mask = schema_attribs(&want);
+
+    // Counts from a damaged header must not wrap the offsets (16 bytes
+    // covers the two paddings)
+    int sizes_ok = h->count <= (SIZE_MAX - sizeof(CacheHeader) - 16) / (elem + attribs_point_bytes(mask));
+    size_t attr_off = sizes_ok ? attribs_offset(h->count * elem) : 0;
+    size_t node_off = sizes_ok ? nodes_offset(h->count * elem, h->count * attribs_point_bytes(mask)) : 0;
+    sizes_ok = sizes_ok && h->node_count <= (SIZE_MAX - node_off) / sizeof(OctreeNode);
+
+    const char *why = NULL;
+    if (memcmp(h->magic, CACHE_MAGIC, 8) || h->version != CACHE_VERSION)
+        why = "unknown format";
+    else if (h->src_size != (uint64_t)src.st_size || h->src_mtime_sec != sec || h->src_mtime_nsec != nsec)
+        why = "source changed";
+    else if (!!(h->flags & CACHE_QUANTIZED) != !!quantized)
+        why = "different quantization";
+    else if (h->column_count != (uint32_t)want.count || memcmp(h->columns, want.role, want.count))
+        why = "different columns";
+    else if (!sizes_ok)
+        why = "bad counts";
+    else if ((size_t)st.st_size != node_off + h->node_count * sizeof(OctreeNode))
+        why = "truncated";
+
+    if (why) {
+        fprintf(stderr, "Ignoring cache %s: %s\n", path, why);
+        munmap(map, st.st_size);
+        return 0;
+    }
+
+    pc->bounds = h->bounds;
+    pc->count = h->count;
+    pc->quantized = quantized;
+    pc->data = (const char *)map + sizeof(CacheHeader);
+    pc->data_bytes = h->count * elem;
+    pc->attribs.mask = mask;
+    pc->attribs.intensity_range[0] = h->intensity_range[0];
+    pc->attribs.intensity_range[1] = h->intensity_range[1];
+    pc->attribs.time_range[0] = h->time_range[0];
+    pc->attribs.time_range[1] = h->time_range[1];
+    char *a = (char *)map + attr_off;
+    if (mask & ATTRIB_INTENSITY) { pc->attribs.intensity = (float *)a; a += h->count * sizeof(float); }
+    if (mask & ATTRIB_TIME) { pc->attribs.time = (float *)a; a += h->count * sizeof(float); }
+    if (mask & ATTRIB_RGB) { pc->attribs.rgba = (uint8_t *)a; a += h->count * 4; }
+    if (mask & ATTRIB_FRAME) pc->attribs.frame = (float *)a;
+    pc->nodes = (const OctreeNode *)((const char *)map + node_off);
+    pc->node_count = h->node_count;
+    pc->map = map;
+    pc->map_size = st.st_size;
+    return 1;
+}
+
+int point_cache_write(const char *csv_path, const Point *points, size_t count,
+                      Bounds bounds, const OctreeNode *nodes, size_t node_count,
+                      const Schema *schema, const PointAttribs *attribs,
+                      int quantize) {
+    struct stat src;
+    if (stat(csv_path, &src) < 0) return 0;
+
+    char path[4096], tmp[4096 + 8];
+    cache_path(csv_path, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    CacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, 8);
+    h.version = CACHE_VERSION;
+    h.flags = quantize ? CACHE_QUANTIZED : 0;
+    h.count = count;
+    h.src_size = src.st_size;
+    source_stamp(&src, &h.src_mtime_sec, &h.src_mtime_nsec);
+    h.bounds = bounds;
+    h.node_count = node_count;
+    Schema sch;
+    if (schema) sch = *schema;
+    else schema_default(&sch);
+    h.column_count = (uint32_t)sch.count;
+    memcpy(h.columns, sch.role, sch.count);
+    unsigned mask = schema_attribs(&sch);
+    if (mask) {
+        memcpy(h.intensity_range, attribs->intensity_range, sizeof(h.intensity_range));
+        memcpy(h.time_range, attribs->time_range, sizeof(h.time_range));
+    }
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) { perror("write cache"); return 0; }
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+    if (!quantize) {
+        ok = ok && fwrite(points, sizeof(Point), count, f) == count;
+    } else {
+        // Map [min, max] onto [-32768, 32767] per axis, in blocks
+        const float mn[3] = { bounds.minX, bounds.minY, bounds.minZ };
+        const float mx[3] = { bounds.maxX, bounds.maxY, bounds.maxZ };
+        float inv[3];
+        for (int i = 0; i < 3; i++)
+            inv[i] = mx[i] > mn[i] ? 65535.0f / (mx[i] - mn[i]) : 0.0f;
+
+        enum { BLOCK = 4096 };
+        int16_t buf[BLOCK * 3];
+        for (size_t i = 0; ok && i < count; i += BLOCK) {
+            size_t n = count - i < BLOCK ? count - i : BLOCK;
+            for (size_t j = 0; j < n; j++) {
+                const float *v = &points[i + j].x;
+                for (int k = 0; k < 3; k++) {
+                    long q = lrintf((v[k] - mn[k]) * inv[k]) - 32768;
+                    buf[j * 3 + k] = (int16_t)(q < -32768 ? -32768 : q > 32767 ? 32767 : q);
+                }
+            }
+            ok = fwrite(buf, 3 * sizeof(int16_t), n, f) == n;
+        }
+    }
+
+    size_t data_bytes = count * (quantize ? 3 * sizeof(int16_t) : sizeof(Point));
+    static const char pad[8];
+    size_t pad_bytes = attribs_offset(data_bytes) - sizeof(CacheHeader) - data_bytes;
+    ok = ok && fwrite(pad, 1, pad_bytes, f) == pad_bytes;
+    if (mask & ATTRIB_INTENSITY)
+        ok = ok && fwrite(attribs->intensity, sizeof(float), count, f) == count;
+    if (mask & ATTRIB_TIME)
+        ok = ok && fwrite(attribs->time, sizeof(float), count, f) == count;
+    if (mask & ATTRIB_RGB)
+        ok = ok && fwrite(attribs->rgba, 4, count, f) == count;
+    if (mask & ATTRIB_FRAME)
+        ok = ok && fwrite(attribs->frame, sizeof(float), count, f) == count;
+    size_t attrib_bytes = count * attribs_point_bytes(mask);
+    pad_bytes = nodes_offset(data_bytes, attrib_bytes) - attribs_offset(data_bytes) - attrib_bytes;
+    ok = ok && fwrite(pad, 1, pad_bytes, f) == pad_bytes;
+    ok = ok && fwrite(nodes, sizeof(OctreeNode), node_count, f) == node_count;
+
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, path) < 0) {
+        perror("write cache");
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+void point_cache_close(PointCache *pc) {
+    if (pc->map)
+        munmap(pc->map, pc->map_size);
+    memset(pc, 0, sizeof(*pc));
+}
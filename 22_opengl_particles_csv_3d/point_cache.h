@@ -0,0 +1,54 @@
+// Binary sidecar cache for parsed point clouds: data.csv -> data.csv.pcache
+//
+// Layout: a 128-byte header (count, bounds, column schema, attribute
+// ranges, and the size and mtime of the CSV it was built from), then
+// count packed xyz triples, either float32 or int16 quantized to the
+// bounds, in octree order, then one array per attribute in the schema
+// (intensity, time, rgba, frame; 8-byte aligned), then the octree nodes
+// (8-byte aligned). The file is mmap'd and the payload handed to
+// glBufferData as is, so a cached launch does no parsing and no octree
+// build.
+
+#ifndef POINT_CACHE_H
+#define POINT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "csv_loader.h"
+#include "octree.h"
+
+typedef struct {
+    Bounds bounds;
+    size_t count;
+    int quantized;           // payload is int16 xyz instead of float xyz
+    const void *data;        // payload, inside the mapping
+    size_t data_bytes;
+    PointAttribs attribs;    // arrays inside the mapping, read only
+    const OctreeNode *nodes; // also inside the mapping
+    size_t node_count;
+    void *map;
+    size_t map_size;
+} PointCache;
+
+// Map the sidecar of csv_path if it exists, matches the CSV's current
+// size and mtime, and has the requested quantization and schema (NULL
+// for x,y,z). Returns 1 on success.
+int point_cache_open(const char *csv_path, int quantized, const Schema *schema,
+                     PointCache *pc);
+
+// Write the sidecar for csv_path (via a temporary file and rename).
+// points and attribs (NULL if schema has no attributes) must already be
+// in the order octree_build() left the points in.
+// Returns 1 on success; failures are reported but not fatal.
+int point_cache_write(const char *csv_path, const Point *points, size_t count,
+                      Bounds bounds, const OctreeNode *nodes, size_t node_count,
+                      const Schema *schema, const PointAttribs *attribs,
+                      int quantize);
+
+void point_cache_close(PointCache *pc);
+
+// Quantized values decode as v = offset + q * scale, per axis
+void point_cache_dequant(const Bounds *b, float offset[3], float scale[3]);
+
+#endif
@@ -0,0 +1,115 @@
+#include "shaders.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *vertex_src =
+    "#version 150\n"
+    "uniform mat4 u_mvp;\n"
+    "uniform vec3 u_offset;\n"
+    "uniform vec3 u_scale;\n"
+    "uniform int u_color_by;\n"
+    "uniform vec2 u_ramp;\n"
+    "uniform vec2 u_time_window;\n"
+    "uniform float u_blend;\n"
+    "uniform float u_size_scale;\n"
+    "in vec3 a_position;\n"
+    "in vec3 a_next;\n"
+    "in vec4 a_color;\n"
+    "in float a_size;\n"
+    "in float a_intensity;\n"
+    "in float a_time;\n"
+    "out vec4 v_color;\n"
+    "vec3 ramp(float t) {\n"
+    "    return clamp(vec3(1.5) - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);\n"
+    "}\n"
+    "void main() {\n"
+    "    if (a_time < u_time_window.x || a_time > u_time_window.y) {\n"
+    "        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);   // clipped\n"
+    "        gl_PointSize = 1.0;\n"
+    "        v_color = vec4(0.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec3 p = mix(a_position, a_next, u_blend);\n"
+    "    gl_Position = u_mvp * vec4(u_offset + p * u_scale, 1.0);\n"
+    "    gl_PointSize = u_size_scale > 0.0 ? clamp(u_size_scale / gl_Position.w, 1.0, a_size) : a_size;\n"
+    "    v_color = a_color;\n"
+    "    if (u_color_by != 0) {\n"
+    "        float v = u_color_by == 1 ? a_intensity : a_time;\n"
+    "        float span = u_ramp.y - u_ramp.x;\n"
+    "        float t = span > 0.0 ? clamp((v - u_ramp.x) / span, 0.0, 1.0) : 0.5;\n"
+    "        v_color = vec4(ramp(t), a_color.a);\n"
+    "    }\n"
+    "}\n";
+
+// Replaces GL_POINT_SMOOTH, which core profile doesn't have
+static const char *fragment_src =
+    "#version 150\n"
+    "uniform int u_round;\n"
+    "in vec4 v_color;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "    if (u_round != 0) {\n"
+    "        vec2 d = gl_PointCoord * 2.0 - 1.0;\n"
+    "        if (dot(d, d) > 1.0) discard;\n"
+    "    }\n"
+    "    frag_color = v_color;\n"
+    "}\n";
+
+static GLuint compile(GLenum type, const char *src) {
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 1, &src, NULL);
+    glCompileShader(s);
+    GLint ok;
+    glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[4096];
+        glGetShaderInfoLog(s, sizeof(log), NULL, log);
+        fprintf(stderr, "%s shader: %s\n", type == GL_VERTEX_SHADER ? "Vertex" : "Fragment", log);
+        exit(1);
+    }
+    return s;
+}
+
+void point_program_create(PointProgram *p) {
+    GLuint vs = compile(GL_VERTEX_SHADER, vertex_src);
+    GLuint fs = compile(GL_FRAGMENT_SHADER, fragment_src);
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    glBindAttribLocation(prog, ATTR_POSITION, "a_position");
+    glBindAttribLocation(prog, ATTR_COLOR, "a_color");
+    glBindAttribLocation(prog, ATTR_SIZE, "a_size");
+    glBindAttribLocation(prog, ATTR_INTENSITY, "a_intensity");
+    glBindAttribLocation(prog, ATTR_TIME, "a_time");
+    glBindAttribLocation(prog, ATTR_NEXT, "a_next");
+    glBindFragDataLocation(prog, 0, "frag_color");
+    glLinkProgram(prog);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[4096];
+        glGetProgramInfoLog(prog, sizeof(log), NULL, log);
+        fprintf(stderr, "Shader link: %s\n", log);
+        exit(1);
+    }
+
+    p->program = prog;
+    p->mvp = glGetUniformLocation(prog, "u_mvp");
+    p->offset = glGetUniformLocation(prog, "u_offset");
+    p->scale = glGetUniformLocation(prog, "u_scale");
+    p->round = glGetUniformLocation(prog, "u_round");
+    p->color_by = glGetUniformLocation(prog, "u_color_by");
+    p->ramp = glGetUniformLocation(prog, "u_ramp");
+    p->time_window = glGetUniformLocation(prog, "u_time_window");
+    p->blend = glGetUniformLocation(prog, "u_blend");
+    p->size_scale = glGetUniformLocation(prog, "u_size_scale");
+}
+
+void point_program_destroy(PointProgram *p) {
+    glDeleteProgram(p->program);
+    p->program = 0;
+}
@@ -0,0 +1,52 @@
+// GLSL program for the viewer (OpenGL 3.2 core, GLSL 1.50).
+//
+// One program draws both the points and the bounding box lines. Vertex
+// attributes:
+//   0  position (float xyz, or int16 xyz decoded with u_offset/u_scale)
+//   1  color     (vec4, per point when an array is bound)
+//   2  size      (float, largest point size in pixels, ditto)
+//   3  intensity (float, ditto)
+//   4  time      (float, ditto)
+//   5  next      (position at the next timestep, blended in by u_blend)
+// Everything but the position falls back to the current generic
+// attribute value when no array is bound, so per-point data only needs a
+// VBO and a glEnableVertexAttribArray.
+//
+// Points whose time is outside u_time_window are clipped, and u_color_by
+// replaces the colour with a blue-to-red ramp of intensity or time over
+// u_ramp, so both change with a uniform rather than a re-upload.
+//
+// With u_size_scale > 0 points shrink with distance, to u_size_scale / w
+// pixels (w being the distance along the view axis), so far away dense
+// regions don't overdraw; otherwise they are always a_size pixels.
+
+#ifndef SHADERS_H
+#define SHADERS_H
+
+#include <GL/glew.h>
+
+enum {
+    ATTR_POSITION = 0, ATTR_COLOR = 1, ATTR_SIZE = 2,
+    ATTR_INTENSITY = 3, ATTR_TIME = 4, ATTR_NEXT = 5
+};
+
+enum { COLOR_BY_RGB = 0, COLOR_BY_INTENSITY = 1, COLOR_BY_TIME = 2 };
+
+typedef struct {
+    GLuint program;
+    GLint mvp;       // mat4
+    GLint offset;    // vec3, position = offset + a_position * scale
+    GLint scale;     // vec3
+    GLint round;     // int, 1 = discard outside a disc (points only)
+    GLint color_by;  // int, COLOR_BY_*
+    GLint ramp;      // vec2, value range mapped onto the colour ramp
+    GLint time_window;  // vec2, inclusive; others are clipped
+    GLint blend;     // float, position = mix(a_position, a_next, blend)
+    GLint size_scale;   // float, point size in pixels times distance
+} PointProgram;
+
+// Compile and link; exits with the info log on failure
+void point_program_create(PointProgram *p);
+void point_program_destroy(PointProgram *p);
+
+#endif
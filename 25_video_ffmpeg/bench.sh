@@ -0,0 +1,52 @@
+#!/bin/sh
+# Encode the same fixed corpus with a range of encoder settings and print
+# one CSV row per run: settings, frames, seconds, fps, output bytes.
+#
+# The corpus is generated with ffmpeg's testsrc2 source so it is identical
+# on every machine and every run.
+#
+# Usage: ./bench.sh ./slideshow_h264
+
+set -e
+
+BIN=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+CORPUS=bench_corpus
+NUM_IMAGES=8
+OUT=/tmp/slideshow_bench.mp4
+
+if [ ! -d $CORPUS ]; then
+    mkdir -p $CORPUS
+    i=0
+    while [ $i -lt $NUM_IMAGES ]; do
+        ffmpeg -loglevel error -f lavfi -i testsrc2=size=640x480:rate=1 \
+            -ss $i -frames:v 1 $CORPUS/img_$i.png
+        i=$((i + 1))
+    done
+fi
+
+run() {
+    label="$1"; shift
+    line=$(cd $CORPUS && "$BIN" -o $OUT "$@" | grep '^frames=')
+    frames=$(echo "$line" | sed 's/.*frames=\([0-9]*\).*/\1/')
+    secs=$(echo "$line" | sed 's/.*time=\([0-9.]*\)s.*/\1/')
+    fps=$(echo "$line" | sed 's/.*fps=\([0-9.]*\).*/\1/')
+    size=$(echo "$line" | sed 's/.*size=\([0-9]*\).*/\1/')
+    echo "$label,$frames,$secs,$fps,$size"
+}
+
+echo "settings,frames,seconds,fps,bytes"
+run "default"
+run "threads=1"                  --threads 1
+run "threads=auto,frame"         --thread-type frame
+run "threads=auto,slice"         --thread-type slice
+run "ultrafast"                  --preset ultrafast
+run "veryfast,stillimage"        --preset veryfast --tune stillimage
+run "medium,stillimage,crf=28"   --preset medium --tune stillimage --crf 28
+run "slow,stillimage,crf=23"     --preset slow --tune stillimage --crf 23
+run "veryfast,1000kbps"          --preset veryfast --bitrate 1000
+run "veryfast,segments=2"        --preset veryfast --segments 2
+run "veryfast,segments=4"        --preset veryfast --segments 4
+run "veryfast,crossfade"         --preset veryfast --transition crossfade
+run "veryfast,kenburns"          --preset veryfast --transition kenburns
+
+rm -f $OUT
@@ -0,0 +1,266 @@
+#include "blend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BLEND_X86 1
+#include <immintrin.h>
+#endif
+
+enum { IMPL_SCALAR, IMPL_SSE2, IMPL_AVX2 };
+static int impl = -1;
+
+// Pick the widest path the CPU supports. BLEND_IMPL=scalar|sse2|avx2 in the
+// environment forces one, to compare paths against each other.
+static int detect_impl(void) {
+    if (impl >= 0) return impl;
+    int best = IMPL_SCALAR;
+#ifdef BLEND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) best = IMPL_AVX2;
+    else if (__builtin_cpu_supports("sse2")) best = IMPL_SSE2;
+#endif
+    const char *force = getenv("BLEND_IMPL");
+    if (force && !strcmp(force, "scalar")) best = IMPL_SCALAR;
+    else if (force && !strcmp(force, "sse2") && best >= IMPL_SSE2) best = IMPL_SSE2;
+    impl = best;
+    return impl;
+}
+
+const char *blend_impl_name(void) {
+    switch (detect_impl()) {
+    case IMPL_AVX2: return "avx2";
+    case IMPL_SSE2: return "sse2";
+    default:        return "scalar";
+    }
+}
+
+// ------------------------------------------------------------
+// Crossfade
+// ------------------------------------------------------------
+
+static void blend_row_scalar(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                             int x, int width, int alpha) {
+    int inv = 256 - alpha;
+    for (; x < width; x++)
+        dst[x] = (uint8_t)((a[x] * inv + b[x] * alpha + 128) >> 8);
+}
+
+#ifdef BLEND_X86
+__attribute__((target("sse2")))
+static int blend_row_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                          int width, int alpha) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16((short)(256 - alpha));
+    const __m128i vb = _mm_set1_epi16((short)alpha);
+    const __m128i round = _mm_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i pa = _mm_loadu_si128((const __m128i *)(a + x));
+        __m128i pb = _mm_loadu_si128((const __m128i *)(b + x));
+        // a*inv + b*alpha <= 255*256, so 16-bit unsigned lanes don't overflow
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pa, zero), va),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(pb, zero), vb));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pa, zero), va),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(pb, zero), vb));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int blend_row_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                          int width, int alpha) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i va = _mm256_set1_epi16((short)(256 - alpha));
+    const __m256i vb = _mm256_set1_epi16((short)alpha);
+    const __m256i round = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i pa = _mm256_loadu_si256((const __m256i *)(a + x));
+        __m256i pb = _mm256_loadu_si256((const __m256i *)(b + x));
+        // unpack and pack both work per 128-bit lane, so byte order survives
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pa, zero), va),
+                                      _mm256_mullo_epi16(_mm256_unpacklo_epi8(pb, zero), vb));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pa, zero), va),
+                                      _mm256_mullo_epi16(_mm256_unpackhi_epi8(pb, zero), vb));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    return x;
+}
+#endif
+
+void blend_plane(uint8_t *dst, int dst_stride,
+                 const uint8_t *a, int a_stride,
+                 const uint8_t *b, int b_stride,
+                 int width, int height, int alpha) {
+    int which = detect_impl();
+    for (int y = 0; y < height; y++) {
+        uint8_t *d = dst + (size_t)y * dst_stride;
+        const uint8_t *ra = a + (size_t)y * a_stride;
+        const uint8_t *rb = b + (size_t)y * b_stride;
+        int x = 0;
+#ifdef BLEND_X86
+        if (which == IMPL_AVX2) x = blend_row_avx2(d, ra, rb, width, alpha);
+        else if (which == IMPL_SSE2) x = blend_row_sse2(d, ra, rb, width, alpha);
+#else
+        (void)which;
+#endif
+        blend_row_scalar(d, ra, rb, x, width, alpha);
+    }
+}
+
+// ------------------------------------------------------------
+// Pan/zoom
+//
+// Coordinates are 16.16 fixed point and weights are 8-bit. The bilinear
+// filter rounds after the horizontal and again after the vertical pass,
+// so every step fits 16-bit lanes and all paths agree exactly. On the
+// last column the right-hand tap lies past the row but has weight 0.
+// ------------------------------------------------------------
+
+typedef struct {
+    const uint8_t *row0, *row1;
+    int fy;
+    int32_t x_start, x_step, x_max;
+} ZoomRow;
+
+static inline int32_t clamp_fx(int32_t v, int32_t max) {
+    return v < 0 ? 0 : v > max ? max : v;
+}
+
+static inline uint8_t bilerp(int p00, int p01, int p10, int p11, int fx, int fy) {
+    int top = (p00 * (256 - fx) + p01 * fx + 128) >> 8;
+    int bot = (p10 * (256 - fx) + p11 * fx + 128) >> 8;
+    return (uint8_t)((top * (256 - fy) + bot * fy + 128) >> 8);
+}
+
+static void zoom_row_scalar(uint8_t *dst, const ZoomRow *r, int x, int width) {
+    for (; x < width; x++) {
+        int32_t sx = clamp_fx(r->x_start + x * r->x_step, r->x_max);
+        int x0 = sx >> 16, fx = (sx >> 8) & 0xFF;
+        dst[x] = bilerp(r->row0[x0], r->row0[x0 + 1], r->row1[x0], r->row1[x0 + 1], fx, r->fy);
+    }
+}
+
+#ifdef BLEND_X86
+// SSE2 has no gather, so the taps are fetched with scalar loads and only
+// the filter arithmetic runs 8 lanes wide.
+__attribute__((target("sse2")))
+static int zoom_row_sse2(uint8_t *dst, const ZoomRow *r, int width) {
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i k256 = _mm_set1_epi16(256);
+    const __m128i vfy = _mm_set1_epi16((short)r->fy);
+    const __m128i vify = _mm_set1_epi16((short)(256 - r->fy));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint16_t p00[8], p01[8], p10[8], p11[8], fx[8];
+        for (int i = 0; i < 8; i++) {
+            int32_t sx = clamp_fx(r->x_start + (x + i) * r->x_step, r->x_max);
+            int x0 = sx >> 16;
+            fx[i] = (sx >> 8) & 0xFF;
+            p00[i] = r->row0[x0]; p01[i] = r->row0[x0 + 1];
+            p10[i] = r->row1[x0]; p11[i] = r->row1[x0 + 1];
+        }
+        __m128i vfx = _mm_loadu_si128((const __m128i *)fx);
+        __m128i vifx = _mm_sub_epi16(k256, vfx);
+        __m128i top = _mm_add_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i *)p00), vifx),
+                                    _mm_mullo_epi16(_mm_loadu_si128((const __m128i *)p01), vfx));
+        __m128i bot = _mm_add_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i *)p10), vifx),
+                                    _mm_mullo_epi16(_mm_loadu_si128((const __m128i *)p11), vfx));
+        top = _mm_srli_epi16(_mm_add_epi16(top, round), 8);
+        bot = _mm_srli_epi16(_mm_add_epi16(bot, round), 8);
+        __m128i v = _mm_add_epi16(_mm_mullo_epi16(top, vify), _mm_mullo_epi16(bot, vfy));
+        v = _mm_srli_epi16(_mm_add_epi16(v, round), 8);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(v, v));
+    }
+    return x;
+}
+
+// One 32-bit gather at byte offset x0 fetches both horizontal taps
+// (bytes 0 and 1), which is why the source must be readable past the row.
+__attribute__((target("avx2")))
+static int zoom_row_avx2(uint8_t *dst, const ZoomRow *r, int width) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i vstep = _mm256_set1_epi32(r->x_step);
+    const __m256i vmax = _mm256_set1_epi32(r->x_max);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i byte = _mm256_set1_epi32(0xFF);
+    const __m256i k256 = _mm256_set1_epi32(256);
+    const __m256i round = _mm256_set1_epi32(128);
+    const __m256i vfy = _mm256_set1_epi32(r->fy);
+    const __m256i vify = _mm256_set1_epi32(256 - r->fy);
+    const __m256i order = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i sx = _mm256_add_epi32(_mm256_set1_epi32(r->x_start + x * r->x_step),
+                                      _mm256_mullo_epi32(lanes, vstep));
+        sx = _mm256_min_epi32(_mm256_max_epi32(sx, zero), vmax);
+        __m256i x0 = _mm256_srai_epi32(sx, 16);
+        __m256i fx = _mm256_and_si256(_mm256_srli_epi32(sx, 8), byte);
+        __m256i ifx = _mm256_sub_epi32(k256, fx);
+
+        __m256i g0 = _mm256_i32gather_epi32((const int *)r->row0, x0, 1);
+        __m256i g1 = _mm256_i32gather_epi32((const int *)r->row1, x0, 1);
+
+        __m256i top = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(g0, byte), ifx),
+                                       _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(g0, 8), byte), fx));
+        __m256i bot = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(g1, byte), ifx),
+                                       _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(g1, 8), byte), fx));
+        top = _mm256_srli_epi32(_mm256_add_epi32(top, round), 8);
+        bot = _mm256_srli_epi32(_mm256_add_epi32(bot, round), 8);
+        __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(top, vify), _mm256_mullo_epi32(bot, vfy));
+        v = _mm256_srli_epi32(_mm256_add_epi32(v, round), 8);
+
+        // 8 x int32 -> 8 bytes: the packs work per lane, so gather the low
+        // dword of each lane into the bottom 64 bits afterwards
+        v = _mm256_packus_epi32(v, v);
+        v = _mm256_packus_epi16(v, v);
+        v = _mm256_permutevar8x32_epi32(v, order);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm256_castsi256_si128(v));
+    }
+    return x;
+}
+#endif
+
+void zoom_plane(uint8_t *dst, int dst_stride,
+                const uint8_t *src, int src_stride,
+                int width, int height,
+                float scale, float tx, float ty) {
+    if (width < 2 || height < 2) {
+        for (int y = 0; y < height; y++)
+            memcpy(dst + (size_t)y * dst_stride, src + (size_t)y * src_stride, width);
+        return;
+    }
+
+    int which = detect_impl();
+    int32_t step = (int32_t)(scale * 65536.0f + 0.5f);
+    int32_t y_max = (height - 1) << 16;
+
+    ZoomRow r;
+    r.x_start = (int32_t)(tx * 65536.0f);
+    r.x_step = step;
+    r.x_max = (width - 1) << 16;
+
+    for (int y = 0; y < height; y++) {
+        int32_t sy = clamp_fx((int32_t)(ty * 65536.0f) + y * step, y_max);
+        r.row0 = src + (size_t)(sy >> 16) * src_stride;
+        r.row1 = (sy >> 16) < height - 1 ? r.row0 + src_stride : r.row0;
+        r.fy = (sy >> 8) & 0xFF;
+
+        uint8_t *d = dst + (size_t)y * dst_stride;
+        int x = 0;
+#ifdef BLEND_X86
+        if (which == IMPL_AVX2) x = zoom_row_avx2(d, &r, width);
+        else if (which == IMPL_SSE2) x = zoom_row_sse2(d, &r, width);
+#else
+        (void)which;
+#endif
+        zoom_row_scalar(d, &r, x, width);
+    }
+}
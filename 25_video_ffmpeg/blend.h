@@ -0,0 +1,31 @@
+// Pixel kernels for slideshow transitions, one 8-bit plane at a time.
+// Used on each of the Y, U and V planes of a YUV420P frame.
+//
+// Every kernel has a scalar version and, on x86, SSE2 and AVX2 versions
+// chosen at runtime. All versions use the same integer math, so their
+// output is bit-identical.
+
+#ifndef BLEND_H
+#define BLEND_H
+
+#include <stdint.h>
+
+// dst = (a * (256 - alpha) + b * alpha + 128) >> 8, alpha in [0, 256]
+void blend_plane(uint8_t *dst, int dst_stride,
+                 const uint8_t *a, int a_stride,
+                 const uint8_t *b, int b_stride,
+                 int width, int height, int alpha);
+
+// Pan/zoom resample: dst(x, y) = src(tx + x * scale, ty + y * scale),
+// bilinear, with coordinates clamped to the source plane. scale < 1
+// zooms in. The source is read up to 3 bytes past the end of each row,
+// which frames from av_frame_get_buffer() allow for.
+void zoom_plane(uint8_t *dst, int dst_stride,
+                const uint8_t *src, int src_stride,
+                int width, int height,
+                float scale, float tx, float ty);
+
+// Name of the code path in use ("avx2", "sse2" or "scalar")
+const char *blend_impl_name(void);
+
+#endif
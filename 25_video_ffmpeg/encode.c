@@ -0,0 +1,106 @@
+#include "encode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void check(int ret, const char *msg) {
+    if (ret < 0) {
+        char buf[1024];
+        av_strerror(ret, buf, sizeof(buf));
+        fprintf(stderr, "%s: %s\n", msg, buf);
+        exit(1);
+    }
+}
+
+void pipeline_open(EncodePipeline *p, const char *path, const char *format) {
+    *p = (EncodePipeline){ .path = path };
+    int ret = avformat_alloc_output_context2(&p->fmt_ctx, NULL, format, path);
+    check(ret, "avformat_alloc_output_context2");
+    p->pkt = av_packet_alloc();
+    if (!p->pkt) { fprintf(stderr, "Could not allocate packet\n"); exit(1); }
+}
+
+int pipeline_wants_global_header(const EncodePipeline *p) {
+    return (p->fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER) != 0;
+}
+
+void pipeline_start(EncodePipeline *p, AVCodecContext *codec_ctx) {
+    p->codec_ctx = codec_ctx;
+
+    p->stream = avformat_new_stream(p->fmt_ctx, NULL);
+    if (!p->stream) { fprintf(stderr, "Could not create stream\n"); exit(1); }
+
+    int ret = avcodec_parameters_from_context(p->stream->codecpar, codec_ctx);
+    check(ret, "avcodec_parameters_from_context");
+    p->stream->time_base = codec_ctx->time_base;
+
+    if (!(p->fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&p->fmt_ctx->pb, p->path, AVIO_FLAG_WRITE);
+        check(ret, "avio_open");
+    }
+
+    // The muxer may pick its own stream time base here; packets are
+    // rescaled to it on the way out.
+    ret = avformat_write_header(p->fmt_ctx, NULL);
+    check(ret, "avformat_write_header");
+}
+
+void pipeline_write_packet(EncodePipeline *p, AVPacket *pkt) {
+    av_packet_rescale_ts(pkt, p->codec_ctx->time_base, p->stream->time_base);
+    pkt->stream_index = p->stream->index;
+    int ret = av_interleaved_write_frame(p->fmt_ctx, pkt);
+    check(ret, "av_interleaved_write_frame");
+    p->packets++;
+}
+
+void pipeline_encode_intra(EncodePipeline *p, const AVFrame *frame, AVPacket *out) {
+    int ret = avcodec_send_frame(p->codec_ctx, frame);
+    check(ret, "avcodec_send_frame");
+    ret = avcodec_receive_packet(p->codec_ctx, out);
+    if (ret == AVERROR(EAGAIN)) {
+        fprintf(stderr, "%s delays output; its packets cannot be repeated\n",
+                p->codec_ctx->codec->name);
+        exit(1);
+    }
+    check(ret, "avcodec_receive_packet");
+}
+
+// Receive until the encoder has nothing more for now (EAGAIN) or ever (EOF)
+static void drain(EncodePipeline *p) {
+    int ret;
+    while ((ret = avcodec_receive_packet(p->codec_ctx, p->pkt)) >= 0) {
+        pipeline_write_packet(p, p->pkt);
+        av_packet_unref(p->pkt);
+    }
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        check(ret, "avcodec_receive_packet");
+}
+
+void pipeline_send(EncodePipeline *p, const AVFrame *frame) {
+    int ret = avcodec_send_frame(p->codec_ctx, frame);
+    if (ret == AVERROR(EAGAIN)) {
+        drain(p);
+        ret = avcodec_send_frame(p->codec_ctx, frame);
+    }
+    check(ret, "avcodec_send_frame");
+    drain(p);
+}
+
+int64_t pipeline_finish(EncodePipeline *p) {
+    pipeline_send(p, NULL);
+
+    int ret = av_write_trailer(p->fmt_ctx);
+    check(ret, "av_write_trailer");
+    return p->fmt_ctx->pb ? avio_size(p->fmt_ctx->pb) : 0;
+}
+
+void pipeline_free(EncodePipeline *p) {
+    avcodec_free_context(&p->codec_ctx);
+    av_packet_free(&p->pkt);
+    if (p->fmt_ctx) {
+        if (!(p->fmt_ctx->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&p->fmt_ctx->pb);
+        avformat_free_context(p->fmt_ctx);
+        p->fmt_ctx = NULL;
+    }
+}
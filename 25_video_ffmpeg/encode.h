@@ -0,0 +1,60 @@
+// Encode-and-mux pipeline shared by main.c and slideshow.c.
+//
+// Usage:
+//   EncodePipeline p;
+//   pipeline_open(&p, "out.mp4", NULL);
+//   ... set up the codec context, adding AV_CODEC_FLAG_GLOBAL_HEADER
+//       if pipeline_wants_global_header(&p), then avcodec_open2() ...
+//   pipeline_start(&p, codec_ctx);
+//   for each frame: pipeline_send(&p, frame);
+//   size = pipeline_finish(&p);
+//   pipeline_free(&p);
+
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+typedef struct {
+    AVFormatContext *fmt_ctx;
+    AVCodecContext *codec_ctx;   // owned once pipeline_start() is called
+    AVStream *stream;
+    AVPacket *pkt;
+    const char *path;
+    int64_t packets;             // packets written so far
+} EncodePipeline;
+
+// Log an FFmpeg error and exit if ret < 0
+void check(int ret, const char *msg);
+
+// Allocate the output container. format may be NULL to guess from path.
+void pipeline_open(EncodePipeline *p, const char *path, const char *format);
+
+// Whether the container wants codec headers out of band
+int pipeline_wants_global_header(const EncodePipeline *p);
+
+// Add the stream for an opened encoder, copy its parameters and write
+// the container header
+void pipeline_start(EncodePipeline *p, AVCodecContext *codec_ctx);
+
+// Send one frame and write every packet the encoder has ready. If the
+// encoder refuses input because its output is full, drain it and retry.
+void pipeline_send(EncodePipeline *p, const AVFrame *frame);
+
+// Encode one frame with an intra-only, zero-delay encoder and return its
+// packet in out (the caller unrefs it) instead of writing it. Lets a still
+// be encoded once and its packet written for many frames.
+void pipeline_encode_intra(EncodePipeline *p, const AVFrame *frame, AVPacket *out);
+
+// Write an already encoded packet (pts in the codec time base). The
+// muxer takes the packet's reference; pkt is left blank.
+void pipeline_write_packet(EncodePipeline *p, AVPacket *pkt);
+
+// Flush the encoder until EOF and write the trailer. Returns the file size.
+int64_t pipeline_finish(EncodePipeline *p);
+
+// Free the encoder, close the file and release the container
+void pipeline_free(EncodePipeline *p);
+
+#endif
@@ -3,9 +3,16 @@
 #include <stdint.h>
 #include <string.h>
 #include <glob.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 
+#define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "blend.h"
+#include "encode.h"
+
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/opt.h>
@@ -17,48 +24,108 @@
 #define FPS 30
 #define DURATION 3 // seconds per image
 
-// Helper: log error and exit
-void check(int ret, const char *msg) {
-    if (ret < 0) {
-        char buf[1024];
-        av_strerror(ret, buf, sizeof(buf));
-        fprintf(stderr, "%s: %s\n", msg, buf);
-        exit(1);
-    }
+enum { TRANSITION_NONE, TRANSITION_CROSSFADE, TRANSITION_KENBURNS };
+
+// Encoder tuning, filled in from the command line
+typedef struct {
+    const char *output;
+    int threads;          // 0 = let the encoder decide
+    int thread_type;      // FF_THREAD_FRAME or FF_THREAD_SLICE, 0 = default
+    const char *preset;   // x264 preset, e.g. ultrafast .. veryslow
+    const char *tune;     // x264 tune, e.g. stillimage
+    int crf;              // -1 = unset
+    int64_t bitrate;      // bits/s, 0 = unset (CRF / encoder default)
+    int segments;         // >1 = encode that many segments in parallel, then remux
+    int transition;       // TRANSITION_*
+    int transition_frames;
+} EncoderOptions;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -o FILE              output file (default slideshow.mp4)\n"
+        "  --threads N          encoder threads, 0 = auto (default 0)\n"
+        "  --thread-type TYPE   frame | slice\n"
+        "  --preset NAME        x264 preset (ultrafast .. veryslow)\n"
+        "  --tune NAME          x264 tune (e.g. stillimage)\n"
+        "  --crf N              constant rate factor (0-51)\n"
+        "  --bitrate KBPS       target bitrate instead of CRF\n"
+        "  --segments N         encode N segments concurrently and join them\n"
+        "  --transition TYPE    none | crossfade | kenburns (default none)\n"
+        "  --transition-frames N  length of each transition (default %d)\n",
+        prog, FPS / 2);
+    exit(1);
 }
 
-int main() {
-    // Find all PNG files in current directory
-    glob_t globbuf;
-    int ret = glob("*.png", 0, NULL, &globbuf);
-    if (ret != 0 || globbuf.gl_pathc == 0) {
-        fprintf(stderr, "No PNG files found in current directory.\n");
-        return 1;
+static void parse_args(int argc, char **argv, EncoderOptions *o) {
+    *o = (EncoderOptions){ .output = "slideshow.mp4", .crf = -1, .segments = 1,
+                           .transition_frames = FPS / 2 };
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        int has_val = i + 1 < argc;
+        if (!strcmp(a, "-o") && has_val) o->output = argv[++i];
+        else if (!strcmp(a, "--threads") && has_val) o->threads = atoi(argv[++i]);
+        else if (!strcmp(a, "--thread-type") && has_val) {
+            const char *t = argv[++i];
+            if (!strcmp(t, "frame")) o->thread_type = FF_THREAD_FRAME;
+            else if (!strcmp(t, "slice")) o->thread_type = FF_THREAD_SLICE;
+            else usage(argv[0]);
+        }
+        else if (!strcmp(a, "--preset") && has_val) o->preset = argv[++i];
+        else if (!strcmp(a, "--tune") && has_val) o->tune = argv[++i];
+        else if (!strcmp(a, "--crf") && has_val) o->crf = atoi(argv[++i]);
+        else if (!strcmp(a, "--bitrate") && has_val) o->bitrate = atoll(argv[++i]) * 1000;
+        else if (!strcmp(a, "--segments") && has_val) o->segments = atoi(argv[++i]);
+        else if (!strcmp(a, "--transition") && has_val) {
+            const char *t = argv[++i];
+            if (!strcmp(t, "none")) o->transition = TRANSITION_NONE;
+            else if (!strcmp(t, "crossfade")) o->transition = TRANSITION_CROSSFADE;
+            else if (!strcmp(t, "kenburns")) o->transition = TRANSITION_KENBURNS;
+            else usage(argv[0]);
+        }
+        else if (!strcmp(a, "--transition-frames") && has_val) o->transition_frames = atoi(argv[++i]);
+        else usage(argv[0]);
     }
+}
 
-    int num_images = globbuf.gl_pathc;
-    char **images = globbuf.gl_pathv;
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-    AVFormatContext *fmt_ctx;
-    AVStream *video_st;
-    AVCodecContext *codec_ctx;
-    AVCodec *codec;
-    AVFrame *frame;
-    AVPacket pkt;
+// Load an image and center-crop or letterbox it into a WIDTH x HEIGHT RGB24 buffer
+static uint8_t *load_letterboxed(const char *path) {
+    int w,h,channels;
+    unsigned char *pixels = stbi_load(path, &w,&h,&channels,3);
+    if (!pixels) { fprintf(stderr,"Failed to load %s\n", path); exit(1); }
 
-    // Allocate format context
-    ret = avformat_alloc_output_context2(&fmt_ctx, NULL, NULL, "slideshow.mp4");
-    check(ret, "avformat_alloc_output_context2");
+    uint8_t *rgb_buffer = malloc(WIDTH*HEIGHT*3);
+    memset(rgb_buffer, 0, WIDTH*HEIGHT*3);
+
+    int copy_w = w<WIDTH?w:WIDTH;
+    int copy_h = h<HEIGHT?h:HEIGHT;
+    int x_off = (WIDTH - copy_w)/2;
+    int y_off = (HEIGHT - copy_h)/2;
 
-    // Find encoder
-    codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    if (!codec) { fprintf(stderr,"H.264 codec not found\n"); return 1; }
+    for(int y=0;y<copy_h;y++) {
+        memcpy(rgb_buffer + ((y+y_off)*WIDTH + x_off)*3,
+               pixels + y*w*3,
+               copy_w*3);
+    }
+
+    stbi_image_free(pixels);
+    return rgb_buffer;
+}
 
-    // Create video stream
-    video_st = avformat_new_stream(fmt_ctx, codec);
-    if (!video_st) { fprintf(stderr,"Could not create stream\n"); return 1; }
+// Create and open an H.264 encoder from the command line options.
+// closed_gop makes every GOP self-contained so segments can be joined later.
+static AVCodecContext *open_encoder(const EncoderOptions *o, int threads,
+                                    int global_header, int closed_gop) {
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (!codec) { fprintf(stderr,"H.264 codec not found\n"); exit(1); }
 
-    codec_ctx = avcodec_alloc_context3(codec);
+    AVCodecContext *codec_ctx = avcodec_alloc_context3(codec);
     codec_ctx->codec_id = AV_CODEC_ID_H264;
     codec_ctx->width = WIDTH;
     codec_ctx->height = HEIGHT;
@@ -68,32 +135,111 @@ int main() {
     codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
     codec_ctx->max_b_frames = 2;
 
-    if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+    // Threading and rate control
+    codec_ctx->thread_count = threads;
+    if (o->thread_type)
+        codec_ctx->thread_type = o->thread_type;
+    if (o->bitrate > 0)
+        codec_ctx->bit_rate = o->bitrate;
+
+    if (global_header)
         codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (closed_gop)
+        codec_ctx->flags |= AV_CODEC_FLAG_CLOSED_GOP;
+
+    // Encoder private options (libx264); anything left over is unsupported
+    AVDictionary *codec_opts = NULL;
+    if (o->preset) av_dict_set(&codec_opts, "preset", o->preset, 0);
+    if (o->tune)   av_dict_set(&codec_opts, "tune", o->tune, 0);
+    if (o->crf >= 0 && o->bitrate == 0)
+        av_dict_set_int(&codec_opts, "crf", o->crf, 0);
 
-    // Open codec
-    ret = avcodec_open2(codec_ctx, codec, NULL);
+    int ret = avcodec_open2(codec_ctx, codec, &codec_opts);
     check(ret, "avcodec_open2");
 
-    video_st->time_base = codec_ctx->time_base;
+    AVDictionaryEntry *unused = NULL;
+    while ((unused = av_dict_get(codec_opts, "", unused, AV_DICT_IGNORE_SUFFIX)))
+        fprintf(stderr, "Warning: %s does not support option %s\n", codec->name, unused->key);
+    av_dict_free(&codec_opts);
 
-    // Open output file
-    if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&fmt_ctx->pb, "slideshow.mp4", AVIO_FLAG_WRITE);
-        check(ret, "avio_open");
-    }
-
-    // Write header
-    ret = avformat_write_header(fmt_ctx, NULL);
-    check(ret, "avformat_write_header");
+    return codec_ctx;
+}
 
-    // Allocate frame
-    frame = av_frame_alloc();
+// Allocate a YUV420P frame matching the encoder
+static AVFrame *alloc_yuv_frame(AVCodecContext *codec_ctx) {
+    AVFrame *frame = av_frame_alloc();
     frame->format = codec_ctx->pix_fmt;
     frame->width = codec_ctx->width;
     frame->height = codec_ctx->height;
-    ret = av_frame_get_buffer(frame, 32);
+    int ret = av_frame_get_buffer(frame, 32);
     check(ret, "av_frame_get_buffer");
+    return frame;
+}
+
+// Load an image and convert it to YUV420P once. Hold frames re-send this
+// frame as is, so a still costs one colour conversion however long it shows.
+static AVFrame *load_still(const char *path, AVCodecContext *codec_ctx,
+                           struct SwsContext *sws_ctx) {
+    uint8_t *rgb_buffer = load_letterboxed(path);
+    AVFrame *frame = alloc_yuv_frame(codec_ctx);
+
+    uint8_t *in_data[1] = { rgb_buffer };
+    int in_linesize[1] = { 3*WIDTH };
+    sws_scale(sws_ctx, in_data, in_linesize, 0, HEIGHT, frame->data, frame->linesize);
+
+    free(rgb_buffer);
+    return frame;
+}
+
+// Pan/zoom every plane of src into dst. (tx, ty) is in luma pixels.
+static void zoom_frame(AVFrame *dst, const AVFrame *src, float scale, float tx, float ty) {
+    for (int p = 0; p < 3; p++) {
+        int shift = p ? 1 : 0;   // chroma planes are half size in YUV420P
+        zoom_plane(dst->data[p], dst->linesize[p], src->data[p], src->linesize[p],
+                   WIDTH >> shift, HEIGHT >> shift,
+                   scale, tx / (1 << shift), ty / (1 << shift));
+    }
+}
+
+static void blend_frame(AVFrame *dst, const AVFrame *a, const AVFrame *b, int alpha) {
+    for (int p = 0; p < 3; p++) {
+        int shift = p ? 1 : 0;
+        blend_plane(dst->data[p], dst->linesize[p],
+                    a->data[p], a->linesize[p], b->data[p], b->linesize[p],
+                    WIDTH >> shift, HEIGHT >> shift, alpha);
+    }
+}
+
+// Render step t (1..n) of the transition from cur to next into out.
+// Ken Burns zooms into the outgoing still (drifting right) while the
+// incoming one settles from a zoom back to full frame, and crossfades.
+static void render_transition(const EncoderOptions *o, int t, int n,
+                              AVFrame *out, AVFrame *cur, AVFrame *next,
+                              AVFrame *tmp_a, AVFrame *tmp_b) {
+    float p = (float)t / (n + 1);
+    int alpha = (int)(p * 256.0f + 0.5f);
+
+    if (o->transition == TRANSITION_KENBURNS) {
+        const float zoom = 0.2f;
+        float s_out = 1.0f - zoom * p;          // < 1 magnifies
+        float s_in  = 1.0f - zoom * (1.0f - p);
+        zoom_frame(tmp_a, cur,  s_out, WIDTH * (1.0f - s_out), HEIGHT * (1.0f - s_out) / 2);
+        zoom_frame(tmp_b, next, s_in,  WIDTH * (1.0f - s_in) / 2, HEIGHT * (1.0f - s_in) / 2);
+        blend_frame(out, tmp_a, tmp_b, alpha);
+    } else {
+        blend_frame(out, cur, next, alpha);
+    }
+}
+
+// Encode count images, each shown for DURATION seconds, with pts starting
+// at first_pts. next_image is the image after this run (NULL at the end of
+// the slideshow), so a transition can lead into it. The last
+// transition_frames of each image's slot are the transition, so the
+// total length doesn't change. Returns the number of frames encoded.
+static int64_t encode_images(const EncoderOptions *o, char **images, int count,
+                             const char *next_image, int64_t first_pts,
+                             EncodePipeline *pipe) {
+    AVCodecContext *codec_ctx = pipe->codec_ctx;
 
     // Scaling context (RGB -> YUV420P)
     struct SwsContext *sws_ctx = sws_getContext(
@@ -102,76 +248,246 @@ int main() {
         SWS_BILINEAR, NULL, NULL, NULL
     );
 
-    int pts = 0;
+    int frames_per_image = FPS * DURATION;
+    int n_trans = o->transition == TRANSITION_NONE ? 0 : o->transition_frames;
+    if (n_trans < 0) n_trans = 0;
+    if (n_trans >= frames_per_image) n_trans = frames_per_image - 1;
+
+    AVFrame *mix = NULL, *tmp_a = NULL, *tmp_b = NULL;
+    if (n_trans > 0) {
+        mix = alloc_yuv_frame(codec_ctx);
+        if (o->transition == TRANSITION_KENBURNS) {
+            tmp_a = alloc_yuv_frame(codec_ctx);
+            tmp_b = alloc_yuv_frame(codec_ctx);
+        }
+    }
 
-    for (int i = 0; i < num_images; i++) {
-        int w,h,channels;
-        unsigned char *pixels = stbi_load(images[i], &w,&h,&channels,3);
-        if (!pixels) { fprintf(stderr,"Failed to load %s\n", images[i]); return 1; }
+    int64_t pts = first_pts;
+    AVFrame *cur = load_still(images[0], codec_ctx, sws_ctx);
 
-        // Center-crop or letterbox to output size
-        uint8_t *rgb_buffer = malloc(WIDTH*HEIGHT*3);
-        memset(rgb_buffer, 0, WIDTH*HEIGHT*3);
+    for (int i = 0; i < count; i++) {
+        const char *next_path = i + 1 < count ? images[i + 1] : next_image;
+        AVFrame *next = n_trans > 0 && next_path ? load_still(next_path, codec_ctx, sws_ctx) : NULL;
+        int hold = frames_per_image - (next ? n_trans : 0);
 
-        int copy_w = w<WIDTH?w:WIDTH;
-        int copy_h = h<HEIGHT?h:HEIGHT;
-        int x_off = (WIDTH - copy_w)/2;
-        int y_off = (HEIGHT - copy_h)/2;
+        // Hold frames: the same still, only the pts changes
+        for (int f = 0; f < hold; f++) {
+            cur->pts = pts++;
+            pipeline_send(pipe, cur);
+        }
 
-        for(int y=0;y<copy_h;y++) {
-            memcpy(rgb_buffer + ((y+y_off)*WIDTH + x_off)*3,
-                   pixels + y*w*3,
-                   copy_w*3);
+        if (next) {
+            for (int t = 1; t <= n_trans; t++) {
+                int ret = av_frame_make_writable(mix);
+                check(ret, "av_frame_make_writable");
+                render_transition(o, t, n_trans, mix, cur, next, tmp_a, tmp_b);
+                mix->pts = pts++;
+                pipeline_send(pipe, mix);
+            }
         }
 
-        stbi_image_free(pixels);
+        av_frame_free(&cur);
+        cur = next ? next : (i + 1 < count ? load_still(images[i + 1], codec_ctx, sws_ctx) : NULL);
+    }
+
+    av_frame_free(&cur);
+    av_frame_free(&mix);
+    av_frame_free(&tmp_a);
+    av_frame_free(&tmp_b);
+    sws_freeContext(sws_ctx);
+    return pts - first_pts;
+}
 
-        // Write each frame multiple times for duration
-        for (int f=0; f<FPS*DURATION; f++) {
-            uint8_t *in_data[1] = { rgb_buffer };
-            int in_linesize[1] = { 3*WIDTH };
-            sws_scale(sws_ctx, in_data, in_linesize, 0, HEIGHT, frame->data, frame->linesize);
+// ------------------------------------------------------------
+// Segmented mode: N encoders run concurrently on consecutive runs of
+// images, each into its own NUT file, and the results are stream-copied
+// into the final container. Every segment starts with a closed GOP and
+// carries global pts, so the joined stream needs no re-encoding and no
+// timestamp rewriting beyond a time base rescale.
+// ------------------------------------------------------------
+
+typedef struct {
+    const EncoderOptions *opts;
+    char **images;
+    int count;
+    const char *next_image;   // first image of the following segment, for transitions
+    int64_t first_pts;
+    int threads;
+    char path[1024];
+} Segment;
+
+static void *encode_segment(void *arg) {
+    Segment *seg = arg;
+
+    EncodePipeline pipe;
+    pipeline_open(&pipe, seg->path, "nut");
+
+    // Global header so the extradata can be copied into the final container
+    pipeline_start(&pipe, open_encoder(seg->opts, seg->threads, 1, 1));
+
+    encode_images(seg->opts, seg->images, seg->count, seg->next_image, seg->first_pts, &pipe);
+
+    pipeline_finish(&pipe);
+    pipeline_free(&pipe);
+    return NULL;
+}
 
-            frame->pts = pts++;
+// Stream-copy every segment, in order, into one output file.
+// Returns the size of the joined file.
+static int64_t concat_segments(Segment *segs, int num_segs, const char *output) {
+    AVFormatContext *out_ctx;
+    int ret = avformat_alloc_output_context2(&out_ctx, NULL, NULL, output);
+    check(ret, "avformat_alloc_output_context2");
+    AVStream *out_st = NULL;
 
-            av_init_packet(&pkt);
-            pkt.data = NULL;
-            pkt.size = 0;
+    int64_t last_dts = AV_NOPTS_VALUE;
+    AVPacket pkt;
 
-            ret = avcodec_send_frame(codec_ctx, frame);
-            check(ret, "avcodec_send_frame");
+    for (int s = 0; s < num_segs; s++) {
+        AVFormatContext *in_ctx = NULL;
+        ret = avformat_open_input(&in_ctx, segs[s].path, NULL, NULL);
+        check(ret, "avformat_open_input");
+        ret = avformat_find_stream_info(in_ctx, NULL);
+        check(ret, "avformat_find_stream_info");
+        AVStream *in_st = in_ctx->streams[0];
+
+        // The first segment defines the output stream; the others were
+        // produced with identical settings so their parameters match.
+        if (!out_st) {
+            out_st = avformat_new_stream(out_ctx, NULL);
+            if (!out_st) { fprintf(stderr,"Could not create stream\n"); exit(1); }
+            ret = avcodec_parameters_copy(out_st->codecpar, in_st->codecpar);
+            check(ret, "avcodec_parameters_copy");
+            out_st->codecpar->codec_tag = 0;
+            out_st->time_base = in_st->time_base;
+
+            if (!(out_ctx->oformat->flags & AVFMT_NOFILE)) {
+                ret = avio_open(&out_ctx->pb, output, AVIO_FLAG_WRITE);
+                check(ret, "avio_open");
+            }
+            ret = avformat_write_header(out_ctx, NULL);
+            check(ret, "avformat_write_header");
+        }
 
-            ret = avcodec_receive_packet(codec_ctx, &pkt);
-            if (ret == 0) {
-                pkt.stream_index = video_st->index;
-                ret = av_interleaved_write_frame(fmt_ctx, &pkt);
-                av_packet_unref(&pkt);
-                check(ret, "av_interleaved_write_frame");
-            } else if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
-                check(ret, "avcodec_receive_packet");
+        while (av_read_frame(in_ctx, &pkt) >= 0) {
+            av_packet_rescale_ts(&pkt, in_st->time_base, out_st->time_base);
+            pkt.stream_index = out_st->index;
+
+            // Each encoder delays dts by the same B-frame depth, so joins are
+            // already monotonic. Guard anyway so a mismatched segment
+            // cannot produce a file the muxer rejects.
+            if (last_dts != AV_NOPTS_VALUE && pkt.dts <= last_dts) {
+                fprintf(stderr, "Warning: segment %d dts %lld <= %lld, adjusting\n",
+                        s, (long long)pkt.dts, (long long)last_dts);
+                pkt.dts = last_dts + 1;
+                if (pkt.pts < pkt.dts) pkt.pts = pkt.dts;
             }
+            last_dts = pkt.dts;
+
+            ret = av_interleaved_write_frame(out_ctx, &pkt);
+            av_packet_unref(&pkt);
+            check(ret, "av_interleaved_write_frame");
         }
 
-        free(rgb_buffer);
+        avformat_close_input(&in_ctx);
     }
 
-    // Flush encoder
-    avcodec_send_frame(codec_ctx, NULL);
-    while(avcodec_receive_packet(codec_ctx, &pkt) == 0) {
-        pkt.stream_index = video_st->index;
-        av_interleaved_write_frame(fmt_ctx, &pkt);
-        av_packet_unref(&pkt);
+    av_write_trailer(out_ctx);
+    int64_t size = out_ctx->pb ? avio_size(out_ctx->pb) : 0;
+    if (!(out_ctx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&out_ctx->pb);
+    avformat_free_context(out_ctx);
+    printf("Joined %d segments into %s\n", num_segs, output);
+    return size;
+}
+
+// Returns the number of frames encoded; *size receives the output file size
+static int64_t encode_segmented(const EncoderOptions *opts, char **images, int num_images,
+                                int64_t *size) {
+    int num_segs = opts->segments < num_images ? opts->segments : num_images;
+
+    // Split the encoder threads between segments so they don't oversubscribe
+    int cpus = opts->threads > 0 ? opts->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus / num_segs > 0 ? cpus / num_segs : 1;
+
+    Segment *segs = calloc(num_segs, sizeof(Segment));
+    pthread_t *tids = calloc(num_segs, sizeof(pthread_t));
+
+    int next = 0;
+    for (int s = 0; s < num_segs; s++) {
+        // Spread the remainder over the first segments
+        int count = num_images / num_segs + (s < num_images % num_segs ? 1 : 0);
+        segs[s].opts = opts;
+        segs[s].images = images + next;
+        segs[s].count = count;
+        segs[s].next_image = next + count < num_images ? images[next + count] : NULL;
+        segs[s].first_pts = (int64_t)next * FPS * DURATION;
+        segs[s].threads = threads;
+        snprintf(segs[s].path, sizeof(segs[s].path), "%s.seg%03d.nut", opts->output, s);
+        printf("Segment %d: images %d-%d, %d threads\n", s, next, next + count - 1, threads);
+        next += count;
+
+        int err = pthread_create(&tids[s], NULL, encode_segment, &segs[s]);
+        if (err) { fprintf(stderr, "pthread_create: %s\n", strerror(err)); exit(1); }
     }
+    for (int s = 0; s < num_segs; s++)
+        pthread_join(tids[s], NULL);
 
-    // Write trailer and clean up
-    av_write_trailer(fmt_ctx);
-    av_frame_free(&frame);
-    avcodec_free_context(&codec_ctx);
-    if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE))
-        avio_closep(&fmt_ctx->pb);
-    avformat_free_context(fmt_ctx);
-    sws_freeContext(sws_ctx);
+    *size = concat_segments(segs, num_segs, opts->output);
+
+    for (int s = 0; s < num_segs; s++)
+        remove(segs[s].path);
+    free(segs);
+    free(tids);
+    return (int64_t)num_images * FPS * DURATION;
+}
+
+int main(int argc, char **argv) {
+    EncoderOptions opts;
+    parse_args(argc, argv, &opts);
+
+    // Find all PNG files in current directory
+    glob_t globbuf;
+    int ret = glob("*.png", 0, NULL, &globbuf);
+    if (ret != 0 || globbuf.gl_pathc == 0) {
+        fprintf(stderr, "No PNG files found in current directory.\n");
+        return 1;
+    }
+
+    int num_images = globbuf.gl_pathc;
+    char **images = globbuf.gl_pathv;
+
+    if (opts.transition != TRANSITION_NONE)
+        printf("Transition kernels: %s\n", blend_impl_name());
+
+    double start = now_seconds();
+    int64_t frames;
+    int64_t size = 0;
+
+    if (opts.segments > 1) {
+        frames = encode_segmented(&opts, images, num_images, &size);
+    } else {
+        EncodePipeline pipe;
+        pipeline_open(&pipe, opts.output, NULL);
+
+        AVCodecContext *codec_ctx = open_encoder(&opts, opts.threads,
+                                                 pipeline_wants_global_header(&pipe), 0);
+
+        printf("Encoder: %s threads=%d thread_type=%s\n", codec_ctx->codec->name, codec_ctx->thread_count,
+               codec_ctx->active_thread_type == FF_THREAD_SLICE ? "slice" :
+               codec_ctx->active_thread_type == FF_THREAD_FRAME ? "frame" : "none");
+
+        pipeline_start(&pipe, codec_ctx);
+        frames = encode_images(&opts, images, num_images, NULL, 0, &pipe);
+        size = pipeline_finish(&pipe);
+        pipeline_free(&pipe);
+    }
+
+    double elapsed = now_seconds() - start;
+    globfree(&globbuf);
 
-    printf("Slideshow saved to slideshow.mp4\n");
+    printf("Slideshow saved to %s\n", opts.output);
+    printf("frames=%lld time=%.3fs fps=%.1f size=%lld bytes\n",
+           (long long)frames, elapsed, elapsed > 0 ? frames / elapsed : 0.0, (long long)size);
     return 0;
 }
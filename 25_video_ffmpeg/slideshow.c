@@ -13,21 +13,78 @@
 #include <libavutil/imgutils.h>
 #include <libswscale/swscale.h>
 
+#include "encode.h"
+
 #define WIDTH 640
 #define HEIGHT 480
 #define FPS 30
 #define DURATION 2 // seconds per image
 
-void check(int ret, const char *msg) {
-    if (ret < 0) {
-        char buf[1024];
-        av_strerror(ret, buf, sizeof(buf));
-        fprintf(stderr, "%s: %s\n", msg, buf);
-        exit(1);
+// Intermediate codecs. All are intra-only, so every packet decodes on its
+// own and one packet per still can be written for each of its frames.
+typedef struct {
+    const char *name;
+    enum AVCodecID id;
+    enum AVPixelFormat pix_fmt;
+} IntraCodec;
+
+static const IntraCodec codecs[] = {
+    { "raw",     AV_CODEC_ID_RAWVIDEO, AV_PIX_FMT_RGB24 },
+    { "ffv1",    AV_CODEC_ID_FFV1,     AV_PIX_FMT_GBRP  },
+    { "utvideo", AV_CODEC_ID_UTVIDEO,  AV_PIX_FMT_GBRP  },
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -o FILE             output file (default slideshow.mkv)\n"
+        "  --lossless CODEC    ffv1 | utvideo instead of raw RGB24\n",
+        prog);
+    exit(1);
+}
+
+// Copy an image into an RGB24 plane, center-cropped or letterboxed
+static void letterbox(uint8_t *dst, int linesize, const unsigned char *pixels, int w, int h) {
+    for (int y = 0; y < HEIGHT; y++)
+        memset(dst + y*linesize, 0, WIDTH*3);
+
+    int copy_w = w<WIDTH?w:WIDTH;
+    int copy_h = h<HEIGHT?h:HEIGHT;
+    int x_off = (WIDTH - copy_w)/2;
+    int y_off = (HEIGHT - copy_h)/2;
+
+    for(int y=0;y<copy_h;y++) {
+        memcpy(dst + (y+y_off)*linesize + x_off*3,
+               pixels + y*w*3,
+               copy_w*3);
     }
 }
 
-int main() {
+static AVFrame *alloc_frame(enum AVPixelFormat pix_fmt) {
+    AVFrame *frame = av_frame_alloc();
+    frame->format = pix_fmt;
+    frame->width = WIDTH;
+    frame->height = HEIGHT;
+    int ret = av_frame_get_buffer(frame, 32);
+    check(ret, "av_frame_get_buffer");
+    return frame;
+}
+
+int main(int argc, char **argv) {
+    const char *output = "slideshow.mkv";
+    const IntraCodec *ic = &codecs[0];
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+        else if (!strcmp(argv[i], "--lossless") && i + 1 < argc) {
+            const char *name = argv[++i];
+            ic = NULL;
+            for (size_t c = 1; c < sizeof(codecs)/sizeof(codecs[0]); c++)
+                if (!strcmp(name, codecs[c].name)) ic = &codecs[c];
+            if (!ic) usage(argv[0]);
+        }
+        else usage(argv[0]);
+    }
+
     glob_t globbuf;
     int ret = glob("*.png", 0, NULL, &globbuf);
     if (ret != 0 || globbuf.gl_pathc == 0) {
@@ -38,63 +95,64 @@ int main() {
     int num_images = globbuf.gl_pathc;
     char **images = globbuf.gl_pathv;
 
-    AVFormatContext *fmt_ctx;
-    AVStream *video_st;
+    EncodePipeline pipe;
     AVCodecContext *codec_ctx;
     const AVCodec *codec;
-    AVFrame *frame;
-    AVPacket pkt;
 
     // Allocate output format context (MKV)
-    ret = avformat_alloc_output_context2(&fmt_ctx, NULL, "matroska", "slideshow.mkv");
-    check(ret, "avformat_alloc_output_context2");
-
-    codec = avcodec_find_encoder(AV_CODEC_ID_RAWVIDEO);
-    if (!codec) { fprintf(stderr,"Rawvideo codec not found\n"); return 1; }
+    pipeline_open(&pipe, output, "matroska");
 
-    video_st = avformat_new_stream(fmt_ctx, codec);
-    if (!video_st) { fprintf(stderr,"Could not create stream\n"); return 1; }
+    codec = avcodec_find_encoder(ic->id);
+    if (!codec) { fprintf(stderr,"%s codec not found\n", ic->name); return 1; }
 
     codec_ctx = avcodec_alloc_context3(codec);
-    codec_ctx->codec_id = AV_CODEC_ID_RAWVIDEO;
+    codec_ctx->codec_id = ic->id;
     codec_ctx->width = WIDTH;
     codec_ctx->height = HEIGHT;
     codec_ctx->time_base = (AVRational){1,FPS};
     codec_ctx->framerate = (AVRational){FPS,1};
-    codec_ctx->pix_fmt = AV_PIX_FMT_RGB24;
-    codec_ctx->gop_size = 12;
+    codec_ctx->pix_fmt = ic->pix_fmt;
+    codec_ctx->gop_size = 1;   // every packet a keyframe, so packets can repeat
+    codec_ctx->thread_count = 0;
+    // Slice threads only: frame threading (UTVideo's only kind) holds back
+    // the first packets, and each still's packet is needed right away.
+    // UTVideo then encodes on one thread.
+    codec_ctx->thread_type = FF_THREAD_SLICE;
+
+    AVDictionary *codec_opts = NULL;
+    if (ic->id == AV_CODEC_ID_FFV1) {
+        codec_ctx->level = 3;   // sliced, so encoding runs on several threads
+        av_dict_set(&codec_opts, "slices", "16", 0);
+    } else if (ic->id == AV_CODEC_ID_UTVIDEO) {
+        av_dict_set(&codec_opts, "pred", "median", 0);
+    }
 
-    if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+    if (pipeline_wants_global_header(&pipe))
         codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
-    ret = avcodec_open2(codec_ctx, codec, NULL);
+    ret = avcodec_open2(codec_ctx, codec, &codec_opts);
     check(ret, "avcodec_open2");
-
-    ret = avcodec_parameters_from_context(video_st->codecpar, codec_ctx);
-    check(ret, "avcodec_parameters_from_context");
-    video_st->time_base = codec_ctx->time_base;
-
-    if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&fmt_ctx->pb, "slideshow.mkv", AVIO_FLAG_WRITE);
-        check(ret, "avio_open");
+    av_dict_free(&codec_opts);
+
+    // Adds the stream, copies the codec parameters and writes the header
+    pipeline_start(&pipe, codec_ctx);
+
+    // Raw RGB24 is written straight from the letterboxed frame. Only the
+    // planar lossless codecs need a (real) pixel format conversion.
+    AVFrame *rgb = alloc_frame(AV_PIX_FMT_RGB24);
+    AVFrame *frame = rgb;
+    struct SwsContext *sws_ctx = NULL;
+    if (ic->pix_fmt != AV_PIX_FMT_RGB24) {
+        frame = alloc_frame(ic->pix_fmt);
+        sws_ctx = sws_getContext(
+            WIDTH, HEIGHT, AV_PIX_FMT_RGB24,
+            WIDTH, HEIGHT, ic->pix_fmt,
+            SWS_POINT, NULL, NULL, NULL
+        );
     }
 
-    ret = avformat_write_header(fmt_ctx, NULL);
-    check(ret, "avformat_write_header");
-
-    frame = av_frame_alloc();
-    frame->format = codec_ctx->pix_fmt;
-    frame->width = codec_ctx->width;
-    frame->height = codec_ctx->height;
-    ret = av_frame_get_buffer(frame, 32);
-    check(ret, "av_frame_get_buffer");
-
-    struct SwsContext *sws_ctx = sws_getContext(
-        WIDTH, HEIGHT, AV_PIX_FMT_RGB24,   // input
-        WIDTH, HEIGHT, AV_PIX_FMT_RGB24,   // output
-        SWS_BILINEAR, NULL, NULL, NULL
-    );
-
+    AVPacket *still = av_packet_alloc();
+    AVPacket *dup = av_packet_alloc();
     int64_t pts = 0;
 
     for (int i = 0; i < num_images; i++) {
@@ -102,70 +160,49 @@ int main() {
         unsigned char *pixels = stbi_load(images[i], &w,&h,&channels,3);
         if (!pixels) { fprintf(stderr,"Failed to load %s\n", images[i]); return 1; }
 
-        uint8_t *rgb_buffer = malloc(WIDTH*HEIGHT*3);
-        memset(rgb_buffer, 0, WIDTH*HEIGHT*3);
-
-        int copy_w = w<WIDTH?w:WIDTH;
-        int copy_h = h<HEIGHT?h:HEIGHT;
-        int x_off = (WIDTH - copy_w)/2;
-        int y_off = (HEIGHT - copy_h)/2;
+        // The encoder may still hold the previous still's buffers
+        ret = av_frame_make_writable(rgb);
+        check(ret, "av_frame_make_writable");
+        letterbox(rgb->data[0], rgb->linesize[0], pixels, w, h);
+        stbi_image_free(pixels);
 
-        for(int y=0;y<copy_h;y++) {
-            memcpy(rgb_buffer + ((y+y_off)*WIDTH + x_off)*3,
-                   pixels + y*w*3,
-                   copy_w*3);
+        if (sws_ctx) {
+            ret = av_frame_make_writable(frame);
+            check(ret, "av_frame_make_writable");
+            sws_scale(sws_ctx, (const uint8_t * const *)rgb->data, rgb->linesize,
+                      0, HEIGHT, frame->data, frame->linesize);
         }
 
-        stbi_image_free(pixels);
+        // Encode the still once, then repeat its packet for DURATION
+        // seconds. The copies share the packet's buffer by reference.
+        frame->pts = pts;
+        pipeline_encode_intra(&pipe, frame, still);
 
-        // Repeat frames for DURATION seconds
         int frames_per_image = FPS * DURATION;
         for (int f = 0; f < frames_per_image; f++) {
-            uint8_t *in_data[1] = { rgb_buffer };
-            int in_linesize[1] = { 3*WIDTH };
-            sws_scale(sws_ctx, in_data, in_linesize, 0, HEIGHT, frame->data, frame->linesize);
-
-            frame->pts = pts++;  // increment per frame
-
-            av_init_packet(&pkt);
-            pkt.data = NULL;
-            pkt.size = 0;
-
-            ret = avcodec_send_frame(codec_ctx, frame);
-            check(ret, "avcodec_send_frame");
-
-            while (ret >= 0) {
-                ret = avcodec_receive_packet(codec_ctx, &pkt);
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-                    break;
-                check(ret, "avcodec_receive_packet");
-
-                pkt.stream_index = video_st->index;
-                ret = av_interleaved_write_frame(fmt_ctx, &pkt);
-                av_packet_unref(&pkt);
-                check(ret, "av_interleaved_write_frame");
-            }
+            ret = av_packet_ref(dup, still);
+            check(ret, "av_packet_ref");
+            dup->pts = dup->dts = pts++;  // increment per frame
+            dup->duration = 1;
+            pipeline_write_packet(&pipe, dup);
         }
-
-        free(rgb_buffer);
+        av_packet_unref(still);
     }
 
-    // Flush encoder
-    avcodec_send_frame(codec_ctx, NULL);
-    while(avcodec_receive_packet(codec_ctx, &pkt) == 0) {
-        pkt.stream_index = video_st->index;
-        av_interleaved_write_frame(fmt_ctx, &pkt);
-        av_packet_unref(&pkt);
-    }
+    // Flush encoder, write trailer
+    int64_t size = pipeline_finish(&pipe);
 
-    av_write_trailer(fmt_ctx);
-    av_frame_free(&frame);
-    avcodec_free_context(&codec_ctx);
-    if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE))
-        avio_closep(&fmt_ctx->pb);
-    avformat_free_context(fmt_ctx);
+    if (frame != rgb)
+        av_frame_free(&frame);
+    av_frame_free(&rgb);
+    av_packet_free(&still);
+    av_packet_free(&dup);
+    pipeline_free(&pipe);
     sws_freeContext(sws_ctx);
+    globfree(&globbuf);
 
-    printf("Slideshow saved to slideshow.mkv\n");
+    printf("Slideshow saved to %s (%s, %lld bytes, %.1f MB per second of video)\n",
+           output, ic->name, (long long)size,
+           pts ? size / 1e6 / ((double)pts / FPS) : 0.0);
     return 0;
 }